@@ -0,0 +1,49 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+/**
+ * Next state of 64 cells from their 8 neighbor words and current state.
+ * a* / c* are the rows above / below (left, center, right); b* the same row.
+ * Shared by the bit-packed engines (tiled, HashLife leaves).
+ */
+inline uint64_t life_row(uint64_t a0, uint64_t a1, uint64_t a2,
+                         uint64_t b0, uint64_t alive, uint64_t b2,
+                         uint64_t c0, uint64_t c1, uint64_t c2) noexcept {
+    // Row sums as 2-bit numbers (carry, sum)
+    uint64_t sa = a0 ^ a1 ^ a2;
+    uint64_t ca = (a0 & a1) | (a2 & (a0 ^ a1));
+    uint64_t sb = b0 ^ b2;
+    uint64_t cb = b0 & b2;
+    uint64_t sc = c0 ^ c1 ^ c2;
+    uint64_t cc = (c0 & c1) | (c2 & (c0 ^ c1));
+
+    // count = ones + 2 * (number of set bits among ca, cb, cc, carry)
+    uint64_t ones = sa ^ sb ^ sc;
+    uint64_t carry = (sa & sb) | (sc & (sa ^ sb));
+
+    // count is 2 or 3 iff exactly one twos-bit is set
+    uint64_t t1 = ca ^ cb;
+    uint64_t t2 = cc ^ carry;
+    uint64_t exactly_one = (t1 ^ t2) & ~((ca & cb) | (cc & carry) | (t1 & t2));
+
+    // count == 3, or count == 2 and alive
+    return exactly_one & (ones | alive);
+}
+
+/**
+ * One generation of an 8x8 board packed as bit (8 * y + x).
+ * Cells outside the board count as dead, so only the inner 6x6 is exact.
+ */
+inline uint64_t life_8x8(uint64_t board) noexcept {
+    constexpr uint64_t kNotColumn0 = 0xfefefefefefefefeULL;
+    constexpr uint64_t kNotColumn7 = 0x7f7f7f7f7f7f7f7fULL;
+    uint64_t left = (board << 1) & kNotColumn0;   // bit x holds cell x - 1
+    uint64_t right = (board >> 1) & kNotColumn7;  // bit x holds cell x + 1
+    return life_row(left << 8, board << 8, right << 8,
+                    left, board, right,
+                    left >> 8, board >> 8, right >> 8);
+}
+
+#endif // BITBOARD_H
@@ -0,0 +1,132 @@
+#ifndef LIFE_DELTA_STREAM_H
+#define LIFE_DELTA_STREAM_H
+
+#include "game_of_life.h"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Delta streams: the state of a run at chosen generations, as a sequence of
+ * frames. A keyframe lists every live cell; a delta frame lists the cells
+ * born and died since the previous frame, so between keyframes a stream
+ * grows with the pattern's activity rather than its population. Cells are
+ * written sorted by (x, y).
+ *
+ * Text, one record per line after a "#Life Delta 1" header:
+ *
+ *   K <generation> <cells>         then "x y" for each live cell
+ *   D <generation> <born> <died>   then "+x y" for each birth, "-x y" for
+ *                                  each death
+ *
+ * Binary, after the magic "LIFEDLTA" and a little-endian uint32 version:
+ *
+ *   'K', varint generation, cell list
+ *   'D', varint generation, cell list (born), cell list (died)
+ *
+ * A cell list is a varint count, then each cell as x - previous x; then
+ * y - previous y - 1 if x repeats, else zigzag(y - previous y). The first
+ * cell is taken relative to (0, 0), always with the zigzag y. Differences
+ * wrap modulo 2^64.
+ */
+constexpr uint32_t kDeltaStreamVersion = 1;
+
+enum class DeltaFormat {
+    Text,
+    Binary
+};
+
+/**
+ * Parse "text" or "binary".
+ * @throws std::invalid_argument on anything else
+ */
+[[nodiscard]] DeltaFormat parse_delta_format(std::string_view s);
+
+/** One frame of a delta stream. */
+struct DeltaFrame {
+    bool keyframe = false;
+    uint64_t generation = 0;
+    std::vector<Cell> born;  // keyframes: every live cell
+    std::vector<Cell> died;  // keyframes: empty
+};
+
+/**
+ * Writes a delta stream to `out`, header first. Frames are formatted into
+ * a buffer handed to the stream in large writes, and the stream is flushed
+ * after each frame so a reader can follow the run as it goes.
+ */
+class DeltaWriter {
+public:
+    /** @throws std::runtime_error if the header can't be written */
+    DeltaWriter(std::ostream& out, DeltaFormat format);
+
+    /**
+     * Write a keyframe holding `cells`, which should be sorted by (x, y).
+     * @throws std::runtime_error if the write fails
+     */
+    void keyframe(uint64_t generation, const std::vector<Cell>& cells);
+
+    /**
+     * Write the changes since the previous frame, as sorted by
+     * GameOfLife::take_changes().
+     * @throws std::runtime_error if the write fails
+     */
+    void delta(uint64_t generation, const CellDelta& changes);
+
+    /** Bytes written so far, header included. */
+    uint64_t bytes_written() const noexcept { return bytes_; }
+
+    uint64_t frames() const noexcept { return frames_; }
+    uint64_t keyframes() const noexcept { return keyframes_; }
+
+private:
+    std::ostream& out_;
+    DeltaFormat format_;
+    std::string buffer_;
+    uint64_t bytes_ = 0;
+    uint64_t frames_ = 0;
+    uint64_t keyframes_ = 0;
+
+    void put_cells(const std::vector<Cell>& cells, const char* prefix);
+    void flush_buffer();
+    void end_frame();
+};
+
+/** Reads a delta stream in either format, told apart by its header. */
+class DeltaReader {
+public:
+    /** @throws std::runtime_error if the stream has no delta header */
+    explicit DeltaReader(std::istream& in);
+
+    DeltaFormat format() const noexcept { return format_; }
+
+    /**
+     * Read the next frame into `frame`.
+     * @return false at the end of the stream
+     * @throws std::runtime_error on malformed or truncated frames
+     */
+    bool next(DeltaFrame& frame);
+
+private:
+    std::istream& in_;
+    DeltaFormat format_;
+    std::string line_;
+
+    bool next_text(DeltaFrame& frame);
+    bool next_binary(DeltaFrame& frame);
+    void read_text_cells(size_t count, char sign, std::vector<Cell>& cells);
+    void read_binary_cells(std::vector<Cell>& cells);
+};
+
+/**
+ * Bring `cells` to the frame's generation: a keyframe replaces them, a
+ * delta inserts its births and erases its deaths.
+ * @throws std::runtime_error if a delta doesn't fit: a birth already alive
+ *         or a death not alive
+ */
+void apply_delta_frame(const DeltaFrame& frame, CellSet& cells);
+
+#endif // LIFE_DELTA_STREAM_H
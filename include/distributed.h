@@ -0,0 +1,125 @@
+#ifndef LIFE_DISTRIBUTED_H
+#define LIFE_DISTRIBUTED_H
+
+#include "engine.h"
+#include "game_of_life.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/** Settings for a DistributedLife. */
+struct DistributedOptions {
+    unsigned ranks = 2;                    // worker processes, one domain each
+    uint64_t halo = 1;                     // halo width k, exchanged every k generations
+    EngineType engine = EngineType::Tiled; // engine each rank steps its domain with
+    unsigned threads = 1;                  // engine threads per rank
+    Rule rule;
+    double imbalance = 1.5;                // rebalance once the largest domain holds this
+                                           // many times the mean population (0: never)
+    uint64_t rebalance_every = 64;         // generations between rebalances, at least
+};
+
+/** Counters kept by a DistributedLife. */
+struct DistributedStats {
+    uint64_t exchanges = 0;       // halo exchanges
+    uint64_t halo_cells = 0;      // cells sent in halos, over all ranks
+    uint64_t rebalances = 0;
+    uint64_t migrated_cells = 0;  // cells moved to another rank by rebalancing
+};
+
+/**
+ * A universe partitioned into vertical stripes of columns, each owned and
+ * stepped by its own worker process, so that no process holds more than
+ * its stripe (plus halos) in memory.
+ *
+ * Every k = halo generations, each rank sends its neighbors the k columns
+ * next to their shared edge, steps its stripe plus the halos k generations
+ * on its own engine, and drops every cell outside its stripe. Information
+ * travels one cell per generation, so the stripe is exact after k steps; a
+ * wider halo trades bigger messages for fewer exchanges. When the largest
+ * stripe's population drifts past `imbalance` times the mean, the stripe
+ * edges are moved to population quantiles, sampled by each rank, and cells
+ * migrate between neighbors.
+ *
+ * Ranks are forked from the calling process (which must not be running
+ * other threads), so all run on one host, and talk over Unix-domain stream
+ * sockets: one control socket to the coordinator, one to each neighbor.
+ * The caller's starting cells are the one full copy of the universe; after
+ * the constructor the coordinator holds no cells beyond the batches it
+ * forwards.
+ */
+class DistributedLife {
+public:
+    /**
+     * Partition `cells` by x quantiles and start options.ranks workers.
+     * @param generation Generation number of `cells` (e.g. from a snapshot)
+     * @throws std::invalid_argument if ranks or halo is 0, or if ranks - 1
+     *         stripes of halo columns can't fit in the int64_t range
+     * @throws std::runtime_error if the workers can't be started
+     */
+    DistributedLife(const CellSet& cells, const DistributedOptions& options, uint64_t generation = 0);
+
+    /** Stops the workers and waits for them to exit. */
+    ~DistributedLife();
+
+    DistributedLife(const DistributedLife&) = delete;
+    DistributedLife& operator=(const DistributedLife&) = delete;
+
+    /**
+     * Run `generations` generations, in exchanges of at most `halo`.
+     * @throws std::runtime_error if a worker fails; the run can't continue
+     */
+    void run(uint64_t generations);
+
+    /** Generation number of the current state. */
+    uint64_t generation() const noexcept { return generation_; }
+
+    /** Live cells over all ranks. */
+    uint64_t count() const noexcept;
+
+    /** Live cells per rank. */
+    const std::vector<uint64_t>& populations() const noexcept { return populations_; }
+
+    /** First column of each stripe; the first is INT64_MIN. */
+    const std::vector<int64_t>& boundaries() const noexcept { return starts_; }
+
+    const DistributedStats& stats() const noexcept { return stats_; }
+
+    /**
+     * Call fn(const std::vector<Cell>&) with every live cell, in batches
+     * streamed from each rank in turn (unsorted within a rank).
+     */
+    void for_each_batch(const std::function<void(const std::vector<Cell>&)>& fn);
+
+    /**
+     * Have every rank save its stripe as a snapshot at shard_path(prefix,
+     * rank), in parallel. merge_snapshots() joins the shards.
+     * @return The shard paths, in rank order
+     */
+    std::vector<std::string> save_shards(const std::string& prefix);
+
+    /** "<prefix>.<rank, 4 digits>.snap" */
+    static std::string shard_path(const std::string& prefix, unsigned rank);
+
+private:
+    struct Worker {
+        pid_t pid = -1;
+        int control = -1;
+    };
+
+    DistributedOptions options_;
+    uint64_t generation_;
+    std::vector<Worker> workers_;
+    std::vector<int64_t> starts_;
+    std::vector<uint64_t> populations_;
+    uint64_t last_rebalance_;
+    DistributedStats stats_;
+
+    void start_workers();
+    void stop_workers() noexcept;
+    void maybe_rebalance();
+};
+
+#endif // LIFE_DISTRIBUTED_H
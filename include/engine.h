@@ -2,14 +2,28 @@
 #define ENGINE_H
 
 #include "game_of_life.h"
+#include <cstdint>
+#include <istream>
 #include <memory>
+#include <optional>
+#include <ostream>
 #include <string>
 #include <string_view>
+#include <vector>
 
 enum class EngineType {
     Hashtable,
     Sorted,
-    Hashlife
+    Hashlife,
+    HashlifeFast,
+    Tiled,
+    Auto
+};
+
+/** A named engine statistic, reported by --stats. */
+struct EngineCounter {
+    std::string name;
+    uint64_t value;
 };
 
 /**
@@ -24,11 +38,177 @@ public:
     /** Advance the cell set by one generation. */
     virtual void tick(CellSet& cells) = 0;
 
+    /**
+     * Advance the cell set by `generations` generations.
+     * The default calls tick() in a loop; engines override this to amortize
+     * per-tick setup (sorting, tree construction) over the whole run.
+     */
+    virtual void advance(CellSet& cells, uint64_t generations) {
+        for (uint64_t i = 0; i < generations; i++) {
+            tick(cells);
+        }
+    }
+
+    /**
+     * Write the generation after `current` into `next`, reusing its storage,
+     * without modifying `current`, so `current` can be read from another
+     * thread meanwhile. `next` must be a different set. Afterwards the engine
+     * holds the new generation as tick() would, and `next` is synced. The
+     * default ticks a copy of `current` (the engine's own generation, if it
+     * retains one) and syncs it into `next`.
+     */
+    virtual void tick_into(const CellSet& current, CellSet& next) {
+        if (!retains_state()) next = current;
+        tick(next);
+        if (retains_state()) sync(next);
+    }
+
     /** Create a deep copy of this engine (for GameOfLife copy semantics). */
     [[nodiscard]] virtual std::unique_ptr<SimulationEngine> clone() const = 0;
 
     /** Return the engine type. */
     [[nodiscard]] virtual EngineType type() const noexcept = 0;
+
+    // --- Retained state (optional) ---
+    //
+    // Engines that keep their own representation of the universe between
+    // ticks (e.g. HashLife's quadtree) may leave the CellSet passed to tick()
+    // stale. GameOfLife asks retains_state() after each tick and, if true,
+    // calls sync() before the cells are next read.
+
+    /** True if the engine currently holds a generation newer than its CellSet. */
+    [[nodiscard]] virtual bool retains_state() const noexcept { return false; }
+
+    /** Write the retained generation into `cells`. */
+    virtual void sync(CellSet& cells) { (void)cells; }
+
+    /** Live cell count of the retained generation. */
+    [[nodiscard]] virtual size_t population() const noexcept { return 0; }
+
+    /**
+     * Set the number of worker threads used per tick (>= 1).
+     * Engines without a parallel implementation ignore this.
+     */
+    virtual void set_threads(unsigned threads) { (void)threads; }
+
+    /**
+     * Set a memory budget in bytes for engine-internal caches (> 0).
+     * Engines without bounded caches ignore this.
+     */
+    virtual void set_memory_limit(size_t bytes) { (void)bytes; }
+
+    /**
+     * Step with `rule` from now on (never a B0 rule; see parse_rule()).
+     * Any retained generation is dropped, so the next tick starts from the
+     * CellSet it is given.
+     */
+    virtual void set_rule(const Rule& rule) = 0;
+
+    /** The rule tick() applies (default B3/S23). */
+    [[nodiscard]] virtual Rule rule() const noexcept = 0;
+
+    /** Engine-specific statistics about the last tick or the run so far. */
+    [[nodiscard]] virtual std::vector<EngineCounter> counters() const { return {}; }
+
+    // --- Per-tick metrics (optional) ---
+    //
+    // Off by default, and while off engines do no work for them: anything
+    // counted inside a hot loop is compiled into a separate instantiation.
+    // While on, engines accumulate metrics over their ticks until taken.
+
+    /** Turn metrics collection on or off; either way, drop what was collected. */
+    virtual void set_metrics(bool enabled) { (void)enabled; }
+
+    /**
+     * The metrics collected since they were enabled or last taken, then start
+     * afresh. Events are summed (e.g. "memo_hits"); gauges hold their latest
+     * value (e.g. "pool_bytes"). Names are snake_case, as --metrics-json
+     * writes them.
+     */
+    [[nodiscard]] virtual std::vector<EngineCounter> take_metrics() { return {}; }
+
+    // --- Change tracking (optional) ---
+    //
+    // Off by default. While on, engines note the cells each tick turns on or
+    // off in a ChangeLog, from the work the tick does anyway: the neighbor
+    // counts see each cell's old and new state, tiles and quadtree nodes are
+    // compared with their previous generation, and unchanged ones skipped.
+    // Changes accumulate over ticks until taken; the log survives
+    // set_rule() and is copied by clone().
+
+    /**
+     * Turn change tracking on or off; either way, drop what was noted.
+     * Returns false if the engine can't track changes (the caller then
+     * compares whole generations itself).
+     */
+    virtual bool set_track_changes(bool enabled) {
+        (void)enabled;
+        return false;
+    }
+
+    /**
+     * Move the changes noted since tracking was turned on or last taken into
+     * `log`, and start afresh.
+     */
+    virtual void take_changes(ChangeLog& log) { (void)log; }
+
+    /**
+     * Add the live cells in each block of `grid` to `counts` (zeroed, sized
+     * width * height) from the engine's own spatial index, in time
+     * proportional to the blocks rather than the cells. Returns false if the
+     * engine has no such index; the caller then buckets the cells itself.
+     * Only called while retains_state() is true.
+     */
+    virtual bool count_blocks(const BlockGrid& grid, std::vector<uint64_t>& counts) const {
+        (void)grid;
+        (void)counts;
+        return false;
+    }
+
+    /**
+     * Set `box` to the bounding box of the retained generation (nullopt if
+     * it is empty) from the engine's own index. Returns false if the engine
+     * has none; the caller then scans the cells. Only called while
+     * retains_state() is true.
+     */
+    virtual bool bounding_box(std::optional<BoundingBox>& box) const {
+        (void)box;
+        return false;
+    }
+
+    /**
+     * Append the live cells inside `rect` to `out`, visiting only the part of
+     * the engine's index that overlaps it. Returns false if the engine has no
+     * spatial index. Only called while retains_state() is true.
+     */
+    virtual bool cells_in_rect(const BoundingBox& rect, std::vector<Cell>& out) const {
+        (void)rect;
+        (void)out;
+        return false;
+    }
+
+    // --- Macrocell trees (optional) ---
+    //
+    // Engines built on a quadtree can exchange Golly macrocell (.mc) files
+    // directly with their tree, so patterns far too large for a CellSet can
+    // be loaded, stepped and saved. Other engines return false.
+
+    /**
+     * Replace the universe with the macrocell tree read from `in`.
+     * @throws std::runtime_error on invalid macrocell data
+     */
+    virtual bool read_macrocell(std::istream& in) { (void)in; return false; }
+
+    /**
+     * Write the universe as a macrocell tree. `cells` is the current
+     * generation when the engine retains none of its own.
+     * @throws std::runtime_error if the universe is too large for one tree
+     */
+    virtual bool write_macrocell(std::ostream& out, const CellSet& cells) {
+        (void)out;
+        (void)cells;
+        return false;
+    }
 };
 
 /**
@@ -38,9 +218,13 @@ public:
 
 /**
  * Parse a string into an EngineType.
- * Accepts "hashtable", "sorted", "hashlife" (case-insensitive).
+ * Accepts "hashtable", "sorted", "hashlife", "hashlife-fast", "tiled", "auto"
+ * (case-insensitive).
  * @throws std::invalid_argument on unrecognized string
  */
 [[nodiscard]] EngineType parse_engine_type(std::string_view s);
 
+/** The name parse_engine_type() accepts for `type`, e.g. "hashlife-fast". */
+[[nodiscard]] const char* engine_type_name(EngineType type) noexcept;
+
 #endif // ENGINE_H
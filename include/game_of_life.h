@@ -2,13 +2,17 @@
 #define GAME_OF_LIFE_H
 
 #include <array>
+#include <cctype>
 #include <cstdint>
+#include <future>
 #include <limits>
 #include <istream>
 #include <memory>
+#include <optional>
 #include <ostream>
 #include <string>
 #include <string_view>
+#include <vector>
 
 // Use ankerl::unordered_dense for faster hash tables
 // Falls back to std::unordered_set/map if not available
@@ -76,9 +80,133 @@ inline bool has_valid_life_extension(std::string_view filename) noexcept {
     return ext == ".life" || ext == ".lif";
 }
 
+/**
+ * A cycle found by GameOfLife's cycle detection: the pattern repeats every
+ * `period` generations, shifted by (dx, dy).
+ */
+struct Cycle {
+    uint64_t period;
+    int64_t dx;
+    int64_t dy;
+};
+
+/**
+ * An inclusive rectangle of cells, min_x <= x <= max_x and min_y <= y <= max_y:
+ * the extent of a pattern, or a query region.
+ */
+struct BoundingBox {
+    int64_t min_x = 0;
+    int64_t max_x = 0;
+    int64_t min_y = 0;
+    int64_t max_y = 0;
+
+    bool contains(const Cell& cell) const noexcept {
+        return cell.x >= min_x && cell.x <= max_x && cell.y >= min_y && cell.y <= max_y;
+    }
+};
+
+/**
+ * A grid of width x height square blocks, 2^level cells on a side, for
+ * counting live cells at a coarse resolution. Block (i, j) covers
+ * x in [min_x + i * 2^level, min_x + (i + 1) * 2^level), likewise for y.
+ * Counts are stored row-major: counts[j * width + i].
+ */
+struct BlockGrid {
+    int64_t min_x = 0;
+    int64_t min_y = 0;
+    int level = 0;   // 0..62
+    int width = 0;
+    int height = 0;
+
+    /** Index into the counts of the block holding (x, y); false if outside. */
+    bool locate(int64_t x, int64_t y, size_t& index) const noexcept {
+        if (x < min_x || y < min_y) return false;
+        uint64_t bx = (static_cast<uint64_t>(x) - static_cast<uint64_t>(min_x)) >> level;
+        uint64_t by = (static_cast<uint64_t>(y) - static_cast<uint64_t>(min_y)) >> level;
+        if (bx >= static_cast<uint64_t>(width) || by >= static_cast<uint64_t>(height)) return false;
+        index = static_cast<size_t>(by) * static_cast<size_t>(width) + static_cast<size_t>(bx);
+        return true;
+    }
+};
+
+/** The cells that differ between two generations. */
+struct CellDelta {
+    std::vector<Cell> born;  // dead in the first generation, alive in the second
+    std::vector<Cell> died;  // alive in the first, dead in the second
+};
+
+/**
+ * Net changes over a run of generations, as noted by change tracking. Each
+ * birth counts +1 and each death -1, so a cell that flips back drops out and
+ * the log holds only the cells that differ: its size follows the activity,
+ * not the population. Logs folded together in any order give the same net.
+ */
+class ChangeLog {
+public:
+    /** Note that `cell` was turned on (born) or off. */
+    void flip(const Cell& cell, bool born) { add(cell, born ? 1 : -1); }
+
+    /** Move the changes in `other` into this log, leaving `other` empty. */
+    void absorb(ChangeLog& other) {
+        if (net_.empty()) {
+            std::swap(net_, other.net_);
+            return;
+        }
+        for (const auto& [cell, net] : other.net_) add(cell, net);
+        other.net_.clear();
+    }
+
+    /** Append the net births and deaths to `delta` (unsorted) and clear. */
+    void take(CellDelta& delta) {
+        for (const auto& [cell, net] : net_) {
+            (net > 0 ? delta.born : delta.died).push_back(cell);
+        }
+        net_.clear();
+    }
+
+    size_t size() const noexcept { return net_.size(); }
+    bool empty() const noexcept { return net_.empty(); }
+    void clear() { net_.clear(); }
+
+private:
+    CellCountMap net_;
+
+    void add(const Cell& cell, int amount) {
+        auto [it, added] = net_.try_emplace(cell, amount);
+        if (!added && (it->second += amount) == 0) net_.erase(it);
+    }
+};
+
+/**
+ * A Life-like (outer totalistic) rule: a dead cell with n live neighbors is
+ * born if bit n of `birth` is set, and a live one survives if bit n of
+ * `survive` is. The default is Conway's Life, B3/S23.
+ */
+struct Rule {
+    uint16_t birth = 1u << 3;
+    uint16_t survive = (1u << 2) | (1u << 3);
+
+    bool operator==(const Rule& other) const noexcept {
+        return birth == other.birth && survive == other.survive;
+    }
+    bool operator!=(const Rule& other) const noexcept { return !(*this == other); }
+};
+
+/**
+ * Parse a rule as written in RLE and macrocell headers: B/S notation
+ * ("B36/S23", any case, either order, '/' optional) or S/B notation ("23/3").
+ * @throws std::invalid_argument if malformed, or for B0 rules, which would
+ *         bring the whole infinite plane to life
+ */
+[[nodiscard]] Rule parse_rule(std::string_view text);
+
+/** `rule` in B/S notation with sorted digits, e.g. "B36/S23". */
+[[nodiscard]] std::string rule_string(const Rule& rule);
+
 // Forward declaration
 class SimulationEngine;
 enum class EngineType;
+struct EngineCounter;
 
 /**
  * Conway's Game of Life simulation.
@@ -90,6 +218,8 @@ enum class EngineType;
  * Default engine is Hashtable, preserving all existing behavior.
  *
  * Thread safety: Not thread-safe. External synchronization required for concurrent access.
+ * The one exception is tick_async(), whose worker thread only touches the
+ * engine and a back buffer while the caller keeps reading the game.
  *
  * Exception safety:
  * - parse(): Strong guarantee (throws on invalid input, no state change)
@@ -134,6 +264,44 @@ public:
     [[nodiscard]] static GameOfLife parse(std::istream& input);
     [[nodiscard]] static GameOfLife parse(std::istream& input, EngineType engine);
 
+    /**
+     * Parse a Life 1.06 file. Regular files are memory-mapped and split into
+     * newline-aligned chunks (at least 1 MiB each) parsed in parallel; other
+     * files (pipes, devices) are streamed. Errors match parse().
+     * @param path File to read
+     * @param engine Engine type to use (default: Hashtable)
+     * @param threads Parser threads (default: 1)
+     * @throws std::runtime_error if the file can't be read or has invalid format
+     */
+    [[nodiscard]] static GameOfLife parse_file(const std::string& path);
+    [[nodiscard]] static GameOfLife parse_file(const std::string& path, EngineType engine,
+                                               unsigned threads = 1);
+
+    /**
+     * Parse a run-length encoded (RLE) pattern. Requires the "x = ..., y = ..."
+     * header; a "#CXRLE Pos=x,y" line sets the top-left corner (default 0, 0).
+     * @param input Stream containing RLE data
+     * @param engine Engine type to use (default: Hashtable)
+     * @return GameOfLife instance with parsed cells
+     * The header's rule, if any, becomes the game's rule.
+     * @throws std::runtime_error on invalid format or an unsupported rule
+     */
+    [[nodiscard]] static GameOfLife parse_rle(std::istream& input);
+    [[nodiscard]] static GameOfLife parse_rle(std::istream& input, EngineType engine);
+
+    /**
+     * Parse a Golly macrocell (.mc) pattern. With a HashLife engine the tree is
+     * built directly in the node pool and never expanded into cells, so it
+     * may be far larger than any CellSet. Other engines get the expanded cells.
+     * A "#R" line sets the game's rule.
+     * @param input Stream containing macrocell data
+     * @param engine Engine type to use (default: Hashlife)
+     * @return GameOfLife instance holding the pattern
+     * @throws std::runtime_error on invalid format or an unsupported rule
+     */
+    [[nodiscard]] static GameOfLife parse_macrocell(std::istream& input);
+    [[nodiscard]] static GameOfLife parse_macrocell(std::istream& input, EngineType engine);
+
     /**
      * Check if neighbor computation would overflow for this cell.
      * Cells at INT64_MIN or INT64_MAX in either dimension would overflow
@@ -164,36 +332,274 @@ public:
     void tick();
 
     /**
-     * Run multiple generations.
+     * Run multiple generations via the engine's advance().
+     * With cycle detection enabled, once the pattern is found to repeat
+     * (possibly translated) the remaining whole periods are skipped.
      * @param iterations Number of generations to run (must be >= 0)
      * @throws std::invalid_argument if iterations < 0
      */
-    void run(int iterations);
+    void run(int64_t iterations);
+
+    /**
+     * Start computing the next generation on another thread and return at
+     * once. Until finish_tick(), the game still reads as the current
+     * generation: cells(), count(), write(), the spatial queries and copies
+     * all see it, answered from the CellSet rather than the engine, while
+     * the engine writes the next generation into a second, pre-allocated
+     * CellSet. Any call that steps or reconfigures the game finishes the
+     * pending tick first. Cycle detection does not apply.
+     * @return Ready once the next generation is computed
+     */
+    std::shared_future<void> tick_async();
+
+    /**
+     * Wait for the generation started by tick_async() and make it current by
+     * swapping the two CellSets. Does nothing if no tick is pending.
+     * @throws whatever the engine threw; the game then stays at the old
+     *         generation
+     */
+    void finish_tick();
+
+    /** True between tick_async() and finish_tick(). */
+    bool tick_pending() const noexcept { return pending_.valid(); }
+
+    /**
+     * Enable or disable cycle detection in run(). While detecting, run()
+     * steps one generation at a time and hashes each (translation-normalized)
+     * generation; a repeat within kCycleWindow generations is verified
+     * cell-for-cell before any generations are skipped.
+     */
+    void set_cycle_detection(bool enabled) noexcept { detect_cycles_ = enabled; }
+
+    /** The cycle found by run(), if any. */
+    const std::optional<Cycle>& cycle() const noexcept { return cycle_; }
+
+    /** Longest period cycle detection looks for. */
+    static constexpr uint64_t kCycleWindow = 4096;
 
     /**
      * Write current state to output stream in Life 1.06 format.
+     * Cells are formatted in parallel (see set_threads()) into per-thread
+     * buffers, each handed to the stream with one write().
      * @param out Output stream
      * @param sorted If true, sort cells by (x, y) for deterministic output
      */
     void write(std::ostream& out, bool sorted = false) const;
 
+    /**
+     * Write current state in Life 1.06 format to a file descriptor, one
+     * writev() of the per-thread buffers per round, bypassing iostreams.
+     * @param fd Open file descriptor, e.g. STDOUT_FILENO
+     * @param sorted If true, sort cells by (x, y) for deterministic output
+     * @throws std::runtime_error if the write fails
+     */
+    void write_fd(int fd, bool sorted = false) const;
+
+    /**
+     * Write current state as RLE, with a "#CXRLE Pos=x,y" line giving the
+     * top-left corner so the pattern reloads at the same coordinates.
+     * @param out Output stream
+     */
+    void write_rle(std::ostream& out) const;
+
+    /**
+     * Write current state as a Golly macrocell tree. A HashLife engine dumps
+     * its hash-consed tree without expanding it into cells.
+     * @param out Output stream
+     * @throws std::runtime_error if the pattern spans too much of the int64_t
+     *         range for one tree
+     */
+    void write_macrocell(std::ostream& out) const;
+
     /**
      * Format current state as Life 1.06 string.
      * @return String in Life 1.06 format (unsorted)
      */
     std::string format() const;
 
-    /** Get read-only access to live cells */
-    const CellSet& cells() const noexcept { return live_cells_; }
+    /**
+     * Get read-only access to live cells.
+     * Engines that retain their own state (HashLife) are synced lazily here.
+     */
+    const CellSet& cells() const {
+        if (cells_stale_) sync_cells();
+        return live_cells_;
+    }
 
     /** Get count of live cells */
-    size_t count() const noexcept { return live_cells_.size(); }
+    size_t count() const noexcept;
+
+    /**
+     * Set the number of worker threads the engine may use per tick, also
+     * used by write(), write_fd() and format().
+     * @throws std::invalid_argument if threads == 0
+     */
+    void set_threads(unsigned threads);
+
+    /** Worker threads set by set_threads() (default 1). */
+    unsigned threads() const noexcept { return threads_; }
+
+    /**
+     * Set the memory budget (bytes) for the engine's caches, e.g. the
+     * HashLife node pool. Exceeding it triggers garbage collection.
+     * @throws std::invalid_argument if bytes == 0
+     */
+    void set_memory_limit(size_t bytes);
+
+    /**
+     * Switch the rule used by tick() and run() (default B3/S23). The current
+     * cells are kept; the engine restarts from them, so retained state such
+     * as HashLife's memo is dropped, as is any cycle found under the old rule.
+     */
+    void set_rule(const Rule& rule);
+
+    /** The rule the engine steps with. */
+    Rule rule() const noexcept;
+
+    /**
+     * Engine-specific statistics (see SimulationEngine::counters()). Waits
+     * for a pending tick_async(), whose tick they then include.
+     */
+    std::vector<EngineCounter> engine_counters() const;
+
+    /**
+     * Turn per-tick metrics on or off (default off; see
+     * SimulationEngine::set_metrics()). While on, the time spent in the
+     * engine is measured too.
+     */
+    void set_metrics(bool enabled);
+
+    /**
+     * Metrics collected since they were enabled or last taken: "step_ns",
+     * the nanoseconds spent stepping, then the engine's own. Waits for a
+     * pending tick_async(). Empty while metrics are off.
+     */
+    std::vector<EngineCounter> take_metrics();
+
+    /**
+     * Turn change tracking on or off (default off); either way, drop what
+     * was collected. While on, the engine notes the cells each step turns on
+     * or off as it computes the step (see
+     * SimulationEngine::set_track_changes()), netted so that memory follows
+     * the cells that changed rather than the population. Cycle skips are
+     * included. An engine that can't track changes gets its generations
+     * compared with a copy of the last one taken instead.
+     */
+    void set_track_changes(bool enabled);
+
+    /** True while change tracking is on. */
+    bool track_changes() const noexcept { return track_changes_; }
+
+    /**
+     * The cells born and died between the generation tracking started at (or
+     * the last take) and the current one, each list sorted by (x, y); cells
+     * that changed and changed back are in neither. A pending tick_async()
+     * is not included until finished. Empty while tracking is off.
+     */
+    CellDelta take_changes();
+
+    /**
+     * Count the live cells in each block of `grid` into `counts` (resized to
+     * width * height). Engines with a spatial index (HashLife, tiled) answer
+     * from it without touching individual cells; otherwise every live cell
+     * is bucketed.
+     */
+    void count_blocks(const BlockGrid& grid, std::vector<uint64_t>& counts) const;
+
+    /**
+     * Bounding box of the live cells, or nullopt if there are none. Engines
+     * with a spatial index (sorted, HashLife, tiled) answer from it without
+     * visiting every cell; otherwise the cells are scanned. Either way the
+     * result is cached until the next generation.
+     */
+    std::optional<BoundingBox> bounding_box() const;
+
+    /**
+     * Append the live cells inside `rect` to `out`, in no particular order.
+     * HashLife and the tiled engine only visit the nodes or tiles that
+     * overlap `rect`, and the sorted engine only the columns it spans. For
+     * other engines the first query of a generation scans every cell; a
+     * second one buckets the cells into 64x64 chunks, so later queries of
+     * the same generation only touch the chunks overlapping `rect`.
+     */
+    void cells_in_rect(const BoundingBox& rect, std::vector<Cell>& out) const;
+
+    /**
+     * Call fn(const Cell&) for each live cell with x0 <= x <= x1 and
+     * y0 <= y <= y1, in no particular order (see cells_in_rect()).
+     */
+    template <typename Fn>
+    void for_each_in_rect(int64_t x0, int64_t y0, int64_t x1, int64_t y1, Fn&& fn) const {
+        std::vector<Cell> found;
+        cells_in_rect(BoundingBox{x0, x1, y0, y1}, found);
+        for (const auto& cell : found) {
+            fn(cell);
+        }
+    }
 
 private:
-    CellSet live_cells_;
+    friend void simulate_batch(std::vector<GameOfLife>& games, uint64_t generations,
+                               unsigned threads);
+
+    struct CellIndex;
+    // Mutable so that cells() can materialize an engine's retained state.
+    mutable CellSet live_cells_;
+    mutable bool cells_stale_ = false;
     std::unique_ptr<SimulationEngine> engine_;
+    unsigned threads_ = 1;
+    bool detect_cycles_ = false;
+    std::optional<Cycle> cycle_;
+    bool metrics_ = false;
+    uint64_t step_ns_ = 0;
+    size_t memory_limit_ = 0;  // set_memory_limit(), 0: the engine's default
+
+    // Change tracking: net changes taken from the engine (and cycle skips),
+    // or, if the engine can't track them, the generation to compare with
+    bool track_changes_ = false;
+    bool engine_tracks_ = false;
+    ChangeLog changes_;
+    CellSet baseline_;
+
+    // Spatial query cache for the current generation; see reset_queries()
+    mutable bool box_cached_ = false;
+    mutable std::optional<BoundingBox> box_;
+    mutable unsigned rect_queries_ = 0;
+    mutable std::unique_ptr<CellIndex> index_;
+
+    // tick_async(): the worker steps engine_ from live_cells_ into
+    // next_cells_, which finish_tick() swaps in
+    std::shared_future<void> pending_;
+    CellSet next_cells_;
+
+    void sync_cells() const;
+    bool engine_current() const noexcept;
+    void cancel_tick() noexcept;
+    void drop_engine_changes() noexcept;
+    void reset_queries() noexcept;
+    void advance_on(std::unique_ptr<SimulationEngine>& engine, uint64_t generations);
+    template <typename Fn>
+    void timed_step(Fn&& step);
+    uint64_t run_detecting_cycles(uint64_t generations);
+    uint64_t skip_cycles(uint64_t generations);
 
     static CellSet parse_cells(std::istream& input);
+    static CellSet parse_file_cells(const std::string& path, unsigned threads);
 };
 
+/**
+ * Run every game `generations` generations, as run() would, on `threads`
+ * work-stealing workers (default: one per hardware thread). Meant for many
+ * small independent patterns: each worker steps its games on one engine per
+ * engine type and memory limit, cloned from the first such game it gets, so
+ * scratch buffers carry over from pattern to pattern. Patterns are stepped
+ * single-threaded, under their game's rule, memory limit and change
+ * tracking, and each game comes back with its cells synced into its own
+ * (reset) engine. Games with metrics on are stepped on their own engine
+ * instead, so that take_metrics() covers the batch.
+ * @throws std::invalid_argument if threads == 0
+ * @throws the first exception any game throws; games may be left part-run
+ */
+void simulate_batch(std::vector<GameOfLife>& games, uint64_t generations);
+void simulate_batch(std::vector<GameOfLife>& games, uint64_t generations, unsigned threads);
+
 #endif // GAME_OF_LIFE_H
@@ -0,0 +1,139 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Number of hardware threads, at least 1. */
+inline unsigned hardware_threads() noexcept {
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+/**
+ * Run fn(i) for i in [0, count) with one thread per index.
+ * Index 0 runs on the calling thread. Returns once every call has finished;
+ * the first exception thrown by any call is rethrown here.
+ */
+template <typename Fn>
+void parallel_for(unsigned count, Fn&& fn) {
+    if (count == 0) return;
+    if (count == 1) {
+        fn(0u);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(count);
+    std::vector<std::thread> workers;
+    workers.reserve(count - 1);
+    for (unsigned i = 1; i < count; i++) {
+        workers.emplace_back([&fn, &errors, i] {
+            try {
+                fn(i);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    try {
+        fn(0u);
+    } catch (...) {
+        errors[0] = std::current_exception();
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    for (const auto& e : errors) {
+        if (e) std::rethrow_exception(e);
+    }
+}
+
+/**
+ * Run fn(i, worker) for i in [0, count) on `threads` workers (capped at
+ * count) that steal from each other, for tasks of uneven cost. Each worker
+ * starts with an equal contiguous share and takes indices from its front;
+ * once it runs dry it takes the back half of the largest share left.
+ * `worker` is in [0, threads) and no two calls with the same worker overlap,
+ * so it can index per-worker scratch. Exceptions as parallel_for(); once a
+ * call has thrown, no further calls are started.
+ */
+template <typename Fn>
+void parallel_for_stealing(size_t count, unsigned threads, Fn&& fn) {
+    if (count == 0) return;
+    unsigned n = static_cast<unsigned>(std::min<size_t>(std::max(threads, 1u), count));
+
+    struct Share {
+        std::mutex mutex;
+        size_t next = 0;
+        size_t end = 0;
+    };
+    std::unique_ptr<Share[]> shares(new Share[n]);
+    for (unsigned w = 0; w < n; w++) {
+        shares[w].next = count * w / n;
+        shares[w].end = count * (w + 1) / n;
+    }
+    std::atomic<bool> failed{false};
+
+    // Move the back half of the largest other share into our own (empty) one
+    auto steal = [&](unsigned self) {
+        while (true) {
+            unsigned victim = n;
+            size_t most = 0;
+            for (unsigned w = 0; w < n; w++) {
+                if (w == self) continue;
+                std::lock_guard<std::mutex> lock(shares[w].mutex);
+                if (shares[w].end - shares[w].next > most) {
+                    most = shares[w].end - shares[w].next;
+                    victim = w;
+                }
+            }
+            if (victim == n) return false;
+
+            size_t begin, end;
+            {
+                std::lock_guard<std::mutex> lock(shares[victim].mutex);
+                size_t left = shares[victim].end - shares[victim].next;
+                if (left == 0) continue;  // emptied meanwhile; look again
+                end = shares[victim].end;
+                begin = end - (left + 1) / 2;
+                shares[victim].end = begin;
+            }
+            std::lock_guard<std::mutex> lock(shares[self].mutex);
+            shares[self].next = begin;
+            shares[self].end = end;
+            return true;
+        }
+    };
+
+    parallel_for(n, [&](unsigned w) {
+        while (!failed.load(std::memory_order_relaxed)) {
+            size_t i = 0;
+            bool found = false;
+            {
+                std::lock_guard<std::mutex> lock(shares[w].mutex);
+                if (shares[w].next < shares[w].end) {
+                    i = shares[w].next++;
+                    found = true;
+                }
+            }
+            if (!found) {
+                if (!steal(w)) return;
+                continue;
+            }
+            try {
+                fn(i, w);
+            } catch (...) {
+                failed.store(true, std::memory_order_relaxed);
+                throw;
+            }
+        }
+    });
+}
+
+#endif // PARALLEL_H
@@ -0,0 +1,168 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include "game_of_life.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Bias-adjusted 64-bit sort keys: ((x - ox) << ybits) | (y - oy).
+// Ordering keys is the same as ordering cells by (x, y), and a key only needs
+// as many bits as the bounding box spans, which bounds the radix passes.
+struct KeySpace {
+    int64_t ox = 0;
+    int64_t oy = 0;
+    int ybits = 0;
+    int bits = 0;
+
+    // Set up keys for cells in the box and their neighbors. Returns false if
+    // the box (plus a 1-cell margin) doesn't fit in 64 bits.
+    bool init(int64_t min_x, int64_t max_x, int64_t min_y, int64_t max_y) {
+        constexpr int64_t min_val = std::numeric_limits<int64_t>::min();
+        constexpr int64_t max_val = std::numeric_limits<int64_t>::max();
+        if (min_x == min_val || max_x == max_val || min_y == min_val || max_y == max_val) {
+            return false;
+        }
+        uint64_t span_x = static_cast<uint64_t>(max_x) - static_cast<uint64_t>(min_x) + 2;
+        uint64_t span_y = static_cast<uint64_t>(max_y) - static_cast<uint64_t>(min_y) + 2;
+        if (span_x >= (uint64_t(1) << 62) || span_y >= (uint64_t(1) << 62)) {
+            return false;
+        }
+        int xbits = 64 - __builtin_clzll(span_x);
+        ybits = 64 - __builtin_clzll(span_y);
+        bits = xbits + ybits;
+        ox = min_x - 1;
+        oy = min_y - 1;
+        return bits <= 64;
+    }
+
+    uint64_t encode(int64_t x, int64_t y) const noexcept {
+        uint64_t dx = static_cast<uint64_t>(x) - static_cast<uint64_t>(ox);
+        uint64_t dy = static_cast<uint64_t>(y) - static_cast<uint64_t>(oy);
+        return (dx << ybits) | dy;
+    }
+
+    Cell decode(uint64_t key) const noexcept {
+        uint64_t dx = key >> ybits;
+        uint64_t dy = key & ((uint64_t(1) << ybits) - 1);
+        return {static_cast<int64_t>(static_cast<uint64_t>(ox) + dx),
+                static_cast<int64_t>(static_cast<uint64_t>(oy) + dy)};
+    }
+};
+
+// Below this many keys the radix sort runs single-threaded.
+constexpr size_t kParallelMinKeys = size_t(1) << 16;
+
+// LSD radix sort of `keys` on their low `bits` bits, 11 bits per pass.
+// `tmp` and `counts` are scratch. With threads > 1 each pass histograms and
+// scatters per-thread slices in parallel. Passes where every key has the
+// same digit are skipped.
+inline void radix_sort(std::vector<uint64_t>& keys, std::vector<uint64_t>& tmp,
+                std::vector<size_t>& counts, int bits, unsigned threads) {
+    constexpr int kDigitBits = 11;
+    constexpr size_t kBuckets = size_t(1) << kDigitBits;
+
+    const size_t n = keys.size();
+    if (n < 2) return;
+    if (n < kParallelMinKeys) threads = 1;
+    tmp.resize(n);
+    counts.resize(threads * kBuckets);
+
+    for (int shift = 0; shift < bits; shift += kDigitBits) {
+        std::fill(counts.begin(), counts.end(), 0);
+        parallel_for(threads, [&](unsigned t) {
+            size_t* count = &counts[t * kBuckets];
+            for (size_t i = n * t / threads, end = n * (t + 1) / threads; i < end; i++) {
+                ++count[(keys[i] >> shift) & (kBuckets - 1)];
+            }
+        });
+
+        // Exclusive prefix sums, bucket-major then thread, so each thread
+        // scatters its slice into its own runs (keeps the sort stable).
+        size_t offset = 0;
+        bool single_digit = false;
+        for (size_t b = 0; b < kBuckets; b++) {
+            size_t bucket_total = 0;
+            for (unsigned t = 0; t < threads; t++) {
+                size_t c = counts[t * kBuckets + b];
+                counts[t * kBuckets + b] = offset;
+                offset += c;
+                bucket_total += c;
+            }
+            single_digit = single_digit || bucket_total == n;
+        }
+        if (single_digit) continue;
+
+        parallel_for(threads, [&](unsigned t) {
+            size_t* pos = &counts[t * kBuckets];
+            for (size_t i = n * t / threads, end = n * (t + 1) / threads; i < end; i++) {
+                tmp[pos[(keys[i] >> shift) & (kBuckets - 1)]++] = keys[i];
+            }
+        });
+        keys.swap(tmp);
+    }
+}
+
+// Below this many cells sort_cells() sorts single-threaded.
+constexpr size_t kParallelMinSortCells = size_t(1) << 16;
+
+// Sort cells by (x, y). Radix sorts packed keys when the bounding box fits in
+// 64 bits; otherwise sorts per-thread slices and merges them pairwise.
+inline void sort_cells(std::vector<Cell>& cells, unsigned threads) {
+    if (cells.size() < 2) return;
+    threads = cells.size() < kParallelMinSortCells ? 1 : std::max(threads, 1u);
+
+    int64_t min_x = cells[0].x, max_x = min_x;
+    int64_t min_y = cells[0].y, max_y = min_y;
+    for (const auto& cell : cells) {
+        min_x = std::min(min_x, cell.x);
+        max_x = std::max(max_x, cell.x);
+        min_y = std::min(min_y, cell.y);
+        max_y = std::max(max_y, cell.y);
+    }
+
+    KeySpace space;
+    if (space.init(min_x, max_x, min_y, max_y)) {
+        const size_t n = cells.size();
+        std::vector<uint64_t> keys(n);
+        std::vector<uint64_t> scratch;
+        std::vector<size_t> counts;
+        parallel_for(threads, [&](unsigned t) {
+            for (size_t i = n * t / threads, end = n * (t + 1) / threads; i < end; i++) {
+                keys[i] = space.encode(cells[i].x, cells[i].y);
+            }
+        });
+        radix_sort(keys, scratch, counts, space.bits, threads);
+        parallel_for(threads, [&](unsigned t) {
+            for (size_t i = n * t / threads, end = n * (t + 1) / threads; i < end; i++) {
+                cells[i] = space.decode(keys[i]);
+            }
+        });
+        return;
+    }
+
+    auto less = [](const Cell& a, const Cell& b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    };
+    std::vector<size_t> bounds(threads + 1);
+    for (unsigned t = 0; t <= threads; t++) {
+        bounds[t] = cells.size() * t / threads;
+    }
+    parallel_for(threads, [&](unsigned t) {
+        std::sort(cells.begin() + bounds[t], cells.begin() + bounds[t + 1], less);
+    });
+    for (size_t width = 1; width < threads; width *= 2) {
+        unsigned merges = static_cast<unsigned>((threads + 2 * width - 1) / (2 * width));
+        parallel_for(merges, [&](unsigned m) {
+            size_t lo = 2 * width * m;
+            size_t mid = std::min(lo + width, size_t(threads));
+            size_t hi = std::min(lo + 2 * width, size_t(threads));
+            std::inplace_merge(cells.begin() + bounds[lo], cells.begin() + bounds[mid],
+                               cells.begin() + bounds[hi], less);
+        });
+    }
+}
+
+#endif // RADIX_SORT_H
@@ -2,8 +2,14 @@
 #define LIFE_RENDERER_H
 
 #include "game_of_life.h"
-#include <string>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 /**
  * Configuration for rendering Game of Life frames to PNG images.
@@ -20,6 +26,152 @@ struct RenderConfig {
     bool show_grid = false;         // Draw grid lines
     int64_t max_pixels = 16 * 1024 * 1024;  // Maximum total pixels (16 megapixels)
     int64_t max_cells_dimension = 10000;    // Max cells in either dimension
+    bool downsample = true;         // Wider viewports: one pixel per 2^k block, shaded by density
+};
+
+/**
+ * An RGBA image, one uint32_t per pixel in RenderConfig color order.
+ */
+struct Frame {
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> pixels;  // Row-major, width * height
+};
+
+/**
+ * Renders frames of one fixed viewport. The image geometry and background
+ * (dead cells and grid lines) are computed once, so each frame costs a copy
+ * of the background plus the live cells in view, which are fetched with
+ * GameOfLife::cells_in_rect().
+ *
+ * Viewports over max_cells_dimension cells in either direction are drawn
+ * downsampled (if config.downsample): each pixel covers a 2^k x 2^k block,
+ * shaded between dead_color and alive_color by its live-cell density. The
+ * densities come from GameOfLife::count_blocks(), so with HashLife or the
+ * tiled engine a frame costs O(pixels) rather than O(cells).
+ */
+class FrameRenderer {
+public:
+    /**
+     * @param config Rendering configuration (output_dir is unused)
+     * @param min_x Minimum x coordinate of viewport
+     * @param max_x Maximum x coordinate of viewport
+     * @param min_y Minimum y coordinate of viewport
+     * @param max_y Maximum y coordinate of viewport
+     */
+    FrameRenderer(const RenderConfig& config, int64_t min_x, int64_t max_x,
+                  int64_t min_y, int64_t max_y);
+
+    /** false if the viewport is too large or invalid to render. */
+    [[nodiscard]] bool valid() const noexcept { return valid_; }
+
+    int width() const noexcept { return width_; }
+    int height() const noexcept { return height_; }
+
+    /** True if the viewport is drawn downsampled, one pixel per block. */
+    [[nodiscard]] bool downsampled() const noexcept { return density_; }
+
+    /** Render `game` into `frame`, reusing its pixel buffer. */
+    void render(const GameOfLife& game, Frame& frame);
+
+private:
+    int64_t min_x_;
+    int64_t min_y_;
+    int64_t width_cells_ = 0;
+    int64_t height_cells_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+    int cell_size_ = 0;
+    uint32_t alive_color_;
+    bool draw_grid_ = false;
+    bool valid_ = false;
+    std::vector<uint32_t> background_;
+    std::vector<Cell> visible_;  // cells fetched for the current frame
+
+    // Downsampled rendering
+    bool density_ = false;
+    BlockGrid blocks_;
+    std::vector<uint64_t> counts_;
+    uint32_t shades_[256] = {};
+
+    void init_density(const RenderConfig& config, int64_t min_x, int64_t max_x,
+                      int64_t min_y, int64_t max_y);
+};
+
+/**
+ * Render Game of Life state into an RGBA frame with a fixed viewport.
+ * The frame's pixel buffer is reused when it is large enough, so rendering
+ * many frames into one Frame allocates once.
+ *
+ * @param game Current game state
+ * @param config Rendering configuration (output_dir is unused)
+ * @param min_x Minimum x coordinate of viewport
+ * @param max_x Maximum x coordinate of viewport
+ * @param min_y Minimum y coordinate of viewport
+ * @param max_y Maximum y coordinate of viewport
+ * @param frame Output image
+ * @return true if successful, false if the viewport is too large or invalid
+ */
+[[nodiscard]] bool render_pixels(const GameOfLife& game, const RenderConfig& config,
+                                 int64_t min_x, int64_t max_x,
+                                 int64_t min_y, int64_t max_y, Frame& frame);
+
+/**
+ * Write a rendered frame as output_dir/frame_NNNNN.png.
+ *
+ * @param frame Rendered image
+ * @param config Rendering configuration
+ * @param frame_number Frame number (used for filename)
+ * @return true if successful, false on error
+ */
+[[nodiscard]] bool write_png(const Frame& frame, const RenderConfig& config, int frame_number);
+
+/**
+ * A pool of threads compressing frames to PNG files, so the caller can keep
+ * simulating while earlier frames are encoded.
+ *
+ * submit() blocks while kQueuedFramesPerThread frames per thread are
+ * waiting (backpressure), and swaps the frame's buffer for a recycled one
+ * instead of copying it.
+ */
+class PngEncoder {
+public:
+    /**
+     * @param config Rendering configuration (files go to output_dir)
+     * @param threads Encoder threads, at least 1
+     */
+    PngEncoder(const RenderConfig& config, unsigned threads);
+    ~PngEncoder();
+
+    PngEncoder(const PngEncoder&) = delete;
+    PngEncoder& operator=(const PngEncoder&) = delete;
+
+    /**
+     * Queue `frame` to be written as frame_NNNNN.png. On return `frame`
+     * holds a spare buffer to render the next frame into.
+     */
+    void submit(Frame& frame, int frame_number);
+
+    /**
+     * Wait for every queued frame to be written and stop the threads.
+     * @return Frame numbers that failed to write, in ascending order
+     */
+    std::vector<int> finish();
+
+    static constexpr size_t kQueuedFramesPerThread = 2;
+
+private:
+    RenderConfig config_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::pair<int, Frame>> queue_;  // frame number, image
+    std::vector<Frame> spare_;
+    std::vector<int> failed_;
+    size_t capacity_;
+    bool closing_ = false;
+
+    void encode_loop();
 };
 
 /**
@@ -0,0 +1,116 @@
+#ifndef LIFE_RULE_H
+#define LIFE_RULE_H
+
+#include "bitboard.h"
+#include "game_of_life.h"
+#include <cstdint>
+#include <type_traits>
+
+// =============================================================================
+// Compile-time rules for the engines' inner loops
+//
+// A rule type has `birth` and `survive` masks (bit n: n live neighbors).
+// FixedRule holds them as compile-time constants, so a mask test in a hot
+// loop folds away; RuntimeRule holds them as data, for any other rule.
+// with_rule() calls a generic lambda with the FixedRule for the common rules
+// and RuntimeRule otherwise:
+//
+//   with_rule(rule_, [&](auto rule) { step(rule); });
+// =============================================================================
+
+template <uint16_t Birth, uint16_t Survive>
+struct FixedRule {
+    static constexpr uint16_t birth = Birth;
+    static constexpr uint16_t survive = Survive;
+};
+
+struct RuntimeRule {
+    uint16_t birth;
+    uint16_t survive;
+};
+
+using LifeRule = FixedRule<0x008, 0x00C>;      // B3/S23
+using HighLifeRule = FixedRule<0x048, 0x00C>;  // B36/S23
+using DayNightRule = FixedRule<0x1C8, 0x1D8>;  // B3678/S34678
+using SeedsRule = FixedRule<0x004, 0x000>;     // B2/S
+
+template <typename Fn>
+decltype(auto) with_rule(const Rule& rule, Fn&& fn) {
+    auto is = [&](auto fixed) {
+        return rule.birth == fixed.birth && rule.survive == fixed.survive;
+    };
+    if (is(LifeRule{})) return fn(LifeRule{});
+    if (is(HighLifeRule{})) return fn(HighLifeRule{});
+    if (is(DayNightRule{})) return fn(DayNightRule{});
+    if (is(SeedsRule{})) return fn(SeedsRule{});
+    return fn(RuntimeRule{rule.birth, rule.survive});
+}
+
+/**
+ * Next state of a cell with `count` live neighbors. is_alive() is only
+ * called for counts where birth and survival differ, so a hash or search
+ * for the cell is skipped wherever the rule doesn't need it.
+ */
+template <typename R, typename IsAlive>
+inline bool next_state(const R& rule, unsigned count, IsAlive&& is_alive) {
+    const bool born = (rule.birth >> count) & 1u;
+    const bool kept = (rule.survive >> count) & 1u;
+    if (born == kept) return born;
+    return is_alive() ? kept : born;
+}
+
+/**
+ * life_row() for any rule: the neighbor count is summed into four bit
+ * planes and each count the rule lists is matched against them. B3/S23
+ * keeps life_row()'s shorter circuit.
+ */
+template <typename R>
+inline uint64_t rule_row(const R& rule, uint64_t a0, uint64_t a1, uint64_t a2,
+                         uint64_t b0, uint64_t alive, uint64_t b2,
+                         uint64_t c0, uint64_t c1, uint64_t c2) noexcept {
+    if constexpr (std::is_same_v<R, LifeRule>) {
+        (void)rule;
+        return life_row(a0, a1, a2, b0, alive, b2, c0, c1, c2);
+    } else {
+        // As in life_row(): count = ones + 2 * (ca + cb + cc + carry)
+        uint64_t sa = a0 ^ a1 ^ a2;
+        uint64_t ca = (a0 & a1) | (a2 & (a0 ^ a1));
+        uint64_t sb = b0 ^ b2;
+        uint64_t cb = b0 & b2;
+        uint64_t sc = c0 ^ c1 ^ c2;
+        uint64_t cc = (c0 & c1) | (c2 & (c0 ^ c1));
+        uint64_t ones = sa ^ sb ^ sc;
+        uint64_t carry = (sa & sb) | (sc & (sa ^ sb));
+
+        // Add the four twos-bits: twos + 2 * (k1 + k2 + k3)
+        uint64_t s1 = ca ^ cb, k1 = ca & cb;
+        uint64_t s2 = cc ^ carry, k2 = cc & carry;
+        uint64_t twos = s1 ^ s2, k3 = s1 & s2;
+        uint64_t fours = k1 ^ k2 ^ k3;
+        uint64_t eights = (k1 & k2) | (k3 & (k1 ^ k2));
+
+        uint64_t born = 0, kept = 0;
+        for (unsigned n = 0; n <= 8; n++) {
+            if (!(((rule.birth | rule.survive) >> n) & 1u)) continue;
+            uint64_t is_n = (n & 1 ? ones : ~ones) & (n & 2 ? twos : ~twos) &
+                            (n & 4 ? fours : ~fours) & (n & 8 ? eights : ~eights);
+            if ((rule.birth >> n) & 1u) born |= is_n;
+            if ((rule.survive >> n) & 1u) kept |= is_n;
+        }
+        return (born & ~alive) | (kept & alive);
+    }
+}
+
+/** life_8x8() for any rule. */
+template <typename R>
+inline uint64_t rule_8x8(const R& rule, uint64_t board) noexcept {
+    constexpr uint64_t kNotColumn0 = 0xfefefefefefefefeULL;
+    constexpr uint64_t kNotColumn7 = 0x7f7f7f7f7f7f7f7fULL;
+    uint64_t left = (board << 1) & kNotColumn0;
+    uint64_t right = (board >> 1) & kNotColumn7;
+    return rule_row(rule, left << 8, board << 8, right << 8,
+                    left, board, right,
+                    left >> 8, board >> 8, right >> 8);
+}
+
+#endif // LIFE_RULE_H
@@ -0,0 +1,94 @@
+#ifndef LIFE_VIDEO_H
+#define LIFE_VIDEO_H
+
+#include "renderer.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+/**
+ * ffmpeg output arguments (filters, codec, pixel format) for the container
+ * named by the file extension: .mp4 (default), .webm, .gif or .mov.
+ *
+ * @param output_path Video file to write
+ * @return Arguments to place between ffmpeg's input and the output path
+ */
+std::vector<std::string> ffmpeg_output_args(const std::string& output_path);
+
+/**
+ * Streams raw RGBA frames into a child process's stdin, normally ffmpeg
+ * reading "-f rawvideo -pix_fmt rgba". No frames touch the disk.
+ *
+ * Frames are queued and written by a background thread, so the caller can
+ * simulate and render the next frame while the pipe drains. write_frame()
+ * swaps the frame's buffer for a recycled one instead of copying it.
+ *
+ * Errors are reported by return value: once the child stops reading (or
+ * exits), write_frame() and finish() return false.
+ */
+class VideoStream {
+public:
+    VideoStream() = default;
+    ~VideoStream();
+
+    VideoStream(const VideoStream&) = delete;
+    VideoStream& operator=(const VideoStream&) = delete;
+
+    /**
+     * Start `argv` (looked up on PATH) with a pipe on its stdin and its
+     * stdout/stderr sent to /dev/null.
+     *
+     * @param argv Program and arguments
+     * @param width Frame width in pixels; every frame must match
+     * @param height Frame height in pixels; every frame must match
+     * @return true if the process was started
+     */
+    [[nodiscard]] bool open(const std::vector<std::string>& argv, int width, int height);
+
+    /**
+     * Start ffmpeg encoding width x height RGBA frames at `fps` into
+     * `output_path` (overwritten).
+     *
+     * @return true if ffmpeg was started
+     */
+    [[nodiscard]] bool open_ffmpeg(const std::string& output_path, int fps, int width, int height);
+
+    /**
+     * Queue a frame, blocking while kMaxQueuedFrames are already waiting.
+     * On return `frame` holds a spare buffer to render the next frame into.
+     *
+     * @return false if the frame size doesn't match or the pipe has failed
+     */
+    [[nodiscard]] bool write_frame(Frame& frame);
+
+    /**
+     * Write the remaining frames, close the pipe and wait for the child.
+     *
+     * @return true if every frame was written and the child exited with 0
+     */
+    [[nodiscard]] bool finish();
+
+    /** Frames the writer thread may hold before write_frame() blocks. */
+    static constexpr size_t kMaxQueuedFrames = 3;
+
+private:
+    pid_t pid_ = -1;
+    int fd_ = -1;
+    int width_ = 0;
+    int height_ = 0;
+    std::thread writer_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Frame> queue_;     // frames waiting to be written
+    std::vector<Frame> spare_;    // written frames, recycled by write_frame()
+    bool closing_ = false;
+    bool failed_ = false;
+
+    void write_loop();
+};
+
+#endif // LIFE_VIDEO_H
@@ -0,0 +1,287 @@
+#include "delta_stream.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kMagic[8] = {'L', 'I', 'F', 'E', 'D', 'L', 'T', 'A'};
+constexpr std::string_view kTextHeader = "#Life Delta 1";
+
+// Buffered output is handed to the stream once it passes this size
+constexpr size_t kFlushBytes = size_t(1) << 20;
+
+// Counts are trusted this far for reserve(); larger lists grow as read
+constexpr size_t kMaxReserve = size_t(1) << 20;
+
+inline uint64_t zigzag(uint64_t delta) noexcept {
+    return (delta << 1) ^ (0 - (delta >> 63));
+}
+
+inline uint64_t unzigzag(uint64_t value) noexcept {
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+void put_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+template <typename T>
+void put_number(std::string& out, T value) {
+    char digits[24];
+    out.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+[[noreturn]] void throw_invalid(const std::string& what) {
+    throw std::runtime_error("Invalid delta stream: " + what);
+}
+
+uint64_t read_varint(std::streambuf& in) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = in.sbumpc();
+        if (byte == std::char_traits<char>::eof()) throw_invalid("truncated frame");
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw_invalid("over-long varint");
+}
+
+// Split off the next space-separated field of `line`
+std::string_view next_field(std::string_view& line) {
+    size_t start = line.find_first_not_of(' ');
+    if (start == std::string_view::npos) return {};
+    line.remove_prefix(start);
+    size_t end = std::min(line.find(' '), line.size());
+    std::string_view field = line.substr(0, end);
+    line.remove_prefix(end);
+    return field;
+}
+
+template <typename T>
+T parse_field(std::string_view& line, const char* what) {
+    std::string_view field = next_field(line);
+    T value{};
+    auto [ptr, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+    if (field.empty() || ec != std::errc() || ptr != field.data() + field.size()) {
+        throw_invalid(std::string("bad ") + what + " '" + std::string(field) + "'");
+    }
+    return value;
+}
+
+} // anonymous namespace
+
+DeltaFormat parse_delta_format(std::string_view s) {
+    if (s == "text") return DeltaFormat::Text;
+    if (s == "binary") return DeltaFormat::Binary;
+    throw std::invalid_argument("Unknown delta format '" + std::string(s) +
+                                "' (expected text or binary)");
+}
+
+// --- Writer ---
+
+DeltaWriter::DeltaWriter(std::ostream& out, DeltaFormat format) : out_(out), format_(format) {
+    if (format_ == DeltaFormat::Text) {
+        buffer_.append(kTextHeader).push_back('\n');
+    } else {
+        buffer_.append(kMagic, sizeof(kMagic));
+        for (int i = 0; i < 4; i++) {
+            buffer_.push_back(static_cast<char>(kDeltaStreamVersion >> (8 * i)));
+        }
+    }
+    flush_buffer();
+    out_.flush();
+}
+
+void DeltaWriter::keyframe(uint64_t generation, const std::vector<Cell>& cells) {
+    if (format_ == DeltaFormat::Text) {
+        buffer_ += "K ";
+        put_number(buffer_, generation);
+        buffer_ += ' ';
+        put_number(buffer_, cells.size());
+        buffer_ += '\n';
+    } else {
+        buffer_ += 'K';
+        put_varint(buffer_, generation);
+    }
+    put_cells(cells, "");
+    ++keyframes_;
+    end_frame();
+}
+
+void DeltaWriter::delta(uint64_t generation, const CellDelta& changes) {
+    if (format_ == DeltaFormat::Text) {
+        buffer_ += "D ";
+        put_number(buffer_, generation);
+        buffer_ += ' ';
+        put_number(buffer_, changes.born.size());
+        buffer_ += ' ';
+        put_number(buffer_, changes.died.size());
+        buffer_ += '\n';
+    } else {
+        buffer_ += 'D';
+        put_varint(buffer_, generation);
+    }
+    put_cells(changes.born, "+");
+    put_cells(changes.died, "-");
+    end_frame();
+}
+
+void DeltaWriter::put_cells(const std::vector<Cell>& cells, const char* prefix) {
+    if (format_ == DeltaFormat::Binary) put_varint(buffer_, cells.size());
+    uint64_t prev_x = 0, prev_y = 0;
+    for (const auto& cell : cells) {
+        if (format_ == DeltaFormat::Text) {
+            buffer_ += prefix;
+            put_number(buffer_, cell.x);
+            buffer_ += ' ';
+            put_number(buffer_, cell.y);
+            buffer_ += '\n';
+        } else {
+            uint64_t x = static_cast<uint64_t>(cell.x);
+            uint64_t y = static_cast<uint64_t>(cell.y);
+            put_varint(buffer_, x - prev_x);
+            put_varint(buffer_, x == prev_x && &cell != cells.data() ? y - prev_y - 1
+                                                                     : zigzag(y - prev_y));
+            prev_x = x;
+            prev_y = y;
+        }
+        if (buffer_.size() >= kFlushBytes) flush_buffer();
+    }
+}
+
+void DeltaWriter::flush_buffer() {
+    out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    if (!out_) throw std::runtime_error("Failed to write delta stream");
+    bytes_ += buffer_.size();
+    buffer_.clear();
+}
+
+void DeltaWriter::end_frame() {
+    flush_buffer();
+    out_.flush();
+    if (!out_) throw std::runtime_error("Failed to write delta stream");
+    ++frames_;
+}
+
+// --- Reader ---
+
+DeltaReader::DeltaReader(std::istream& in) : in_(in) {
+    int first = in_.peek();
+    if (first == kMagic[0]) {
+        char header[sizeof(kMagic) + 4];
+        if (!in_.read(header, sizeof(header)) || std::memcmp(header, kMagic, sizeof(kMagic)) != 0) {
+            throw_invalid("missing 'LIFEDLTA' header");
+        }
+        uint32_t version = 0;
+        for (int i = 0; i < 4; i++) {
+            version |= uint32_t(static_cast<unsigned char>(header[sizeof(kMagic) + i])) << (8 * i);
+        }
+        if (version != kDeltaStreamVersion) {
+            throw_invalid("unsupported version " + std::to_string(version));
+        }
+        format_ = DeltaFormat::Binary;
+        return;
+    }
+    if (!std::getline(in_, line_) || line_ != kTextHeader) {
+        throw_invalid("missing '" + std::string(kTextHeader) + "' header");
+    }
+    format_ = DeltaFormat::Text;
+}
+
+bool DeltaReader::next(DeltaFrame& frame) {
+    frame.born.clear();
+    frame.died.clear();
+    return format_ == DeltaFormat::Text ? next_text(frame) : next_binary(frame);
+}
+
+bool DeltaReader::next_text(DeltaFrame& frame) {
+    if (!std::getline(in_, line_)) return false;
+    std::string_view line = line_;
+    std::string_view kind = next_field(line);
+    if (kind != "K" && kind != "D") {
+        throw_invalid("expected a K or D record, got '" + line_ + "'");
+    }
+    frame.keyframe = kind == "K";
+    frame.generation = parse_field<uint64_t>(line, "generation");
+    size_t born = parse_field<size_t>(line, "cell count");
+    size_t died = frame.keyframe ? 0 : parse_field<size_t>(line, "cell count");
+    read_text_cells(born, frame.keyframe ? '\0' : '+', frame.born);
+    read_text_cells(died, '-', frame.died);
+    return true;
+}
+
+void DeltaReader::read_text_cells(size_t count, char sign, std::vector<Cell>& cells) {
+    cells.reserve(std::min(count, kMaxReserve));
+    for (size_t i = 0; i < count; i++) {
+        if (!std::getline(in_, line_)) throw_invalid("truncated frame");
+        std::string_view line = line_;
+        if (sign != '\0') {
+            if (line.empty() || line[0] != sign) {
+                throw_invalid(std::string("expected a '") + sign + "' line, got '" + line_ + "'");
+            }
+            line.remove_prefix(1);
+        }
+        int64_t x = parse_field<int64_t>(line, "x");
+        int64_t y = parse_field<int64_t>(line, "y");
+        if (!next_field(line).empty()) throw_invalid("trailing text in '" + line_ + "'");
+        cells.push_back({x, y});
+    }
+}
+
+bool DeltaReader::next_binary(DeltaFrame& frame) {
+    std::streambuf& in = *in_.rdbuf();
+    int kind = in.sbumpc();
+    if (kind == std::char_traits<char>::eof()) return false;
+    if (kind != 'K' && kind != 'D') {
+        throw_invalid("unknown frame kind " + std::to_string(kind));
+    }
+    frame.keyframe = kind == 'K';
+    frame.generation = read_varint(in);
+    read_binary_cells(frame.born);
+    if (!frame.keyframe) read_binary_cells(frame.died);
+    return true;
+}
+
+void DeltaReader::read_binary_cells(std::vector<Cell>& cells) {
+    std::streambuf& in = *in_.rdbuf();
+    uint64_t count = read_varint(in);
+    cells.reserve(static_cast<size_t>(std::min<uint64_t>(count, kMaxReserve)));
+    uint64_t x = 0, y = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t dx = read_varint(in);
+        uint64_t dy = read_varint(in);
+        x += dx;
+        y = dx == 0 && i > 0 ? y + dy + 1 : y + unzigzag(dy);
+        cells.push_back({static_cast<int64_t>(x), static_cast<int64_t>(y)});
+    }
+}
+
+void apply_delta_frame(const DeltaFrame& frame, CellSet& cells) {
+    if (frame.keyframe) {
+        cells.clear();
+        cells.reserve(frame.born.size());
+        cells.insert(frame.born.begin(), frame.born.end());
+        return;
+    }
+    for (const auto& cell : frame.born) {
+        if (!cells.insert(cell).second) {
+            throw std::runtime_error("Delta at generation " + std::to_string(frame.generation) +
+                                     ": born cell " + std::to_string(cell.x) + " " +
+                                     std::to_string(cell.y) + " is already alive");
+        }
+    }
+    for (const auto& cell : frame.died) {
+        if (cells.erase(cell) == 0) {
+            throw std::runtime_error("Delta at generation " + std::to_string(frame.generation) +
+                                     ": dead cell " + std::to_string(cell.x) + " " +
+                                     std::to_string(cell.y) + " was not alive");
+        }
+    }
+}
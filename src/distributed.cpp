@@ -0,0 +1,640 @@
+#include "distributed.h"
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int64_t kMinX = std::numeric_limits<int64_t>::min();
+constexpr int64_t kMaxX = std::numeric_limits<int64_t>::max();
+
+// Cells per message when loading and gathering
+constexpr size_t kBatchCells = 1 << 16;
+
+// x values each rank samples when the stripes are rebalanced
+constexpr size_t kSampleCells = 4096;
+
+// Below this many cells per rank, imbalance isn't worth a rebalance
+constexpr uint64_t kMinRebalanceCells = 1024;
+
+// Coordinator -> rank commands. Every command but kCells and kStop is
+// answered with kOk and its results, or kFailed and a message.
+enum Command : uint64_t { kCells = 1, kStep, kSample, kRebalance, kMigrate, kSave, kGather, kStop };
+enum Status : uint64_t { kOk = 0, kFailed = 1 };
+
+// Blocking message I/O on a stream socket: uint64 words and arrays of
+// trivially copyable values, in host byte order (every rank runs on this
+// host). Errors, including the peer closing the socket, throw.
+class Channel {
+public:
+    Channel() = default;
+    explicit Channel(int fd) noexcept : fd_(fd) {}
+
+    bool connected() const noexcept { return fd_ >= 0; }
+
+    void put(uint64_t value) { write_all(&value, sizeof(value)); }
+
+    uint64_t get() {
+        uint64_t value;
+        read_all(&value, sizeof(value));
+        return value;
+    }
+
+    template <typename T>
+    void put_array(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        put(values.size());
+        write_all(values.data(), values.size() * sizeof(T));
+    }
+
+    /** Append an array sent by put_array() to `values`. */
+    template <typename T>
+    void get_array(std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        size_t count = get();
+        size_t old_size = values.size();
+        values.resize(old_size + count);
+        read_all(values.data() + old_size, count * sizeof(T));
+    }
+
+    void put_string(const std::string& text) {
+        put_array(std::vector<char>(text.begin(), text.end()));
+    }
+
+    std::string get_string() {
+        std::vector<char> text;
+        get_array(text);
+        return std::string(text.begin(), text.end());
+    }
+
+    /** Unblock any thread reading or writing the socket. */
+    void shutdown() noexcept {
+        if (fd_ >= 0) ::shutdown(fd_, SHUT_RDWR);
+    }
+
+private:
+    int fd_ = -1;
+
+    void write_all(const void* data, size_t bytes) {
+        const char* pos = static_cast<const char*>(data);
+        while (bytes > 0) {
+            // MSG_NOSIGNAL: a closed peer is an error here, not a SIGPIPE
+            ssize_t sent = ::send(fd_, pos, bytes, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("socket write failed: ") + std::strerror(errno));
+            }
+            pos += sent;
+            bytes -= static_cast<size_t>(sent);
+        }
+    }
+
+    void read_all(void* data, size_t bytes) {
+        char* pos = static_cast<char*>(data);
+        while (bytes > 0) {
+            ssize_t got = ::recv(fd_, pos, bytes, 0);
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("socket read failed: ") + std::strerror(errno));
+            }
+            if (got == 0) throw std::runtime_error("connection closed");
+            pos += got;
+            bytes -= static_cast<size_t>(got);
+        }
+    }
+};
+
+// Send to both neighbors while receiving from both, appending what arrives
+// to `received`. The sends run on their own thread: two neighbors sending
+// large halos to each other would otherwise both block on full buffers.
+void exchange(Channel& left, Channel& right, const std::vector<Cell>& to_left,
+              const std::vector<Cell>& to_right, std::vector<Cell>& received) {
+    auto sending = std::async(std::launch::async, [&] {
+        if (left.connected()) left.put_array(to_left);
+        if (right.connected()) right.put_array(to_right);
+    });
+    try {
+        if (left.connected()) left.get_array(received);
+        if (right.connected()) right.get_array(received);
+    } catch (...) {
+        left.shutdown();
+        right.shutdown();
+        sending.wait();
+        throw;
+    }
+    sending.get();
+}
+
+// x as an offset from kMinX, which orders like x and can't overflow
+inline uint64_t offset_of(int64_t x) noexcept {
+    return static_cast<uint64_t>(x) - static_cast<uint64_t>(kMinX);
+}
+
+inline int64_t from_offset(uint64_t offset) noexcept {
+    return static_cast<int64_t>(offset + static_cast<uint64_t>(kMinX));
+}
+
+// Stripe starts (the first is kMinX) at the weighted quantiles of
+// `samples`, sorted by x, each stripe after the first at least `halo`
+// columns wide so that halos only ever come from direct neighbors. Starts
+// are pushed up past the previous stripe and down below kMaxX as needed,
+// which needs (ranks - 1) * halo < 2^64 (see DistributedLife()).
+std::vector<int64_t> balanced_starts(const std::vector<std::pair<int64_t, double>>& samples,
+                                     unsigned ranks, uint64_t halo) {
+    double total = 0;
+    for (const auto& sample : samples) {
+        total += sample.second;
+    }
+    std::vector<int64_t> starts(ranks, kMinX);
+    uint64_t previous = 0;
+    double seen = 0;
+    size_t i = 0;
+    for (unsigned r = 1; r < ranks; r++) {
+        double target = total * r / ranks;
+        while (i < samples.size() && seen + samples[i].second <= target) {
+            seen += samples[i++].second;
+        }
+        uint64_t start = i < samples.size() ? offset_of(samples[i].first)
+                         : samples.empty() ? offset_of(0)
+                                           : offset_of(samples.back().first) + 1;
+        // Room for this stripe and the ranks - r after it, halo columns each
+        uint64_t latest = std::numeric_limits<uint64_t>::max() - (ranks - r) * halo + 1;
+        start = std::min(std::max(start, previous + halo), latest);
+        starts[r] = from_offset(start);
+        previous = start;
+    }
+    return starts;
+}
+
+// Last column of stripe r of `starts`
+int64_t stripe_end(const std::vector<int64_t>& starts, size_t r) noexcept {
+    return r + 1 < starts.size() ? from_offset(offset_of(starts[r + 1]) - 1) : kMaxX;
+}
+
+// --- Rank ---
+
+// One worker process: owns the columns [lo, hi] and steps them on its own
+// engine, serving the coordinator's commands until told to stop
+class Rank {
+public:
+    Rank(const DistributedOptions& options, int64_t lo, int64_t hi, Channel control, Channel left,
+         Channel right)
+        : options_(options), lo_(lo), hi_(hi), control_(control), left_(left), right_(right),
+          engine_(create_engine(options.engine)) {
+        engine_->set_threads(options.threads);
+        engine_->set_rule(options.rule);
+    }
+
+    void serve() {
+        for (;;) {
+            uint64_t command = control_.get();
+            try {
+                if (command == kStop) return;
+                if (command == kCells) {
+                    std::vector<Cell> batch;
+                    control_.get_array(batch);
+                    cells_.insert(batch.begin(), batch.end());
+                    continue;
+                }
+                handle(command);
+            } catch (const std::exception& e) {
+                control_.put(kFailed);
+                control_.put_string(e.what());
+                throw;
+            }
+        }
+    }
+
+private:
+    const DistributedOptions& options_;
+    int64_t lo_;
+    int64_t hi_;
+    Channel control_;
+    Channel left_;
+    Channel right_;
+    std::unique_ptr<SimulationEngine> engine_;
+    CellSet cells_;
+    std::vector<Cell> transit_;  // cells on their way to another stripe
+
+    bool inside(const Cell& cell) const noexcept { return cell.x >= lo_ && cell.x <= hi_; }
+
+    void handle(uint64_t command) {
+        switch (command) {
+            case kStep: {
+                uint64_t generations = control_.get();
+                uint64_t sent = step(generations);
+                control_.put(kOk);
+                control_.put(cells_.size());
+                control_.put(sent);
+                break;
+            }
+            case kSample: {
+                // Every stride-th cell's x, so each sample stands for `stride` cells
+                uint64_t stride = std::max<uint64_t>(1, cells_.size() / kSampleCells);
+                std::vector<int64_t> xs;
+                uint64_t i = 0;
+                for (const auto& cell : cells_) {
+                    if (i++ % stride == 0) xs.push_back(cell.x);
+                }
+                control_.put(kOk);
+                control_.put(cells_.size());
+                control_.put_array(xs);
+                break;
+            }
+            case kRebalance: {
+                lo_ = static_cast<int64_t>(control_.get());
+                hi_ = static_cast<int64_t>(control_.get());
+                move_outside(transit_);
+                control_.put(kOk);
+                control_.put(transit_.size());
+                control_.put(cells_.size());
+                break;
+            }
+            case kMigrate: {
+                // One hop towards each cell's stripe
+                std::vector<Cell> to_left, to_right, received;
+                for (const auto& cell : transit_) {
+                    (cell.x < lo_ ? to_left : to_right).push_back(cell);
+                }
+                exchange(left_, right_, to_left, to_right, received);
+                transit_.clear();
+                for (const auto& cell : received) {
+                    if (inside(cell)) {
+                        cells_.insert(cell);
+                    } else {
+                        transit_.push_back(cell);
+                    }
+                }
+                control_.put(kOk);
+                control_.put(to_left.size() + to_right.size());
+                control_.put(transit_.size());
+                control_.put(cells_.size());
+                break;
+            }
+            case kSave: {
+                std::string path = control_.get_string();
+                uint64_t generation = control_.get();
+                save_snapshot(cells_, path, generation, options_.threads);
+                control_.put(kOk);
+                break;
+            }
+            case kGather: {
+                control_.put(kOk);
+                std::vector<Cell> batch;
+                batch.reserve(std::min(cells_.size(), kBatchCells));
+                for (const auto& cell : cells_) {
+                    batch.push_back(cell);
+                    if (batch.size() == kBatchCells) {
+                        control_.put_array(batch);
+                        batch.clear();
+                    }
+                }
+                if (!batch.empty()) control_.put_array(batch);
+                control_.put_array(std::vector<Cell>());
+                break;
+            }
+            default:
+                throw std::runtime_error("unknown command " + std::to_string(command));
+        }
+    }
+
+    // Exchange k-column halos, step k generations, keep the stripe. Returns
+    // the number of halo cells sent.
+    uint64_t step(uint64_t k) {
+        std::vector<Cell> to_left, to_right, received;
+        for (const auto& cell : cells_) {
+            uint64_t from_lo = static_cast<uint64_t>(cell.x) - static_cast<uint64_t>(lo_);
+            uint64_t to_hi = static_cast<uint64_t>(hi_) - static_cast<uint64_t>(cell.x);
+            if (left_.connected() && from_lo < k) to_left.push_back(cell);
+            if (right_.connected() && to_hi < k) to_right.push_back(cell);
+        }
+        exchange(left_, right_, to_left, to_right, received);
+        cells_.insert(received.begin(), received.end());
+
+        engine_->advance(cells_, k);
+        if (engine_->retains_state()) engine_->sync(cells_);
+        // Cells outside the stripe are the neighbors' or, near the halo's
+        // outer edge, wrong; and the engine restarts from cells_ next time
+        std::vector<Cell> outside;
+        move_outside(outside);
+        engine_->set_rule(options_.rule);
+        return to_left.size() + to_right.size();
+    }
+
+    void move_outside(std::vector<Cell>& out) {
+        size_t first = out.size();
+        for (const auto& cell : cells_) {
+            if (!inside(cell)) out.push_back(cell);
+        }
+        for (size_t i = first; i < out.size(); i++) {
+            cells_.erase(out[i]);
+        }
+    }
+};
+
+} // anonymous namespace
+
+// --- DistributedLife ---
+
+DistributedLife::DistributedLife(const CellSet& cells, const DistributedOptions& options,
+                                 uint64_t generation)
+    : options_(options), generation_(generation), last_rebalance_(generation) {
+    if (options_.ranks == 0) throw std::invalid_argument("Rank count must be positive");
+    if (options_.halo == 0) throw std::invalid_argument("Halo width must be positive");
+    uint64_t spanned;
+    if (__builtin_mul_overflow(uint64_t(options_.ranks - 1), options_.halo, &spanned)) {
+        throw std::invalid_argument("Halo width too large for " + std::to_string(options_.ranks) +
+                                    " ranks");
+    }
+    options_.threads = std::max(options_.threads, 1u);
+
+    // Stripes at the x quantiles of (a sample of) the cells
+    size_t stride = std::max<size_t>(1, cells.size() / (kSampleCells * options_.ranks));
+    std::vector<std::pair<int64_t, double>> samples;
+    size_t i = 0;
+    for (const auto& cell : cells) {
+        if (i++ % stride == 0) samples.emplace_back(cell.x, 1.0);
+    }
+    std::sort(samples.begin(), samples.end());
+    starts_ = balanced_starts(samples, options_.ranks, options_.halo);
+
+    start_workers();
+    try {
+        std::vector<std::vector<Cell>> batches(options_.ranks);
+        populations_.assign(options_.ranks, 0);
+        for (const auto& cell : cells) {
+            auto rank = static_cast<size_t>(
+                std::upper_bound(starts_.begin(), starts_.end(), cell.x) - starts_.begin() - 1);
+            batches[rank].push_back(cell);
+            ++populations_[rank];
+            if (batches[rank].size() == kBatchCells) {
+                Channel control = Channel(workers_[rank].control);
+                control.put(kCells);
+                control.put_array(batches[rank]);
+                batches[rank].clear();
+            }
+        }
+        for (unsigned r = 0; r < options_.ranks; r++) {
+            if (batches[r].empty()) continue;
+            Channel control = Channel(workers_[r].control);
+            control.put(kCells);
+            control.put_array(batches[r]);
+        }
+    } catch (...) {
+        stop_workers();
+        throw;
+    }
+}
+
+DistributedLife::~DistributedLife() {
+    stop_workers();
+}
+
+namespace {
+
+// Read a rank's status word, turning kFailed (or a dead rank) into an exception
+void expect_ok(Channel& control, unsigned rank) {
+    std::string error;
+    try {
+        if (control.get() == kOk) return;
+        error = control.get_string();
+    } catch (const std::exception&) {
+        error = "exited unexpectedly";
+    }
+    throw std::runtime_error("Rank " + std::to_string(rank) + ": " + error);
+}
+
+} // anonymous namespace
+
+void DistributedLife::start_workers() {
+    unsigned ranks = options_.ranks;
+    // controls[r]: {coordinator end, rank end}; links[r]: {rank r end, rank r+1 end}
+    std::vector<std::pair<int, int>> controls, links;
+    auto close_all = [&] {
+        for (auto& [a, b] : controls) {
+            if (a >= 0) close(a);
+            if (b >= 0) close(b);
+        }
+        for (auto& [a, b] : links) {
+            close(a);
+            close(b);
+        }
+    };
+    auto make_pair = [&](std::vector<std::pair<int, int>>& out) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+            close_all();
+            throw std::runtime_error(std::string("Cannot create sockets: ") + std::strerror(errno));
+        }
+        out.emplace_back(fds[0], fds[1]);
+    };
+    for (unsigned r = 0; r < ranks; r++) {
+        make_pair(controls);
+        if (r + 1 < ranks) make_pair(links);
+    }
+
+    // Output buffered before the fork would otherwise be written by every rank
+    std::fflush(nullptr);
+    for (unsigned r = 0; r < ranks; r++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            int error = errno;
+            close_all();
+            stop_workers();
+            throw std::runtime_error(std::string("Cannot start rank: ") + std::strerror(error));
+        }
+        if (pid == 0) {
+            // Keep only this rank's sockets, so that a rank exiting is seen
+            // as end-of-file by its neighbors and the coordinator
+            int control = controls[r].second;
+            int left = r > 0 ? links[r - 1].second : -1;
+            int right = r + 1 < ranks ? links[r].first : -1;
+            for (auto& [a, b] : controls) {
+                close(a);
+                if (b != control) close(b);
+            }
+            for (auto& [a, b] : links) {
+                if (a != right) close(a);
+                if (b != left) close(b);
+            }
+            for (const auto& worker : workers_) {
+                close(worker.control);
+            }
+            int status = 0;
+            try {
+                int64_t lo = starts_[r];
+                int64_t hi = stripe_end(starts_, r);
+                Rank(options_, lo, hi, Channel(control), Channel(left), Channel(right)).serve();
+            } catch (...) {
+                status = 1;
+            }
+            _exit(status);
+        }
+        workers_.push_back({pid, controls[r].first});
+        controls[r].first = -1;
+    }
+    for (auto& control : controls) {
+        close(control.second);
+        control.second = -1;
+    }
+    close_all();
+}
+
+void DistributedLife::stop_workers() noexcept {
+    for (auto& worker : workers_) {
+        try {
+            Channel(worker.control).put(kStop);
+        } catch (...) {
+            // Already gone; closing the socket is enough
+        }
+        close(worker.control);
+    }
+    for (auto& worker : workers_) {
+        int status;
+        while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR) {
+        }
+    }
+    workers_.clear();
+}
+
+uint64_t DistributedLife::count() const noexcept {
+    uint64_t total = 0;
+    for (uint64_t population : populations_) {
+        total += population;
+    }
+    return total;
+}
+
+void DistributedLife::run(uint64_t generations) {
+    while (generations > 0) {
+        uint64_t k = std::min(generations, options_.halo);
+        for (const auto& worker : workers_) {
+            Channel control = Channel(worker.control);
+            control.put(kStep);
+            control.put(k);
+        }
+        for (unsigned r = 0; r < workers_.size(); r++) {
+            Channel control = Channel(workers_[r].control);
+            expect_ok(control, r);
+            populations_[r] = control.get();
+            stats_.halo_cells += control.get();
+        }
+        ++stats_.exchanges;
+        generations -= k;
+        generation_ += k;
+        maybe_rebalance();
+    }
+}
+
+void DistributedLife::maybe_rebalance() {
+    unsigned ranks = static_cast<unsigned>(workers_.size());
+    if (options_.imbalance <= 0 || ranks < 2 ||
+        generation_ - last_rebalance_ < options_.rebalance_every) {
+        return;
+    }
+    uint64_t total = count();
+    uint64_t largest = *std::max_element(populations_.begin(), populations_.end());
+    if (total < kMinRebalanceCells * ranks ||
+        static_cast<double>(largest) <= options_.imbalance * static_cast<double>(total) / ranks) {
+        return;
+    }
+    last_rebalance_ = generation_;
+
+    for (const auto& worker : workers_) {
+        Channel(worker.control).put(kSample);
+    }
+    std::vector<std::pair<int64_t, double>> samples;
+    for (unsigned r = 0; r < ranks; r++) {
+        Channel control = Channel(workers_[r].control);
+        expect_ok(control, r);
+        uint64_t population = control.get();
+        std::vector<int64_t> xs;
+        control.get_array(xs);
+        for (int64_t x : xs) {
+            samples.emplace_back(x, static_cast<double>(population) / static_cast<double>(xs.size()));
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    std::vector<int64_t> starts = balanced_starts(samples, ranks, options_.halo);
+    if (starts == starts_) return;
+    starts_ = std::move(starts);
+
+    for (unsigned r = 0; r < ranks; r++) {
+        Channel control = Channel(workers_[r].control);
+        control.put(kRebalance);
+        control.put(static_cast<uint64_t>(starts_[r]));
+        control.put(static_cast<uint64_t>(stripe_end(starts_, r)));
+    }
+    uint64_t pending = 0;
+    for (unsigned r = 0; r < ranks; r++) {
+        Channel control = Channel(workers_[r].control);
+        expect_ok(control, r);
+        pending += control.get();
+        populations_[r] = control.get();
+    }
+    // Each round moves every migrating cell one stripe closer to its own
+    while (pending > 0) {
+        for (const auto& worker : workers_) {
+            Channel(worker.control).put(kMigrate);
+        }
+        pending = 0;
+        for (unsigned r = 0; r < ranks; r++) {
+            Channel control = Channel(workers_[r].control);
+            expect_ok(control, r);
+            stats_.migrated_cells += control.get();
+            pending += control.get();
+            populations_[r] = control.get();
+        }
+    }
+    ++stats_.rebalances;
+}
+
+void DistributedLife::for_each_batch(const std::function<void(const std::vector<Cell>&)>& fn) {
+    std::vector<Cell> batch;
+    for (unsigned r = 0; r < workers_.size(); r++) {
+        Channel control = Channel(workers_[r].control);
+        control.put(kGather);
+        expect_ok(control, r);
+        for (;;) {
+            batch.clear();
+            control.get_array(batch);
+            if (batch.empty()) break;
+            fn(batch);
+        }
+    }
+}
+
+std::vector<std::string> DistributedLife::save_shards(const std::string& prefix) {
+    std::vector<std::string> paths;
+    for (unsigned r = 0; r < workers_.size(); r++) {
+        paths.push_back(shard_path(prefix, r));
+        Channel control = Channel(workers_[r].control);
+        control.put(kSave);
+        control.put_string(paths.back());
+        control.put(generation_);
+    }
+    for (unsigned r = 0; r < workers_.size(); r++) {
+        Channel control = Channel(workers_[r].control);
+        expect_ok(control, r);
+    }
+    return paths;
+}
+
+std::string DistributedLife::shard_path(const std::string& prefix, unsigned rank) {
+    char digits[16];
+    std::snprintf(digits, sizeof(digits), "%04u", rank);
+    return prefix + "." + digits + ".snap";
+}
@@ -7,6 +7,9 @@
 std::unique_ptr<SimulationEngine> create_hashtable_engine();
 std::unique_ptr<SimulationEngine> create_sorted_vector_engine();
 std::unique_ptr<SimulationEngine> create_hashlife_engine();
+std::unique_ptr<SimulationEngine> create_hashlife_fast_engine();
+std::unique_ptr<SimulationEngine> create_tiled_engine();
+std::unique_ptr<SimulationEngine> create_auto_engine();
 
 std::unique_ptr<SimulationEngine> create_engine(EngineType type) {
     switch (type) {
@@ -16,6 +19,12 @@ std::unique_ptr<SimulationEngine> create_engine(EngineType type) {
             return create_sorted_vector_engine();
         case EngineType::Hashlife:
             return create_hashlife_engine();
+        case EngineType::HashlifeFast:
+            return create_hashlife_fast_engine();
+        case EngineType::Tiled:
+            return create_tiled_engine();
+        case EngineType::Auto:
+            return create_auto_engine();
     }
     // Unreachable, but satisfy compilers
     return create_hashtable_engine();
@@ -30,8 +39,23 @@ EngineType parse_engine_type(std::string_view s) {
     if (lower == "hashtable") return EngineType::Hashtable;
     if (lower == "sorted")    return EngineType::Sorted;
     if (lower == "hashlife")  return EngineType::Hashlife;
+    if (lower == "hashlife-fast") return EngineType::HashlifeFast;
+    if (lower == "tiled")     return EngineType::Tiled;
+    if (lower == "auto")      return EngineType::Auto;
 
     throw std::invalid_argument(
         "Unknown engine type '" + std::string(s) +
-        "'. Valid options: hashtable, sorted, hashlife");
+        "'. Valid options: hashtable, sorted, hashlife, hashlife-fast, tiled, auto");
+}
+
+const char* engine_type_name(EngineType type) noexcept {
+    switch (type) {
+        case EngineType::Hashtable:    return "hashtable";
+        case EngineType::Sorted:       return "sorted";
+        case EngineType::Hashlife:     return "hashlife";
+        case EngineType::HashlifeFast: return "hashlife-fast";
+        case EngineType::Tiled:        return "tiled";
+        case EngineType::Auto:         return "auto";
+    }
+    return "unknown";
 }
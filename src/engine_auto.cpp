@@ -0,0 +1,403 @@
+#include "engine.h"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Auto engine: picks the engine it predicts is fastest, and keeps picking
+//
+// The universe lives in one inner engine at a time; every SimulationEngine
+// call is forwarded to it. advance() runs in epochs. Before each epoch the
+// pattern is measured:
+//
+//   - population, and its trend over the last two epochs
+//   - occupied 64x64 tiles: how many separate clusters the cells form, and
+//     so how dense they are locally. Engines with a spatial index count
+//     them with count_blocks(); otherwise the cells are bucketed
+//   - bounding box: the tiled engine can't bit-pack cells near the int64_t
+//     limits
+//
+// and a cost per generation is predicted for each candidate:
+//
+//   hashtable  ~ population / threads   (its counting is sharded by thread)
+//   tiled      ~ kTileCost * tiles      (a tile costs about kTileCost cells)
+//
+// A pattern whose population has settled over two epochs of at least
+// kSettledEpoch generations (ash, oscillators, spaceships), with at least
+// kLeapGenerations still to run, goes to hashlife-fast, whose power-of-two
+// jumps make the rest of the run cost about log(generations). It stays there
+// while the population keeps within 1/kSettledShare per epoch.
+//
+// The current engine is only replaced by one predicted kSwitchMargin times
+// cheaper. Migration syncs the retained generation into the CellSet, which
+// the new engine loads on its first step. Epochs start at kMinEpoch
+// generations and double while the choice holds (up to kMaxEpoch, without
+// limit on hashlife-fast so long runs keep long jumps), and shrink back to
+// kMinEpoch after a switch. Sorted and plain hashlife never win on the
+// benchmark patterns, so they are not candidates.
+// =============================================================================
+
+namespace {
+
+constexpr uint64_t kMinEpoch = 32;
+constexpr uint64_t kMaxEpoch = 1024;
+constexpr uint64_t kLeapGenerations = 1024;
+// Trends are only trusted over epochs at least this long
+constexpr uint64_t kSettledEpoch = 256;
+constexpr uint64_t kTileCost = 6;
+constexpr uint64_t kSwitchMargin = 2;
+// A settled population changes by at most 1/kSettledShare per epoch
+constexpr size_t kSettledShare = 32;
+// Retained universes larger than this (e.g. loaded macrocell trees) are never
+// expanded into cells just to be measured
+constexpr size_t kMaxMeasured = size_t(1) << 26;
+// Largest bounding box, in tiles, measured through the engine's count_blocks()
+constexpr int64_t kMaxIndexedTiles = int64_t(1) << 16;
+// Switches listed individually in counters()
+constexpr size_t kMaxLoggedSwitches = 16;
+
+constexpr int kTileBits = 6;
+constexpr int64_t kMinTile = (std::numeric_limits<int64_t>::min() >> kTileBits) + 2;
+constexpr int64_t kMaxTile = (std::numeric_limits<int64_t>::max() >> kTileBits) - 2;
+
+constexpr EngineType kCandidates[] = {EngineType::Hashtable, EngineType::Tiled,
+                                      EngineType::HashlifeFast};
+
+size_t candidate_index(EngineType type) {
+    for (size_t i = 0; i < std::size(kCandidates); i++) {
+        if (kCandidates[i] == type) return i;
+    }
+    return 0;
+}
+
+} // anonymous namespace
+
+class AutoEngine : public SimulationEngine {
+public:
+    AutoEngine() { current_ = engine(EngineType::Hashtable).get(); }
+
+    void tick(CellSet& cells) override {
+        advance(cells, 1);
+    }
+
+    void advance(CellSet& cells, uint64_t generations) override {
+        while (generations > 0) {
+            if (until_evaluation_ == 0) evaluate(cells, generations);
+            uint64_t chunk = std::min(generations, until_evaluation_);
+            current_->advance(cells, chunk);
+            generations -= chunk;
+            stepped(chunk);
+        }
+    }
+
+    // Evaluations may sync into the cells, so they get the default's copy
+    void tick_into(const CellSet& current, CellSet& next) override {
+        if (until_evaluation_ == 0) {
+            SimulationEngine::tick_into(current, next);
+            return;
+        }
+        current_->tick_into(current, next);
+        stepped(1);
+    }
+
+    [[nodiscard]] std::unique_ptr<SimulationEngine> clone() const override {
+        auto copy = std::make_unique<AutoEngine>();
+        copy->threads_ = threads_;
+        copy->memory_limit_ = memory_limit_;
+        copy->set_rule(rule_);
+        copy->set_metrics(metrics_);
+        copy->set_track_changes(track_changes_);
+        copy->changes_ = changes_;
+        return copy;
+    }
+
+    [[nodiscard]] EngineType type() const noexcept override {
+        return EngineType::Auto;
+    }
+
+    [[nodiscard]] bool retains_state() const noexcept override {
+        return current_->retains_state();
+    }
+
+    void sync(CellSet& cells) override {
+        current_->sync(cells);
+    }
+
+    [[nodiscard]] size_t population() const noexcept override {
+        return current_->population();
+    }
+
+    void set_threads(unsigned threads) override {
+        threads_ = std::max(threads, 1u);
+        for (auto& engine : engines_) {
+            if (engine) engine->set_threads(threads_);
+        }
+    }
+
+    void set_memory_limit(size_t bytes) override {
+        memory_limit_ = bytes;
+        for (auto& engine : engines_) {
+            if (engine) engine->set_memory_limit(bytes);
+        }
+    }
+
+    void set_metrics(bool enabled) override {
+        metrics_ = enabled;
+        switches_taken_ = switches_.size();
+        for (auto& engine : engines_) {
+            if (engine) engine->set_metrics(enabled);
+        }
+    }
+
+    // Every engine tracks; the current one's changes are moved into the
+    // auto engine's own log after each step, before any switch
+    bool set_track_changes(bool enabled) override {
+        track_changes_ = enabled;
+        changes_.clear();
+        for (auto& engine : engines_) {
+            if (engine) engine->set_track_changes(enabled);
+        }
+        return true;
+    }
+
+    void take_changes(ChangeLog& log) override {
+        log.absorb(changes_);
+    }
+
+    // The current engine's metrics; those of engines switched away from
+    // since the last take are dropped
+    std::vector<EngineCounter> take_metrics() override {
+        std::vector<EngineCounter> out = {{"auto_switches", switches_.size() - switches_taken_}};
+        switches_taken_ = switches_.size();
+        for (auto& engine : engines_) {
+            if (!engine) continue;
+            std::vector<EngineCounter> metrics = engine->take_metrics();
+            if (engine.get() == current_) {
+                out.insert(out.end(), metrics.begin(), metrics.end());
+            }
+        }
+        return out;
+    }
+
+    // Drops the retained generation, so the pattern is measured afresh
+    void set_rule(const Rule& rule) override {
+        rule_ = rule;
+        for (auto& engine : engines_) {
+            if (engine) engine->set_rule(rule);
+        }
+        restart();
+    }
+
+    [[nodiscard]] Rule rule() const noexcept override {
+        return rule_;
+    }
+
+    // Auto's own decisions first, then the current engine's counters
+    [[nodiscard]] std::vector<EngineCounter> counters() const override {
+        std::vector<EngineCounter> out;
+        out.push_back({"Auto evaluations", evaluations_});
+        out.push_back({"Auto switches", switches_.size()});
+        for (size_t i = 0; i < switches_.size() && i < kMaxLoggedSwitches; i++) {
+            out.push_back({"Switched to " + std::string(engine_type_name(switches_[i].to)) +
+                               " at generation",
+                           switches_[i].generation});
+        }
+        for (size_t i = 0; i < std::size(kCandidates); i++) {
+            if (generations_on_[i] == 0) continue;
+            out.push_back({"Generations on " + std::string(engine_type_name(kCandidates[i])),
+                           generations_on_[i]});
+        }
+        for (auto& counter : current_->counters()) {
+            out.push_back(std::move(counter));
+        }
+        return out;
+    }
+
+    bool count_blocks(const BlockGrid& grid, std::vector<uint64_t>& counts) const override {
+        return current_->count_blocks(grid, counts);
+    }
+
+    bool bounding_box(std::optional<BoundingBox>& box) const override {
+        return current_->bounding_box(box);
+    }
+
+    bool cells_in_rect(const BoundingBox& rect, std::vector<Cell>& out) const override {
+        return current_->cells_in_rect(rect, out);
+    }
+
+    // Macrocell trees are loaded into hashlife-fast, never expanded; the first
+    // evaluation decides whether they stay there.
+    bool read_macrocell(std::istream& in) override {
+        auto& tree = engine(EngineType::HashlifeFast);
+        bool read = tree->read_macrocell(in);
+        rule_ = tree->rule();
+        for (auto& engine : engines_) {
+            if (engine && engine != tree) engine->set_rule(rule_);
+        }
+        restart();
+        current_ = tree.get();
+        return read;
+    }
+
+    bool write_macrocell(std::ostream& out, const CellSet& cells) override {
+        return current_->write_macrocell(out, cells);
+    }
+
+private:
+    struct Switch {
+        EngineType to;
+        uint64_t generation;
+    };
+
+    std::unique_ptr<SimulationEngine> engines_[std::size(kCandidates)];
+    SimulationEngine* current_ = nullptr;
+    unsigned threads_ = 1;
+    size_t memory_limit_ = 0;
+    Rule rule_;
+    bool metrics_ = false;
+    size_t switches_taken_ = 0;
+    bool track_changes_ = false;
+    ChangeLog changes_;
+
+    uint64_t generation_ = 0;
+    uint64_t epoch_ = 0;
+    uint64_t until_evaluation_ = 0;
+    // Populations at the last two evaluations, newest first
+    std::optional<size_t> history_[2];
+    uint64_t evaluations_ = 0;
+    std::vector<Switch> switches_;
+    uint64_t generations_on_[std::size(kCandidates)] = {};
+
+    std::unique_ptr<SimulationEngine>& engine(EngineType type) {
+        auto& slot = engines_[candidate_index(type)];
+        if (!slot) {
+            slot = create_engine(type);
+            slot->set_threads(threads_);
+            if (memory_limit_ > 0) slot->set_memory_limit(memory_limit_);
+            slot->set_rule(rule_);
+            slot->set_metrics(metrics_);
+            slot->set_track_changes(track_changes_);
+        }
+        return slot;
+    }
+
+    void stepped(uint64_t generations) {
+        if (track_changes_) current_->take_changes(changes_);
+        until_evaluation_ -= generations;
+        generation_ += generations;
+        generations_on_[candidate_index(current_->type())] += generations;
+    }
+
+    void restart() {
+        epoch_ = 0;
+        until_evaluation_ = 0;
+        history_[0].reset();
+        history_[1].reset();
+    }
+
+    // Choose the engine for the next epoch, with `remaining` generations
+    // left in the current advance()
+    void evaluate(CellSet& cells, uint64_t remaining) {
+        evaluations_++;
+        size_t population = current_->retains_state() ? current_->population() : cells.size();
+        // Once on hashlife-fast, it stays until the population moves
+        bool settled = current_->type() == EngineType::HashlifeFast
+                           ? history_[0] && is_settled(*history_[0], population)
+                           : epoch_ >= kSettledEpoch && history_[0] && history_[1] &&
+                                 is_settled(*history_[1], *history_[0]) &&
+                                 is_settled(*history_[0], population);
+        history_[1] = history_[0];
+        history_[0] = population;
+
+        EngineType choice = current_->type();
+        if (settled && (remaining >= kLeapGenerations ||
+                        current_->type() == EngineType::HashlifeFast)) {
+            choice = EngineType::HashlifeFast;
+        } else if (population <= kMaxMeasured) {
+            choice = cheapest(cells, population);
+        }
+
+        if (choice != current_->type()) {
+            if (current_->retains_state()) current_->sync(cells);
+            // Drop the old engine's generation, keeping its buffers for later
+            current_->set_rule(rule_);
+            current_ = engine(choice).get();
+            switches_.push_back({choice, generation_});
+            epoch_ = kMinEpoch;
+        } else if (epoch_ == 0) {
+            epoch_ = kMinEpoch;
+        } else if (choice == EngineType::HashlifeFast) {
+            epoch_ = epoch_ > std::numeric_limits<uint64_t>::max() / 2 ? epoch_ : epoch_ * 2;
+        } else {
+            epoch_ = std::min(epoch_ * 2, kMaxEpoch);
+        }
+        until_evaluation_ = epoch_;
+    }
+
+    static bool is_settled(size_t before, size_t after) {
+        size_t change = before > after ? before - after : after - before;
+        return change * kSettledShare <= before;
+    }
+
+    // Occupied 64x64 tiles, from the current engine's spatial index when it
+    // has one and the pattern spans at most kMaxIndexedTiles of them,
+    // otherwise by bucketing the cells. Nullopt if any is near the limits.
+    std::optional<size_t> count_tiles(CellSet& cells) const {
+        std::optional<BoundingBox> box;
+        if (current_->retains_state() && current_->bounding_box(box)) {
+            if (!box) return 0;
+            if (box->min_x >> kTileBits < kMinTile || box->max_x >> kTileBits > kMaxTile ||
+                box->min_y >> kTileBits < kMinTile || box->max_y >> kTileBits > kMaxTile) {
+                return std::nullopt;
+            }
+            int64_t width = (box->max_x >> kTileBits) - (box->min_x >> kTileBits) + 1;
+            int64_t height = (box->max_y >> kTileBits) - (box->min_y >> kTileBits) + 1;
+            if (width * height <= kMaxIndexedTiles) {
+                BlockGrid grid{(box->min_x >> kTileBits) * 64, (box->min_y >> kTileBits) * 64,
+                               kTileBits, static_cast<int>(width), static_cast<int>(height)};
+                std::vector<uint64_t> counts(static_cast<size_t>(width * height), 0);
+                if (current_->count_blocks(grid, counts)) {
+                    return static_cast<size_t>(
+                        std::count_if(counts.begin(), counts.end(), [](uint64_t n) { return n > 0; }));
+                }
+            }
+        }
+
+        if (current_->retains_state()) current_->sync(cells);
+        CellSet tiles;
+        for (const auto& cell : cells) {
+            Cell tile{cell.x >> kTileBits, cell.y >> kTileBits};
+            if (tile.x < kMinTile || tile.x > kMaxTile || tile.y < kMinTile || tile.y > kMaxTile) {
+                return std::nullopt;
+            }
+            tiles.insert(tile);
+        }
+        return tiles.size();
+    }
+
+    // Cheaper of hashtable and tiled for `cells`, with kSwitchMargin in favor
+    // of whichever is current
+    EngineType cheapest(CellSet& cells, size_t population) const {
+        std::optional<size_t> tiles = count_tiles(cells);
+        if (!tiles) return EngineType::Hashtable;
+
+        uint64_t hashtable_cost = population / threads_ + 1;
+        uint64_t tiled_cost = kTileCost * *tiles + 1;
+        switch (current_->type()) {
+            case EngineType::Hashtable:
+                return tiled_cost * kSwitchMargin < hashtable_cost ? EngineType::Tiled
+                                                                   : EngineType::Hashtable;
+            case EngineType::Tiled:
+                return hashtable_cost * kSwitchMargin < tiled_cost ? EngineType::Hashtable
+                                                                   : EngineType::Tiled;
+            default:
+                return tiled_cost < hashtable_cost ? EngineType::Tiled : EngineType::Hashtable;
+        }
+    }
+};
+
+std::unique_ptr<SimulationEngine> create_auto_engine() {
+    return std::make_unique<AutoEngine>();
+}
@@ -1,88 +1,248 @@
 #include "engine.h"
+#include "bitboard.h"
+#include "rule.h"
 #include <algorithm>
 #include <cassert>
+#include <charconv>
 #include <cstdint>
-#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 // =============================================================================
 // HashLife engine: memoized quadtree with hash-consing
 //
-// Uses spatial clustering to handle widely separated cell groups efficiently.
-// Each cluster is stepped independently via a quadtree-based algorithm.
+// The quadtree root and the hash-cons table persist across ticks, so the
+// step1_result memo carries over from one generation to the next. The tree is
+// only rebuilt when the engine has no retained generation, and is flattened
+// back into a CellSet only when the cells are read (see sync()).
 //
-// slow_step(): Advance exactly 1 generation using the 9-subquadrant
-//   decomposition with center extraction (not recursive stepping) to
-//   avoid the standard HashLife 2^(k-2) step doubling.
+// Universes spanning most of the int64_t range fall back to spatial
+// clustering, stepping each cluster independently with a throwaway root.
+//
+// step(node, j): Advance a level-k node by 2^j generations (j <= k-2).
+//   For j < k-2 this uses the 9-subquadrant decomposition with center
+//   extraction (no simulation) and recurses at the same step size; at
+//   j == k-2 it is the classic recursive HashLife result().
+//
+// Leaves are bit-packed: a level-2 node is a 4x4 block stored as a 16-bit
+// mask, canonicalized through a 65536-entry table (there are no level-0 or
+// level-1 nodes). Level-3 nodes are stepped by assembling their four leaves
+// into an 8x8 uint64_t and running the bitwise kernel from bitboard.h.
+//
+// The default engine only ever steps with j == 0 (one generation per tick).
+// The superspeed engine ("hashlife-fast") splits advance(n) into
+// power-of-two jumps, taking the largest jump that fits each time.
 // =============================================================================
 
 namespace {
 
 struct QuadNode {
-    int level;          // 0 = single cell
+    int16_t level;      // 2 = 4x4 leaf (the smallest node)
+    uint16_t bits;      // leaf cells, bit (4 * y + x); 0 above level 2
+    uint32_t index;     // position in the pool's arena
     int64_t population; // number of alive cells
     QuadNode* nw;
     QuadNode* ne;
     QuadNode* sw;
     QuadNode* se;
     QuadNode* step1_result; // memoized 1-gen advance result
+    QuadNode* result;       // memoized 2^(level-2)-gen advance result
 };
 
-struct QuadNodeHash {
-    size_t operator()(const QuadNode& n) const noexcept {
-        auto h = std::hash<const void*>{};
-        size_t seed = h(n.nw);
-        seed ^= h(n.ne) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-        seed ^= h(n.sw) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-        seed ^= h(n.se) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-        return seed;
-    }
-};
-
-struct QuadNodeEqual {
-    bool operator()(const QuadNode& a, const QuadNode& b) const noexcept {
-        return a.nw == b.nw && a.ne == b.ne && a.sw == b.sw && a.se == b.se;
-    }
-};
-
+// Hash-cons table: open addressing with linear probing over 32-bit arena
+// indices. The key is intrusive (the node's own children), so a slot is just
+// the node's index and the upper half of its hash, used to skip most
+// mismatches without touching the node.
 class NodePool {
 public:
-    NodePool() {
-        dead_cell_ = alloc_raw(0, 0, nullptr, nullptr, nullptr, nullptr);
-        alive_cell_ = alloc_raw(0, 1, nullptr, nullptr, nullptr, nullptr);
+    static constexpr int kLeafLevel = 2;
+
+    NodePool() = default;
+
+    ~NodePool() {
+        for (auto* chunk : arena_) {
+            delete[] chunk;
+        }
     }
 
-    QuadNode* dead_cell() { return dead_cell_; }
-    QuadNode* alive_cell() { return alive_cell_; }
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
 
-    QuadNode* leaf(bool alive) {
-        return alive ? alive_cell_ : dead_cell_;
+    void swap(NodePool& other) noexcept {
+        leaves_.swap(other.leaves_);
+        arena_.swap(other.arena_);
+        std::swap(arena_pos_, other.arena_pos_);
+        table_.swap(other.table_);
+        std::swap(count_, other.count_);
+        empty_cache_.swap(other.empty_cache_);
+    }
+
+    // Canonical 4x4 leaf with cells `bits` (bit 4 * y + x)
+    QuadNode* leaf(uint16_t bits) {
+        if (leaves_.empty()) {
+            leaves_.assign(size_t(1) << 16, kNoNode);
+        }
+        uint32_t& slot = leaves_[bits];
+        if (slot == kNoNode) {
+            slot = alloc_raw(kLeafLevel, __builtin_popcount(bits), nullptr, nullptr, nullptr, nullptr);
+            node_at(slot)->bits = bits;
+        }
+        return node_at(slot);
     }
 
     QuadNode* make(QuadNode* nw, QuadNode* ne, QuadNode* sw, QuadNode* se) {
         assert(nw->level == ne->level && ne->level == sw->level && sw->level == se->level);
+        assert(nw->level >= kLeafLevel);
 
-        QuadNode key;
-        key.nw = nw;
-        key.ne = ne;
-        key.sw = sw;
-        key.se = se;
+        if ((count_ + 1) * 4 > table_.size() * 3) {
+            grow();
+        }
 
-        auto it = canon_.find(key);
-        if (it != canon_.end()) {
-            return it->second;
+        uint64_t h = hash_children(nw, ne, sw, se);
+        uint32_t tag = static_cast<uint32_t>(h >> 32);
+        size_t mask = table_.size() - 1;
+        size_t i = static_cast<size_t>(h) & mask;
+        for (; table_[i].index != kNoNode; i = (i + 1) & mask) {
+            if (table_[i].tag != tag) continue;
+            QuadNode* node = node_at(table_[i].index);
+            if (node->nw == nw && node->ne == ne && node->sw == sw && node->se == se) {
+                return node;
+            }
         }
 
         int level = nw->level + 1;
         int64_t pop = nw->population + ne->population + sw->population + se->population;
-        QuadNode* node = alloc_raw(level, pop, nw, ne, sw, se);
-        canon_[key] = node;
-        return node;
+        uint32_t index = alloc_raw(level, pop, nw, ne, sw, se);
+        table_[i] = {index, tag};
+        ++count_;
+        return node_at(index);
+    }
+
+    size_t size() const noexcept { return count_; }
+
+    // Approximate bytes held: arena chunks, hash-cons table and leaf table
+    size_t memory_bytes() const noexcept {
+        return arena_.size() * kChunkSize * sizeof(QuadNode) +
+               table_.size() * sizeof(Slot) + leaves_.size() * sizeof(uint32_t);
+    }
+
+    // Typical bytes per canonical node (node plus ~2 table slots)
+    static constexpr size_t kBytesPerNode = sizeof(QuadNode) + 2 * sizeof(uint64_t);
+
+    // Mark-compact garbage collection.
+    //
+    // Keeps every node reachable from `roots` through child links, then walks
+    // the survivors from newest to oldest, keeping their memoized results
+    // (and the sub-trees those point to) until `keep_nodes` nodes are marked.
+    // Memo entries of older nodes are dropped. Survivors slide down the arena
+    // in allocation order, so age is preserved across collections.
+    //
+    // `roots` are updated in place; every other QuadNode pointer into the
+    // pool is invalidated.
+    void collect(std::vector<QuadNode*>& roots, size_t keep_nodes) {
+        size_t total = allocated();
+        std::vector<uint32_t> forward(total, kNoNode);
+        size_t marked = 0;
+
+        auto mark = [&](QuadNode* node, auto& self) -> void {
+            if (forward[node->index] != kNoNode) return;
+            forward[node->index] = 0;
+            ++marked;
+            if (node->level > kLeafLevel) {
+                self(node->nw, self);
+                self(node->ne, self);
+                self(node->sw, self);
+                self(node->se, self);
+            }
+        };
+        for (QuadNode* root : roots) {
+            mark(root, mark);
+        }
+        for (QuadNode* empty : empty_cache_) {
+            if (empty) mark(empty, mark);
+        }
+        for (size_t i = total; i-- > 0 && marked < keep_nodes;) {
+            if (forward[i] == kNoNode) continue;
+            QuadNode* node = node_at(static_cast<uint32_t>(i));
+            if (node->step1_result) mark(node->step1_result, mark);
+            if (node->result) mark(node->result, mark);
+        }
+
+        // Survivors keep their relative order
+        uint32_t kept = 0;
+        for (auto& f : forward) {
+            if (f != kNoNode) f = kept++;
+        }
+
+        // Redirect links to the survivors' new slots; memo results that
+        // didn't survive are dropped.
+        auto moved = [&](QuadNode* node) -> QuadNode* {
+            if (!node || forward[node->index] == kNoNode) return nullptr;
+            return node_at(forward[node->index]);
+        };
+        for (size_t i = 0; i < total; i++) {
+            if (forward[i] == kNoNode) continue;
+            QuadNode* node = node_at(static_cast<uint32_t>(i));
+            node->nw = moved(node->nw);
+            node->ne = moved(node->ne);
+            node->sw = moved(node->sw);
+            node->se = moved(node->se);
+            node->step1_result = moved(node->step1_result);
+            node->result = moved(node->result);
+        }
+        for (QuadNode*& root : roots) {
+            root = moved(root);
+        }
+        for (QuadNode*& empty : empty_cache_) {
+            empty = moved(empty);
+        }
+        for (uint32_t& leaf : leaves_) {
+            if (leaf != kNoNode) leaf = forward[leaf];
+        }
+
+        // Slide survivors down; a node's new slot never lies above its old one
+        for (size_t i = 0; i < total; i++) {
+            uint32_t to = forward[i];
+            if (to == kNoNode || to == i) continue;
+            QuadNode* node = node_at(to);
+            *node = *node_at(static_cast<uint32_t>(i));
+            node->index = to;
+        }
+
+        size_t chunks = (kept + kChunkSize - 1) / kChunkSize;
+        for (size_t c = chunks; c < arena_.size(); c++) {
+            delete[] arena_[c];
+        }
+        arena_.resize(chunks);
+        arena_pos_ = kept - (chunks > 0 ? (chunks - 1) * kChunkSize : 0);
+
+        // Rebuild the hash-cons table over the survivors
+        size_t slots = kChunkSize;
+        while (slots < size_t(kept) * 2) {
+            slots *= 2;
+        }
+        table_.assign(slots, Slot{});
+        count_ = 0;
+        for (uint32_t i = 0; i < kept; i++) {
+            const QuadNode* node = node_at(i);
+            if (node->level == kLeafLevel) continue;
+            uint64_t h = hash_children(node->nw, node->ne, node->sw, node->se);
+            size_t mask = table_.size() - 1;
+            size_t pos = static_cast<size_t>(h) & mask;
+            while (table_[pos].index != kNoNode) {
+                pos = (pos + 1) & mask;
+            }
+            table_[pos] = {i, static_cast<uint32_t>(h >> 32)};
+            ++count_;
+        }
     }
 
     QuadNode* empty_node(int level) {
-        if (level == 0) return dead_cell_;
+        assert(level >= kLeafLevel);
+        if (level == kLeafLevel) return leaf(0);
         if (level < static_cast<int>(empty_cache_.size()) && empty_cache_[level]) {
             return empty_cache_[level];
         }
@@ -101,43 +261,90 @@ public:
         }
         arena_.clear();
         arena_pos_ = 0;
-        arena_cap_ = 0;
-        current_chunk_ = nullptr;
-        canon_.clear();
+        table_.clear();
+        count_ = 0;
         empty_cache_.clear();
-
-        dead_cell_ = alloc_raw(0, 0, nullptr, nullptr, nullptr, nullptr);
-        alive_cell_ = alloc_raw(0, 1, nullptr, nullptr, nullptr, nullptr);
+        leaves_.clear();
     }
 
 private:
-    QuadNode* alloc_raw(int level, int64_t pop,
-                        QuadNode* nw, QuadNode* ne, QuadNode* sw, QuadNode* se) {
-        if (arena_pos_ >= arena_cap_) {
-            constexpr size_t CHUNK_SIZE = 65536;
-            current_chunk_ = new QuadNode[CHUNK_SIZE];
-            arena_.push_back(current_chunk_);
+    static constexpr int kChunkBits = 16;
+    static constexpr size_t kChunkSize = size_t(1) << kChunkBits;
+    static constexpr uint32_t kNoNode = std::numeric_limits<uint32_t>::max();
+
+    struct Slot {
+        uint32_t index = kNoNode;
+        uint32_t tag = 0;
+    };
+
+    static uint64_t hash_children(const QuadNode* nw, const QuadNode* ne,
+                                  const QuadNode* sw, const QuadNode* se) noexcept {
+        uint64_t h = reinterpret_cast<uintptr_t>(nw);
+        h = (h ^ (h >> 31)) * 0x9e3779b97f4a7c15ULL + reinterpret_cast<uintptr_t>(ne);
+        h = (h ^ (h >> 31)) * 0x9e3779b97f4a7c15ULL + reinterpret_cast<uintptr_t>(sw);
+        h = (h ^ (h >> 31)) * 0x9e3779b97f4a7c15ULL + reinterpret_cast<uintptr_t>(se);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    QuadNode* node_at(uint32_t index) const noexcept {
+        return &arena_[index >> kChunkBits][index & (kChunkSize - 1)];
+    }
+
+    size_t allocated() const noexcept {
+        return arena_.empty() ? 0 : (arena_.size() - 1) * kChunkSize + arena_pos_;
+    }
+
+    // Double the table (min 2^16 slots) and reinsert every entry
+    void grow() {
+        std::vector<Slot> old;
+        old.swap(table_);
+        table_.resize(std::max(old.size() * 2, kChunkSize));
+        size_t mask = table_.size() - 1;
+        for (const Slot& slot : old) {
+            if (slot.index == kNoNode) continue;
+            const QuadNode* node = node_at(slot.index);
+            size_t i = static_cast<size_t>(hash_children(node->nw, node->ne, node->sw, node->se)) & mask;
+            while (table_[i].index != kNoNode) {
+                i = (i + 1) & mask;
+            }
+            table_[i] = slot;
+        }
+    }
+
+    uint32_t alloc_raw(int level, int64_t pop,
+                       QuadNode* nw, QuadNode* ne, QuadNode* sw, QuadNode* se) {
+        if (arena_.empty() || arena_pos_ == kChunkSize) {
+            if (arena_.size() >= (size_t(1) << (32 - kChunkBits)) - 1) {
+                throw std::length_error("HashLife node pool exhausted");
+            }
+            arena_.push_back(new QuadNode[kChunkSize]);
             arena_pos_ = 0;
-            arena_cap_ = CHUNK_SIZE;
         }
-        QuadNode* node = &current_chunk_[arena_pos_++];
-        node->level = level;
+        uint32_t index = static_cast<uint32_t>(((arena_.size() - 1) << kChunkBits) | arena_pos_++);
+        QuadNode* node = node_at(index);
+        node->level = static_cast<int16_t>(level);
+        node->bits = 0;
+        node->index = index;
         node->population = pop;
         node->nw = nw;
         node->ne = ne;
         node->sw = sw;
         node->se = se;
         node->step1_result = nullptr;
-        return node;
+        node->result = nullptr;
+        return index;
     }
 
-    QuadNode* dead_cell_ = nullptr;
-    QuadNode* alive_cell_ = nullptr;
+    std::vector<uint32_t> leaves_;  // leaves_[bits], allocated on first use
     std::vector<QuadNode*> arena_;
-    QuadNode* current_chunk_ = nullptr;
     size_t arena_pos_ = 0;
-    size_t arena_cap_ = 0;
-    std::unordered_map<QuadNode, QuadNode*, QuadNodeHash, QuadNodeEqual> canon_;
+    std::vector<Slot> table_;
+    size_t count_ = 0;
     std::vector<QuadNode*> empty_cache_;
 };
 
@@ -147,128 +354,379 @@ struct SortedCells {
 
     void build(const CellSet& cs) {
         cells.assign(cs.begin(), cs.end());
+        sort();
+    }
+
+    void build(const Cell* begin, const Cell* end) {
+        cells.assign(begin, end);
+        sort();
+    }
+
+    void sort() {
         std::sort(cells.begin(), cells.end(), [](const Cell& a, const Cell& b) {
             return a.x < b.x || (a.x == b.x && a.y < b.y);
         });
     }
 
+    // v - origin for v >= origin, without signed overflow
+    static uint64_t offset(int64_t v, int64_t origin) noexcept {
+        return static_cast<uint64_t>(v) - static_cast<uint64_t>(origin);
+    }
+
     // Check if any cell falls within [x, x+size) x [y, y+size)
     bool has_cell_in(int64_t x, int64_t y, int64_t size) const {
         // Binary search for first cell with cell.x >= x
         auto it = std::lower_bound(cells.begin(), cells.end(), Cell{x, 0},
             [](const Cell& a, const Cell& b) { return a.x < b.x; });
 
-        int64_t x_end = x + size;
-        int64_t y_end = y + size;
-        while (it != cells.end() && it->x < x_end) {
-            if (it->y >= y && it->y < y_end) return true;
+        // Offsets rather than ends: x + size overflows next to INT64_MAX
+        while (it != cells.end() && offset(it->x, x) < static_cast<uint64_t>(size)) {
+            if (it->y >= y && offset(it->y, y) < static_cast<uint64_t>(size)) return true;
             ++it;
         }
         return false;
     }
 
-    bool contains(int64_t x, int64_t y) const {
-        auto it = std::lower_bound(cells.begin(), cells.end(), Cell{x, y},
-            [](const Cell& a, const Cell& b) {
-                return a.x < b.x || (a.x == b.x && a.y < b.y);
-            });
-        return it != cells.end() && it->x == x && it->y == y;
+    // Cells of the 4x4 block at (x, y) as a leaf mask (bit 4 * dy + dx)
+    uint16_t leaf_bits(int64_t x, int64_t y) const {
+        auto it = std::lower_bound(cells.begin(), cells.end(), Cell{x, 0},
+            [](const Cell& a, const Cell& b) { return a.x < b.x; });
+
+        uint16_t bits = 0;
+        for (; it != cells.end() && offset(it->x, x) < 4; ++it) {
+            if (it->y >= y && offset(it->y, y) < 4) {
+                bits |= uint16_t(1) << (4 * (it->y - y) + (it->x - x));
+            }
+        }
+        return bits;
     }
 };
 
+// 8x8 board (bit 8 * y + x) of a level-3 node from its four leaves
+inline uint64_t board_8x8(const QuadNode* node) noexcept {
+    auto spread = [](uint16_t bits) {
+        uint64_t rows = 0;
+        for (int r = 0; r < 4; r++) {
+            rows |= uint64_t((bits >> (4 * r)) & 0xf) << (8 * r);
+        }
+        return rows;
+    };
+    return spread(node->nw->bits) | (spread(node->ne->bits) << 4) |
+           (spread(node->sw->bits) << 32) | (spread(node->se->bits) << 36);
+}
+
+// Central 4x4 of an 8x8 board as a leaf mask
+inline uint16_t center_4x4(uint64_t board) noexcept {
+    uint16_t bits = 0;
+    for (int r = 0; r < 4; r++) {
+        bits |= static_cast<uint16_t>(((board >> (8 * (r + 2) + 2)) & 0xf) << (4 * r));
+    }
+    return bits;
+}
+
 } // anonymous namespace
 
 class HashLifeEngine : public SimulationEngine {
 public:
+    explicit HashLifeEngine(bool superspeed = false) : superspeed_(superspeed) {}
+
     void tick(CellSet& cells) override {
-        pool_.clear();
+        advance(cells, 1);
+    }
 
-        if (cells.empty()) return;
+    void advance(CellSet& cells, uint64_t generations) override {
+        while (generations > 0) {
+            collect_garbage();
+
+            // The quadtree persists across ticks; it is only rebuilt from
+            // `cells` when the engine holds no retained generation.
+            if (!root_) {
+                if (cells.empty()) return;
+                if (!build_root(cells)) {
+                    tick_clustered(cells);
+                    --generations;
+                    continue;
+                }
+            }
 
-        // Cluster cells into groups that are close enough to interact.
-        // Cells more than CHUNK_SIZE apart are guaranteed independent.
-        constexpr int64_t CHUNK_SIZE = 64;
+            // An empty universe stays empty
+            if (root_->population == 0) return;
 
-        struct ChunkKey {
-            int64_t cx, cy;
-            bool operator==(const ChunkKey& o) const { return cx == o.cx && cy == o.cy; }
-        };
-        struct ChunkHash {
-            size_t operator()(const ChunkKey& k) const noexcept {
-                size_t h = std::hash<int64_t>{}(k.cx);
-                h ^= std::hash<int64_t>{}(k.cy) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
-                return h;
+            int j = 0;
+            if (superspeed_) {
+                j = std::min(kMaxJump, 63 - __builtin_clzll(generations));
             }
-        };
-
-        std::unordered_map<ChunkKey, std::vector<Cell>, ChunkHash> chunks;
-        for (const auto& cell : cells) {
-            int64_t cx = (cell.x >= 0) ? cell.x / CHUNK_SIZE : (cell.x - CHUNK_SIZE + 1) / CHUNK_SIZE;
-            int64_t cy = (cell.y >= 0) ? cell.y / CHUNK_SIZE : (cell.y - CHUNK_SIZE + 1) / CHUNK_SIZE;
-            chunks[{cx, cy}].push_back(cell);
+            size_t nodes_before = pool_.size();
+            bool stepped = step_root(j);
+            while (!stepped && j > 0) {
+                stepped = step_root(--j);
+            }
+            if (metrics_) {
+                nodes_created_ += pool_.size() - nodes_before;
+                clusters_ = 0;
+            }
+            if (!stepped) {
+                // The universe grew too close to the int64_t limits for a
+                // single root; hand the cells back and fall back to
+                // per-cluster stepping.
+                cells.clear();
+                flatten(root_, ox_, oy_, cells);
+                root_ = nullptr;
+                tick_clustered(cells);
+                --generations;
+                continue;
+            }
+            generations -= uint64_t(1) << j;
         }
+    }
 
-        // Union-Find to merge adjacent chunks
-        std::unordered_map<ChunkKey, ChunkKey, ChunkHash> parent;
-        for (const auto& [key, _] : chunks) {
-            parent[key] = key;
-        }
+    [[nodiscard]] std::unique_ptr<SimulationEngine> clone() const override {
+        auto copy = std::make_unique<HashLifeEngine>(superspeed_);
+        copy->memory_limit_ = memory_limit_;
+        copy->metrics_ = metrics_;
+        copy->track_changes_ = track_changes_;
+        copy->changes_ = changes_;
+        copy->set_rule(rule_);
+        return copy;
+    }
+
+    [[nodiscard]] EngineType type() const noexcept override {
+        return superspeed_ ? EngineType::HashlifeFast : EngineType::Hashlife;
+    }
+
+    [[nodiscard]] bool retains_state() const noexcept override {
+        return root_ != nullptr;
+    }
 
-        std::function<ChunkKey(ChunkKey)> find = [&](ChunkKey k) -> ChunkKey {
-            if (!(parent[k] == k)) parent[k] = find(parent[k]);
-            return parent[k];
+    void sync(CellSet& cells) override {
+        cells.clear();
+        if (!root_) return;
+        cells.reserve(static_cast<size_t>(root_->population));
+        flatten(root_, ox_, oy_, cells);
+    }
+
+    [[nodiscard]] size_t population() const noexcept override {
+        return root_ ? static_cast<size_t>(root_->population) : 0;
+    }
+
+    bool count_blocks(const BlockGrid& grid, std::vector<uint64_t>& counts) const override {
+        if (!root_) return false;
+        count_node(root_, ox_, oy_, grid, counts);
+        return true;
+    }
+
+    bool bounding_box(std::optional<BoundingBox>& box) const override {
+        box.reset();
+        if (!root_ || root_->population == 0) return true;
+        const int64_t size = int64_t(1) << root_->level;
+        const uint64_t last = static_cast<uint64_t>(size - 1);
+        box = BoundingBox{
+            ox_ + edge_distance(root_, 0, false, size),
+            static_cast<int64_t>(static_cast<uint64_t>(ox_) + last -
+                                 static_cast<uint64_t>(edge_distance(root_, 0, true, size))),
+            oy_ + edge_distance(root_, 1, false, size),
+            static_cast<int64_t>(static_cast<uint64_t>(oy_) + last -
+                                 static_cast<uint64_t>(edge_distance(root_, 1, true, size))),
         };
+        return true;
+    }
+
+    bool cells_in_rect(const BoundingBox& rect, std::vector<Cell>& out) const override {
+        if (!root_) return false;
+        collect_rect(root_, ox_, oy_, rect, out);
+        return true;
+    }
+
+    void set_memory_limit(size_t bytes) override {
+        memory_limit_ = bytes;
+    }
+
+    void set_metrics(bool enabled) override {
+        metrics_ = enabled;
+        take_metrics();
+    }
 
-        auto unite = [&](ChunkKey a, ChunkKey b) {
-            a = find(a);
-            b = find(b);
-            if (!(a == b)) parent[a] = b;
+    std::vector<EngineCounter> take_metrics() override {
+        std::vector<EngineCounter> out = {
+            {"memo_hits", memo_hits_},
+            {"memo_misses", memo_misses_},
+            {"nodes_created", nodes_created_},
+            {"gc_runs", gc_runs_},
+            {"clusters", clusters_},
+            {"pool_nodes", pool_.size()},
+            {"pool_bytes", pool_.memory_bytes()},
         };
+        memo_hits_ = memo_misses_ = nodes_created_ = gc_runs_ = 0;
+        return out;
+    }
+
+    bool set_track_changes(bool enabled) override {
+        track_changes_ = enabled;
+        changes_.clear();
+        if (boundary_engine_) boundary_engine_->set_track_changes(enabled);
+        return true;
+    }
+
+    void take_changes(ChangeLog& log) override {
+        log.absorb(changes_);
+    }
 
-        for (const auto& [key, _] : chunks) {
-            for (int64_t dx = -1; dx <= 1; dx++) {
-                for (int64_t dy = -1; dy <= 1; dy++) {
-                    if (dx == 0 && dy == 0) continue;
-                    ChunkKey neighbor{key.cx + dx, key.cy + dy};
-                    if (chunks.count(neighbor)) {
-                        unite(key, neighbor);
+    // Every memoized result in the pool is a result under the old rule, so
+    // the pool starts over: each rule gets a memo of its own.
+    void set_rule(const Rule& rule) override {
+        rule_ = rule;
+        leaf_kernel_ = with_rule(rule, [](auto fixed) { return &leaf_kernel<decltype(fixed)>; });
+        root_ = nullptr;
+        pool_.clear();
+        partial_memo_.clear();
+        partial_j_ = -1;
+        boundary_engine_.reset();
+    }
+
+    [[nodiscard]] Rule rule() const noexcept override {
+        return rule_;
+    }
+
+    // Golly macrocell: "[M2]" header, '#' comment lines (#R is the rule),
+    // then one node per line, numbered from 1 in file order. An 8x8 leaf is
+    // rows of '.'/'*' ending in '$' (trailing dead cells and rows omitted); a
+    // larger node is "level nw ne sw se", children by line number or 0 for
+    // empty. The last node is the root, centered on (0, 0).
+    bool read_macrocell(std::istream& in) override {
+        std::string line;
+        if (!std::getline(in, line) || line.rfind("[M2]", 0) != 0) {
+            throw std::runtime_error("Invalid macrocell file: missing '[M2]' header");
+        }
+
+        // Nodes are built as they are read, so only the tree is held. Golly
+        // writes the rule and comments before the first node, and they must
+        // come there: setting the rule clears the pool.
+        std::vector<QuadNode*> nodes{nullptr};  // nodes[i]: line number i
+        Rule rule;
+        bool in_nodes = false;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (line[0] == '#') {
+                if (in_nodes) {
+                    throw std::runtime_error("Invalid macrocell file: '" + line +
+                                             "' after the first node");
+                }
+                if (line.rfind("#R", 0) == 0) {
+                    size_t begin = line.find_first_not_of(" \t", 2);
+                    size_t end = line.find_last_not_of(" \t");
+                    std::string_view name = begin == std::string::npos
+                        ? std::string_view{}
+                        : std::string_view(line).substr(begin, end - begin + 1);
+                    try {
+                        rule = parse_rule(name);
+                    } catch (const std::invalid_argument&) {
+                        throw std::runtime_error("Invalid macrocell file: unsupported rule '" +
+                                                 std::string(name) + "'");
                     }
                 }
+                continue;
             }
-        }
-
-        std::unordered_map<ChunkKey, CellSet, ChunkHash> clusters;
-        for (const auto& [key, chunk_cells] : chunks) {
-            ChunkKey root = find(key);
-            for (const auto& cell : chunk_cells) {
-                clusters[root].insert(cell);
+            if (!in_nodes) {
+                if (rule != rule_) set_rule(rule);
+                in_nodes = true;
+            }
+            if (line[0] == '.' || line[0] == '*' || line[0] == '$') {
+                nodes.push_back(macrocell_leaf(line));
+            } else {
+                nodes.push_back(macrocell_node(line, nodes));
             }
         }
+        if (!in_nodes && rule != rule_) set_rule(rule);
+
+        // The level-3 and larger nodes share the pool with the current tree
+        partial_memo_.clear();
+        partial_j_ = -1;
+        root_ = nullptr;
+        if (nodes.size() == 1 || nodes.back()->population == 0) return true;
+        root_ = nodes.back();
+        ox_ = oy_ = -(int64_t(1) << (root_->level - 1));
+        return true;
+    }
 
-        cells.clear();
-        for (auto& [_, cluster_cells] : clusters) {
-            step_cluster(cluster_cells);
-            for (const auto& cell : cluster_cells) {
-                cells.insert(cell);
+    bool write_macrocell(std::ostream& out, const CellSet& cells) override {
+        // The format puts the root's center at the origin. Trees read from a
+        // macrocell file stay centered as they step and grow; others are
+        // rebuilt around (0, 0) from their cells.
+        if (!root_ || ox_ + (int64_t(1) << (root_->level - 1)) != 0 ||
+            oy_ + (int64_t(1) << (root_->level - 1)) != 0) {
+            if (root_) {
+                scratch_.clear();
+                flatten(root_, ox_, oy_, scratch_);
+                root_ = nullptr;
+                if (!build_centered_root(scratch_)) {
+                    throw std::runtime_error("Pattern too large for a macrocell tree");
+                }
+            } else if (!cells.empty() && !build_centered_root(cells)) {
+                throw std::runtime_error("Pattern too large for a macrocell tree");
             }
         }
-    }
 
-    [[nodiscard]] std::unique_ptr<SimulationEngine> clone() const override {
-        return std::make_unique<HashLifeEngine>();
+        out << "[M2] (game_of_life)\n#R " << rule_string(rule_) << "\n";
+        if (!root_ || root_->population == 0) return true;
+        std::unordered_map<const QuadNode*, uint64_t> numbers;
+        uint64_t next = 0;
+        write_macrocell_node(out, root_, numbers, next);
+        return true;
     }
 
-    [[nodiscard]] EngineType type() const noexcept override {
-        return EngineType::Hashlife;
+private:
+    // Default node pool budget; see collect_garbage().
+    static constexpr size_t kDefaultMemoryLimit = size_t(256) << 20;
+
+    // Largest root level; keeps every coordinate offset within int64_t.
+    static constexpr int kMaxRootLevel = 62;
+
+    // Largest superspeed jump (2^kMaxJump generations) for a kMaxRootLevel root.
+    static constexpr int kMaxJump = kMaxRootLevel - 3;
+
+    bool superspeed_;
+    size_t memory_limit_ = kDefaultMemoryLimit;
+
+    // Metrics since the last take_metrics(); clusters is the count stepped by
+    // the last clustered tick (0 once a single root covers the universe)
+    bool metrics_ = false;
+    uint64_t memo_hits_ = 0;
+    uint64_t memo_misses_ = 0;
+    uint64_t nodes_created_ = 0;
+    uint64_t gc_runs_ = 0;
+    uint64_t clusters_ = 0;
+
+    bool track_changes_ = false;
+    ChangeLog changes_;
+
+    // One generation of an 8x8 leaf board under rule_, specialized for it
+    Rule rule_;
+    uint64_t (*leaf_kernel_)(const Rule&, uint64_t) = &leaf_kernel<LifeRule>;
+
+    template <typename R>
+    static uint64_t leaf_kernel(const Rule& rule, uint64_t board) {
+        if constexpr (std::is_same_v<R, RuntimeRule>) {
+            return rule_8x8(RuntimeRule{rule.birth, rule.survive}, board);
+        } else {
+            (void)rule;
+            return rule_8x8(R{}, board);
+        }
     }
 
-private:
-    NodePool pool_;
+    // Memo for step(node, j) with 0 < j < level-2, valid for partial_j_ only.
+    std::unordered_map<QuadNode*, QuadNode*> partial_memo_;
+    int partial_j_ = -1;
 
-    void step_cluster(CellSet& cells) {
-        if (cells.empty()) return;
+    // Persistent universe: root_ covers [ox_, ox_ + 2^level) on both axes.
+    QuadNode* root_ = nullptr;
+    int64_t ox_ = 0;
+    int64_t oy_ = 0;
+    CellSet scratch_;
 
-        // Find bounding box
+    // Build root_ from `cells`. Returns false if the cells span too much of
+    // the int64_t range to be covered by a single root.
+    bool build_root(const CellSet& cells) {
         int64_t min_x = std::numeric_limits<int64_t>::max();
         int64_t max_x = std::numeric_limits<int64_t>::min();
         int64_t min_y = std::numeric_limits<int64_t>::max();
@@ -281,39 +739,302 @@ private:
             max_y = std::max(max_y, cell.y);
         }
 
-        int64_t range_x = max_x - min_x + 1;
-        int64_t range_y = max_y - min_y + 1;
+        uint64_t range_x = static_cast<uint64_t>(max_x) - static_cast<uint64_t>(min_x) + 1;
+        uint64_t range_y = static_cast<uint64_t>(max_y) - static_cast<uint64_t>(min_y) + 1;
+        uint64_t range = std::max(range_x, range_y);
+        if (range_x == 0 || range_y == 0 || range > (uint64_t(1) << (kMaxRootLevel - 2))) {
+            return false;
+        }
+
+        int level = NodePool::kLeafLevel + 1;
+        while ((uint64_t(1) << level) < range) {
+            ++level;
+        }
+
+        int64_t size = int64_t(1) << level;
+        int64_t ox, oy;
+        if (__builtin_sub_overflow(min_x, static_cast<int64_t>((static_cast<uint64_t>(size) - range_x) / 2), &ox) ||
+            __builtin_sub_overflow(min_y, static_cast<int64_t>((static_cast<uint64_t>(size) - range_y) / 2), &oy) ||
+            !fits_root(ox, size) || !fits_root(oy, size)) {
+            return false;
+        }
+
+        sorted_.build(cells);
+        root_ = build_recursive(ox, oy, level);
+        ox_ = ox;
+        oy_ = oy;
+        return true;
+    }
+
+    // Check that [origin, origin + size) stays clear of INT64_MIN/MAX, so
+    // that no cell in the root is subject to would_overflow().
+    static bool fits_root(int64_t origin, int64_t size) {
+        int64_t last;
+        return origin != std::numeric_limits<int64_t>::min() &&
+               !__builtin_add_overflow(origin, size - 1, &last) &&
+               last != std::numeric_limits<int64_t>::max();
+    }
+
+    // Grow root_ by one level, keeping it centered. Returns false if the
+    // larger root would no longer fit in the coordinate range.
+    bool expand_root() {
+        if (root_->level >= kMaxRootLevel) return false;
+        int64_t half = int64_t(1) << (root_->level - 1);
+        int64_t ox, oy;
+        if (__builtin_sub_overflow(ox_, half, &ox) || __builtin_sub_overflow(oy_, half, &oy) ||
+            !fits_root(ox, int64_t(1) << (root_->level + 1)) ||
+            !fits_root(oy, int64_t(1) << (root_->level + 1))) {
+            return false;
+        }
+        root_ = expand(root_, ox_, oy_);
+        return true;
+    }
+
+    // True when every live cell lies in the central quarter of root_ and
+    // that quarter is at least 2^j cells from the edge of the half-size
+    // result, so 2^j generations of growth (at up to one cell per
+    // generation) cannot escape it.
+    bool root_padded(int j) const {
+        if (root_->level < std::max(j + 3, NodePool::kLeafLevel + 3)) return false;
+        int64_t inner = root_->nw->se->se->population + root_->ne->sw->sw->population +
+                        root_->sw->ne->ne->population + root_->se->nw->nw->population;
+        return inner == root_->population;
+    }
+
+    // Advance root_ by 2^j generations. Returns false if root_ could not be
+    // padded for that jump; root_ still holds the current generation then.
+    bool step_root(int j) {
+        while (!root_padded(j)) {
+            if (!expand_root()) return false;
+        }
+        int64_t quarter = int64_t(1) << (root_->level - 2);
+        QuadNode* before = root_;
+        root_ = metrics_ ? step<true>(root_, j) : step<false>(root_, j);
+        if (track_changes_) note_changes(before, ox_, oy_, root_);
+        ox_ += quarter;
+        oy_ += quarter;
+        return true;
+    }
+
+    // Bound memory: once the pool outgrows the budget, collect everything
+    // not reachable from the current universe, keeping memo entries newest
+    // first up to half the budget. Checked between steps, so one large
+    // superspeed jump can overshoot the budget until it completes.
+    void collect_garbage() {
+        if (pool_.memory_bytes() <= memory_limit_) return;
+        if (metrics_) ++gc_runs_;
+        partial_memo_.clear();
+        partial_j_ = -1;
+        if (!root_) {
+            pool_.clear();
+            return;
+        }
+        std::vector<QuadNode*> roots{root_};
+        pool_.collect(roots, memory_limit_ / 2 / NodePool::kBytesPerNode);
+        root_ = roots[0];
+    }
+
+    // Fallback for universes spanning most of the int64_t range: cluster
+    // cells and step each cluster independently with a throwaway root.
+    //
+    // Cells are tagged with their 64x64 chunk and sorted by chunk once;
+    // adjacent chunks are merged with a flat union-find over chunk indices
+    // (neighbors found by binary search in the sorted keys), then cells are
+    // bucketed by cluster with a counting sort. All buffers are members, so
+    // steady-state ticks don't allocate. Chunks more than one apart can't
+    // interact within a generation. Clusters whose root would reach the
+    // int64_t limits are stepped together by the hashtable engine, which
+    // keeps would_overflow() semantics there.
+    void tick_clustered(CellSet& cells) {
+        if (cells.empty()) return;
+
+        constexpr int kChunkBits = 6;
+
+        chunked_.clear();
+        chunked_.reserve(cells.size());
+        for (const auto& cell : cells) {
+            chunked_.push_back({{cell.x >> kChunkBits, cell.y >> kChunkBits}, cell});
+        }
+        std::sort(chunked_.begin(), chunked_.end(), [](const ChunkedCell& a, const ChunkedCell& b) {
+            return chunk_less(a.chunk, b.chunk);
+        });
+
+        // Unique chunk keys, with chunk_begin_[i] the first cell of chunk i
+        chunk_keys_.clear();
+        chunk_begin_.clear();
+        for (size_t i = 0; i < chunked_.size(); i++) {
+            if (i == 0 || !(chunked_[i].chunk == chunked_[i - 1].chunk)) {
+                chunk_keys_.push_back(chunked_[i].chunk);
+                chunk_begin_.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        chunk_begin_.push_back(static_cast<uint32_t>(chunked_.size()));
+        const size_t chunks = chunk_keys_.size();
+
+        // Flat union-find; adjacency is symmetric, so half the neighbors suffice
+        chunk_parent_.resize(chunks);
+        for (size_t i = 0; i < chunks; i++) {
+            chunk_parent_[i] = static_cast<uint32_t>(i);
+        }
+        auto find = [this](uint32_t i) {
+            while (chunk_parent_[i] != i) {
+                chunk_parent_[i] = chunk_parent_[chunk_parent_[i]];
+                i = chunk_parent_[i];
+            }
+            return i;
+        };
+        constexpr int64_t kHalfNeighbors[4][2] = {{1, -1}, {1, 0}, {1, 1}, {0, 1}};
+        for (size_t i = 0; i < chunks; i++) {
+            for (const auto& d : kHalfNeighbors) {
+                Cell key{chunk_keys_[i].x + d[0], chunk_keys_[i].y + d[1]};
+                auto it = std::lower_bound(chunk_keys_.begin(), chunk_keys_.end(), key, chunk_less);
+                if (it == chunk_keys_.end() || !(*it == key)) continue;
+                uint32_t a = find(static_cast<uint32_t>(i));
+                uint32_t b = find(static_cast<uint32_t>(it - chunk_keys_.begin()));
+                if (a != b) chunk_parent_[a] = b;
+            }
+        }
+
+        // Counting sort of cells by cluster
+        constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+        cluster_of_.assign(chunks, kNone);
+        cluster_begin_.clear();
+        for (size_t i = 0; i < chunks; i++) {
+            uint32_t root = find(static_cast<uint32_t>(i));
+            if (cluster_of_[root] == kNone) {
+                cluster_of_[root] = static_cast<uint32_t>(cluster_begin_.size());
+                cluster_begin_.push_back(0);
+            }
+            cluster_begin_[cluster_of_[root]] += chunk_begin_[i + 1] - chunk_begin_[i];
+        }
+        uint32_t offset = 0;
+        for (auto& begin : cluster_begin_) {
+            uint32_t count = begin;
+            begin = offset;
+            offset += count;
+        }
+        cluster_begin_.push_back(offset);
+
+        // Each cluster's bounding box is taken in the same pass
+        cluster_cells_.resize(chunked_.size());
+        cluster_fill_.assign(cluster_begin_.begin(), cluster_begin_.end() - 1);
+        cluster_box_.assign(cluster_fill_.size(),
+                            BoundingBox{std::numeric_limits<int64_t>::max(),
+                                        std::numeric_limits<int64_t>::min(),
+                                        std::numeric_limits<int64_t>::max(),
+                                        std::numeric_limits<int64_t>::min()});
+        for (size_t i = 0; i < chunks; i++) {
+            uint32_t cluster = cluster_of_[find(static_cast<uint32_t>(i))];
+            uint32_t& pos = cluster_fill_[cluster];
+            BoundingBox& box = cluster_box_[cluster];
+            for (uint32_t c = chunk_begin_[i]; c < chunk_begin_[i + 1]; c++) {
+                const Cell& cell = chunked_[c].cell;
+                box.min_x = std::min(box.min_x, cell.x);
+                box.max_x = std::max(box.max_x, cell.x);
+                box.min_y = std::min(box.min_y, cell.y);
+                box.max_y = std::max(box.max_y, cell.y);
+                cluster_cells_[pos++] = cell;
+            }
+        }
+
+        // Cluster roots are throwaway; don't let them accumulate
+        pool_.clear();
+        partial_memo_.clear();
+        partial_j_ = -1;
+
+        cells.clear();
+        for (size_t c = 0; c + 1 < cluster_begin_.size(); c++) {
+            step_cluster(cluster_cells_.data() + cluster_begin_[c],
+                         cluster_cells_.data() + cluster_begin_[c + 1], cluster_box_[c], cells);
+        }
+        if (!boundary_cells_.empty()) {
+            if (!boundary_engine_) {
+                boundary_engine_ = create_engine(EngineType::Hashtable);
+                boundary_engine_->set_rule(rule_);
+                boundary_engine_->set_track_changes(track_changes_);
+            }
+            boundary_engine_->tick(boundary_cells_);
+            if (track_changes_) boundary_engine_->take_changes(changes_);
+            cells.insert(boundary_cells_.begin(), boundary_cells_.end());
+            boundary_cells_.clear();
+        }
+        if (metrics_) {
+            nodes_created_ += pool_.size();
+            clusters_ = cluster_begin_.size() - 1;
+        }
+    }
+
+    static bool chunk_less(const Cell& a, const Cell& b) noexcept {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    }
+
+    struct ChunkedCell {
+        Cell chunk;
+        Cell cell;
+    };
+
+    // tick_clustered() scratch, reused across ticks
+    std::vector<ChunkedCell> chunked_;
+    std::vector<Cell> chunk_keys_;
+    std::vector<uint32_t> chunk_begin_;
+    std::vector<uint32_t> chunk_parent_;
+    std::vector<uint32_t> cluster_of_;
+    std::vector<uint32_t> cluster_begin_;
+    std::vector<uint32_t> cluster_fill_;
+    std::vector<BoundingBox> cluster_box_;
+    std::vector<Cell> cluster_cells_;
+    CellSet boundary_cells_;
+    std::unique_ptr<SimulationEngine> boundary_engine_;
+
+    NodePool pool_;
+
+    // Step the cells in [begin, end), whose bounding box is `box`, one
+    // generation and add the result to `out`, or set them aside in
+    // boundary_cells_ if the root would pass the int64_t limits.
+    void step_cluster(const Cell* begin, const Cell* end, const BoundingBox& box, CellSet& out) {
+        if (begin == end) return;
+
+        const int64_t min_x = box.min_x;
+        const int64_t min_y = box.min_y;
+        int64_t range_x = box.max_x - min_x + 1;
+        int64_t range_y = box.max_y - min_y + 1;
         int64_t range = std::max(range_x, range_y);
 
-        int level = 1;
+        int level = NodePool::kLeafLevel + 1;
         while ((int64_t(1) << level) < range) {
             ++level;
         }
 
+        // The twice-expanded root spans [o - 1.5 size, o + 2.5 size)
         int64_t size = int64_t(1) << level;
-        int64_t ox = min_x - (size - range_x) / 2;
-        int64_t oy = min_y - (size - range_y) / 2;
+        int64_t ox, oy, padded_x, padded_y;
+        if (level > kMaxRootLevel - 2 ||
+            __builtin_sub_overflow(min_x, (size - range_x) / 2, &ox) ||
+            __builtin_sub_overflow(min_y, (size - range_y) / 2, &oy) ||
+            __builtin_sub_overflow(ox, size + size / 2, &padded_x) ||
+            __builtin_sub_overflow(oy, size + size / 2, &padded_y) ||
+            !fits_root(padded_x, 4 * size) || !fits_root(padded_y, 4 * size)) {
+            boundary_cells_.insert(begin, end);
+            return;
+        }
 
         // Sort cells for efficient range queries during tree construction
-        sorted_.build(cells);
+        sorted_.build(begin, end);
 
         QuadNode* root = build_recursive(ox, oy, level);
 
         // Expand for border safety
-        while (root->level < 2) {
-            root = expand(root, ox, oy);
-        }
         root = expand(root, ox, oy);
         root = expand(root, ox, oy);
 
-        QuadNode* result = slow_step(root);
+        QuadNode* result = metrics_ ? step<true>(root, 0) : step<false>(root, 0);
+        if (track_changes_) note_changes(root, ox, oy, result);
 
         int64_t quarter = int64_t(1) << (root->level - 2);
         int64_t rx = ox + quarter;
         int64_t ry = oy + quarter;
 
-        cells.clear();
-        flatten(result, rx, ry, cells);
+        flatten(result, rx, ry, out);
     }
 
     SortedCells sorted_;
@@ -331,6 +1052,33 @@ private:
         );
     }
 
+    // Note the changes between `before`, with its corner at (x, y), and
+    // `after`, the stepped center of it. After is padded back out to the
+    // same square, and then the two trees are compared node by node: nodes
+    // are hash-consed, so a subtree the step left alone is the same node in
+    // both and is skipped, and only the changed regions are visited.
+    void note_changes(QuadNode* before, int64_t x, int64_t y, QuadNode* after) {
+        int64_t ax = x + (int64_t(1) << (before->level - 2));
+        int64_t ay = y + (int64_t(1) << (before->level - 2));
+        diff_nodes(before, expand(after, ax, ay), x, y);
+    }
+
+    void diff_nodes(const QuadNode* a, const QuadNode* b, int64_t x, int64_t y) {
+        if (a == b) return;
+        if (a->level == NodePool::kLeafLevel) {
+            for (uint32_t diff = uint32_t(a->bits ^ b->bits); diff; diff &= diff - 1) {
+                int i = __builtin_ctz(diff);
+                changes_.flip({x + (i & 3), y + (i >> 2)}, (b->bits >> i) & 1);
+            }
+            return;
+        }
+        int64_t half = int64_t(1) << (a->level - 1);
+        diff_nodes(a->nw, b->nw, x,        y);
+        diff_nodes(a->ne, b->ne, x + half, y);
+        diff_nodes(a->sw, b->sw, x,        y + half);
+        diff_nodes(a->se, b->se, x + half, y + half);
+    }
+
     // Build quadtree with early exit for empty sub-regions
     QuadNode* build_recursive(int64_t x, int64_t y, int level) {
         int64_t size = int64_t(1) << level;
@@ -340,8 +1088,8 @@ private:
             return pool_.empty_node(level);
         }
 
-        if (level == 0) {
-            return pool_.leaf(sorted_.contains(x, y));
+        if (level == NodePool::kLeafLevel) {
+            return pool_.leaf(sorted_.leaf_bits(x, y));
         }
 
         int64_t half = size >> 1;
@@ -355,21 +1103,104 @@ private:
 
     // center() returns the center sub-node without any simulation.
     QuadNode* center(QuadNode* node) {
+        if (node->level == NodePool::kLeafLevel + 1) {
+            return pool_.leaf(center_4x4(board_8x8(node)));
+        }
         return pool_.make(node->nw->se, node->ne->sw, node->sw->ne, node->se->nw);
     }
 
-    // slow_step: advance exactly 1 generation.
-    QuadNode* slow_step(QuadNode* node) {
-        if (node->step1_result) return node->step1_result;
+    // step: advance a level-k node by 2^j generations (j <= k-2) and return
+    // its level-(k-1) center.
+    // With Metrics, memo hits and misses are counted.
+    template <bool Metrics>
+    QuadNode* step(QuadNode* node, int j) {
+        if (j == node->level - 2) return result<Metrics>(node);
+
+        if (j == 0) {
+            if (node->step1_result) {
+                if constexpr (Metrics) ++memo_hits_;
+                return node->step1_result;
+            }
+        } else {
+            if (partial_j_ != j) {
+                partial_memo_.clear();
+                partial_j_ = j;
+            }
+            auto it = partial_memo_.find(node);
+            if (it != partial_memo_.end()) {
+                if constexpr (Metrics) ++memo_hits_;
+                return it->second;
+            }
+        }
+        if constexpr (Metrics) ++memo_misses_;
+
+        QuadNode* out;
+        if (node->population == 0) {
+            out = pool_.empty_node(node->level - 1);
+        } else if (node->level == NodePool::kLeafLevel + 1) {
+            // j == 0 here (j == 1 is result())
+            out = pool_.leaf(center_4x4(leaf_kernel_(rule_, board_8x8(node))));
+        } else {
+            QuadNode* n00 = node->nw;
+            QuadNode* n01 = node->ne;
+            QuadNode* n10 = node->sw;
+            QuadNode* n11 = node->se;
+
+            // 9 overlapping sub-quadrants at level (k-1)
+            QuadNode* c01 = pool_.make(n00->ne, n01->nw, n00->se, n01->sw);
+            QuadNode* c10 = pool_.make(n00->sw, n00->se, n10->nw, n10->ne);
+            QuadNode* c11 = pool_.make(n00->se, n01->sw, n10->ne, n11->nw);
+            QuadNode* c12 = pool_.make(n01->sw, n01->se, n11->nw, n11->ne);
+            QuadNode* c21 = pool_.make(n10->ne, n11->nw, n10->se, n11->sw);
+
+            // Take centers (no simulation)
+            QuadNode* r00 = center(n00);
+            QuadNode* r01 = center(c01);
+            QuadNode* r02 = center(n01);
+            QuadNode* r10 = center(c10);
+            QuadNode* r11 = center(c11);
+            QuadNode* r12 = center(c12);
+            QuadNode* r20 = center(n10);
+            QuadNode* r21 = center(c21);
+            QuadNode* r22 = center(n11);
+
+            // Assemble and step each quadrant
+            out = pool_.make(
+                step<Metrics>(pool_.make(r00, r01, r10, r11), j),
+                step<Metrics>(pool_.make(r01, r02, r11, r12), j),
+                step<Metrics>(pool_.make(r10, r11, r20, r21), j),
+                step<Metrics>(pool_.make(r11, r12, r21, r22), j)
+            );
+        }
+
+        if (j == 0) {
+            node->step1_result = out;
+        } else {
+            partial_memo_.emplace(node, out);
+        }
+        return out;
+    }
+
+    // result: classic HashLife. Advance a level-k node by 2^(k-2)
+    // generations by stepping twice at half the step size.
+    template <bool Metrics>
+    QuadNode* result(QuadNode* node) {
+        if (node->result) {
+            if constexpr (Metrics) ++memo_hits_;
+            return node->result;
+        }
+        if constexpr (Metrics) ++memo_misses_;
 
         if (node->population == 0) {
-            node->step1_result = pool_.empty_node(node->level - 1);
-            return node->step1_result;
+            node->result = pool_.empty_node(node->level - 1);
+            return node->result;
         }
 
-        if (node->level == 2) {
-            node->step1_result = step_4x4(node);
-            return node->step1_result;
+        if (node->level == NodePool::kLeafLevel + 1) {
+            // 2 generations of the 8x8 board; the center 4x4 is exact
+            node->result = pool_.leaf(center_4x4(
+                leaf_kernel_(rule_, leaf_kernel_(rule_, board_8x8(node)))));
+            return node->result;
         }
 
         QuadNode* n00 = node->nw;
@@ -377,80 +1208,249 @@ private:
         QuadNode* n10 = node->sw;
         QuadNode* n11 = node->se;
 
-        // 9 overlapping sub-quadrants at level (k-1)
-        QuadNode* c01 = pool_.make(n00->ne, n01->nw, n00->se, n01->sw);
-        QuadNode* c10 = pool_.make(n00->sw, n00->se, n10->nw, n10->ne);
-        QuadNode* c11 = pool_.make(n00->se, n01->sw, n10->ne, n11->nw);
-        QuadNode* c12 = pool_.make(n01->sw, n01->se, n11->nw, n11->ne);
-        QuadNode* c21 = pool_.make(n10->ne, n11->nw, n10->se, n11->sw);
-
-        // Take centers (no simulation)
-        QuadNode* r00 = center(n00);
-        QuadNode* r01 = center(c01);
-        QuadNode* r02 = center(n01);
-        QuadNode* r10 = center(c10);
-        QuadNode* r11 = center(c11);
-        QuadNode* r12 = center(c12);
-        QuadNode* r20 = center(n10);
-        QuadNode* r21 = center(c21);
-        QuadNode* r22 = center(n11);
-
-        // Assemble and step each quadrant
-        node->step1_result = pool_.make(
-            slow_step(pool_.make(r00, r01, r10, r11)),
-            slow_step(pool_.make(r01, r02, r11, r12)),
-            slow_step(pool_.make(r10, r11, r20, r21)),
-            slow_step(pool_.make(r11, r12, r21, r22))
+        // 9 overlapping sub-quadrants at level (k-1), each advanced 2^(k-3)
+        QuadNode* r00 = result<Metrics>(n00);
+        QuadNode* r01 = result<Metrics>(pool_.make(n00->ne, n01->nw, n00->se, n01->sw));
+        QuadNode* r02 = result<Metrics>(n01);
+        QuadNode* r10 = result<Metrics>(pool_.make(n00->sw, n00->se, n10->nw, n10->ne));
+        QuadNode* r11 = result<Metrics>(pool_.make(n00->se, n01->sw, n10->ne, n11->nw));
+        QuadNode* r12 = result<Metrics>(pool_.make(n01->sw, n01->se, n11->nw, n11->ne));
+        QuadNode* r20 = result<Metrics>(n10);
+        QuadNode* r21 = result<Metrics>(pool_.make(n10->ne, n11->nw, n10->se, n11->sw));
+        QuadNode* r22 = result<Metrics>(n11);
+
+        // Assemble and advance each quadrant another 2^(k-3)
+        node->result = pool_.make(
+            result<Metrics>(pool_.make(r00, r01, r10, r11)),
+            result<Metrics>(pool_.make(r01, r02, r11, r12)),
+            result<Metrics>(pool_.make(r10, r11, r20, r21)),
+            result<Metrics>(pool_.make(r11, r12, r21, r22))
         );
-        return node->step1_result;
-    }
-
-    // Directly compute the center 2x2 of a 4x4 node (level 2)
-    QuadNode* step_4x4(QuadNode* node) {
-        int g[4][4];
-        g[0][0] = static_cast<int>(node->nw->nw->population);
-        g[1][0] = static_cast<int>(node->nw->ne->population);
-        g[2][0] = static_cast<int>(node->ne->nw->population);
-        g[3][0] = static_cast<int>(node->ne->ne->population);
-        g[0][1] = static_cast<int>(node->nw->sw->population);
-        g[1][1] = static_cast<int>(node->nw->se->population);
-        g[2][1] = static_cast<int>(node->ne->sw->population);
-        g[3][1] = static_cast<int>(node->ne->se->population);
-        g[0][2] = static_cast<int>(node->sw->nw->population);
-        g[1][2] = static_cast<int>(node->sw->ne->population);
-        g[2][2] = static_cast<int>(node->se->nw->population);
-        g[3][2] = static_cast<int>(node->se->ne->population);
-        g[0][3] = static_cast<int>(node->sw->sw->population);
-        g[1][3] = static_cast<int>(node->sw->se->population);
-        g[2][3] = static_cast<int>(node->se->sw->population);
-        g[3][3] = static_cast<int>(node->se->se->population);
-
-        auto life_rule = [&](int cx, int cy) -> bool {
-            int count = 0;
-            for (int dy = -1; dy <= 1; dy++) {
-                for (int dx = -1; dx <= 1; dx++) {
-                    if (dx == 0 && dy == 0) continue;
-                    count += g[cx + dx][cy + dy];
-                }
+        return node->result;
+    }
+
+    // Root centered on (0, 0) covering `cells`, as macrocell files place it
+    bool build_centered_root(const CellSet& cells) {
+        int64_t reach = 0;  // cells lie in [-reach, reach)
+        for (const auto& cell : cells) {
+            for (int64_t v : {cell.x, cell.y}) {
+                if (v == std::numeric_limits<int64_t>::min()) return false;
+                reach = std::max(reach, v < 0 ? -v : v + 1);
+            }
+        }
+        int level = NodePool::kLeafLevel + 1;
+        while ((int64_t(1) << (level - 1)) < reach) {
+            if (++level > kMaxRootLevel) return false;
+        }
+        int64_t half = int64_t(1) << (level - 1);
+        sorted_.build(cells);
+        root_ = build_recursive(-half, -half, level);
+        ox_ = oy_ = -half;
+        return true;
+    }
+
+    // Level-3 node from a macrocell leaf line
+    QuadNode* macrocell_leaf(const std::string& line) {
+        uint64_t board = 0;
+        int x = 0, y = 0;
+        for (char c : line) {
+            if (c == '$') {
+                x = 0;
+                ++y;
+                continue;
             }
-            bool alive = g[cx][cy] != 0;
-            return count == 3 || (count == 2 && alive);
+            if ((c != '.' && c != '*') || x >= 8 || y >= 8) {
+                throw std::runtime_error("Invalid macrocell file: bad leaf line '" + line + "'");
+            }
+            if (c == '*') board |= uint64_t(1) << (8 * y + x);
+            ++x;
+        }
+        auto quadrant = [this, board](int qx, int qy) {
+            uint16_t bits = 0;
+            for (int r = 0; r < 4; r++) {
+                bits |= static_cast<uint16_t>(((board >> (8 * (qy + r) + qx)) & 0xf) << (4 * r));
+            }
+            return pool_.leaf(bits);
         };
+        return pool_.make(quadrant(0, 0), quadrant(4, 0), quadrant(0, 4), quadrant(4, 4));
+    }
 
-        return pool_.make(
-            pool_.leaf(life_rule(1, 1)),
-            pool_.leaf(life_rule(2, 1)),
-            pool_.leaf(life_rule(1, 2)),
-            pool_.leaf(life_rule(2, 2))
-        );
+    // Node of level >= 4 from a "level nw ne sw se" line
+    QuadNode* macrocell_node(const std::string& line, const std::vector<QuadNode*>& nodes) {
+        auto bad = [&line](const char* why) {
+            return std::runtime_error("Invalid macrocell file: " + std::string(why) + " '" + line + "'");
+        };
+        const char* ptr = line.data();
+        const char* const end = ptr + line.size();
+        uint64_t fields[5];
+        for (auto& field : fields) {
+            while (ptr < end && (*ptr == ' ' || *ptr == '\t')) ++ptr;
+            auto [next, ec] = std::from_chars(ptr, end, field);
+            if (ec != std::errc{}) throw bad("malformed node line");
+            ptr = next;
+        }
+        while (ptr < end && (*ptr == ' ' || *ptr == '\t')) ++ptr;
+        if (ptr != end) throw bad("malformed node line");
+
+        uint64_t level = fields[0];
+        if (level <= 3) throw bad("unsupported (multi-state) node");
+        if (level > kMaxRootLevel) throw bad("node too large for int64_t coordinates");
+        QuadNode* children[4];
+        int64_t population = 0;
+        for (int i = 0; i < 4; i++) {
+            uint64_t n = fields[i + 1];
+            if (n >= nodes.size()) throw bad("forward or unknown node reference");
+            children[i] = n == 0 ? pool_.empty_node(static_cast<int>(level) - 1) : nodes[n];
+            if (children[i]->level + 1 != static_cast<int>(level)) throw bad("child level mismatch");
+            if (__builtin_add_overflow(population, children[i]->population, &population)) {
+                throw bad("too many live cells");
+            }
+        }
+        return pool_.make(children[0], children[1], children[2], children[3]);
+    }
+
+    // Post-order: children first, so references always point backwards.
+    // Empty nodes are written as 0.
+    uint64_t write_macrocell_node(std::ostream& out, const QuadNode* node,
+                                  std::unordered_map<const QuadNode*, uint64_t>& numbers,
+                                  uint64_t& next) {
+        if (node->population == 0) return 0;
+        auto it = numbers.find(node);
+        if (it != numbers.end()) return it->second;
+
+        if (node->level == NodePool::kLeafLevel + 1) {
+            uint64_t board = board_8x8(node);
+            std::string line;
+            for (int y = 0; y < 8; y++) {
+                uint64_t row = (board >> (8 * y)) & 0xff;
+                for (int x = 0; row >> x; x++) {
+                    line += (row >> x) & 1 ? '*' : '.';
+                }
+                line += '$';
+            }
+            // Trailing empty rows are implied
+            line.erase(line.find_last_not_of('$') + 2);
+            out << line << '\n';
+        } else {
+            uint64_t nw = write_macrocell_node(out, node->nw, numbers, next);
+            uint64_t ne = write_macrocell_node(out, node->ne, numbers, next);
+            uint64_t sw = write_macrocell_node(out, node->sw, numbers, next);
+            uint64_t se = write_macrocell_node(out, node->se, numbers, next);
+            out << node->level << ' ' << nw << ' ' << ne << ' ' << sw << ' ' << se << '\n';
+        }
+        numbers.emplace(node, ++next);
+        return next;
+    }
+
+    // Distance from the west (axis 0) or north (axis 1) edge of `node` to its
+    // nearest live cell, measured from the east or south edge if `far_edge`;
+    // `limit` if no live cell is nearer. The half along the edge is searched
+    // first and anything that can't beat the best so far is pruned, so an
+    // edge costs about O(depth) nodes rather than a walk of the tree.
+    static int64_t edge_distance(const QuadNode* node, int axis, bool far_edge, int64_t limit) {
+        if (node->population == 0 || limit <= 0) return limit;
+
+        if (node->level == NodePool::kLeafLevel) {
+            unsigned lines = 0;  // bit d: a live cell at distance d
+            for (int i = 0; i < 4; i++) {
+                uint32_t line = axis == 0 ? 0x1111u << i : 0xFu << (4 * i);
+                if (node->bits & line) lines |= 1u << (far_edge ? 3 - i : i);
+            }
+            return std::min<int64_t>(limit, __builtin_ctz(lines));
+        }
+
+        const QuadNode* west[2] = {node->nw, node->sw};
+        const QuadNode* east[2] = {node->ne, node->se};
+        const QuadNode* north[2] = {node->nw, node->ne};
+        const QuadNode* south[2] = {node->sw, node->se};
+        const QuadNode* const* near = axis == 0 ? (far_edge ? east : west) : (far_edge ? south : north);
+        const QuadNode* const* far = axis == 0 ? (far_edge ? west : east) : (far_edge ? north : south);
+        const int64_t half = int64_t(1) << (node->level - 1);
+        for (int i = 0; i < 2; i++) {
+            limit = edge_distance(near[i], axis, far_edge, limit);
+        }
+        for (int i = 0; i < 2 && limit > half; i++) {
+            limit = half + edge_distance(far[i], axis, far_edge, limit - half);
+        }
+        return limit;
+    }
+
+    // Append the live cells of `node` (at x, y) inside `rect` to `out`,
+    // skipping subtrees that are empty or miss `rect`.
+    static void collect_rect(const QuadNode* node, int64_t x, int64_t y, const BoundingBox& rect,
+                             std::vector<Cell>& out) {
+        if (node->population == 0) return;
+
+        using Wide = __int128;
+        const Wide last = (Wide(1) << node->level) - 1;
+        if (Wide(x) + last < rect.min_x || x > rect.max_x || Wide(y) + last < rect.min_y ||
+            y > rect.max_y) {
+            return;
+        }
+
+        if (node->level == NodePool::kLeafLevel) {
+            for (uint32_t bits = node->bits; bits; bits &= bits - 1) {
+                int i = __builtin_ctz(bits);
+                Cell cell{x + (i & 3), y + (i >> 2)};
+                if (rect.contains(cell)) out.push_back(cell);
+            }
+            return;
+        }
+
+        int64_t half = int64_t(1) << (node->level - 1);
+        collect_rect(node->nw, x,        y,        rect, out);
+        collect_rect(node->ne, x + half, y,        rect, out);
+        collect_rect(node->sw, x,        y + half, rect, out);
+        collect_rect(node->se, x + half, y + half, rect, out);
+    }
+
+    // Add the population of `node` (at x, y) to the blocks of `grid` it
+    // covers. A node inside one block is counted whole from its population,
+    // so only nodes straddling block edges are split and the walk visits
+    // O(blocks + depth) nodes whatever the population.
+    static void count_node(const QuadNode* node, int64_t x, int64_t y, const BlockGrid& grid,
+                           std::vector<uint64_t>& counts) {
+        if (node->population == 0) return;
+
+        using Wide = __int128;
+        const Wide size = Wide(1) << node->level;
+        const Wide rx = Wide(x) - grid.min_x;
+        const Wide ry = Wide(y) - grid.min_y;
+        if (rx + size <= 0 || ry + size <= 0 || rx >= (Wide(grid.width) << grid.level) ||
+            ry >= (Wide(grid.height) << grid.level)) {
+            return;
+        }
+        if (rx >= 0 && ry >= 0 && (rx >> grid.level) == ((rx + size - 1) >> grid.level) &&
+            (ry >> grid.level) == ((ry + size - 1) >> grid.level)) {
+            size_t index = static_cast<size_t>(ry >> grid.level) * static_cast<size_t>(grid.width) +
+                           static_cast<size_t>(rx >> grid.level);
+            counts[index] += static_cast<uint64_t>(node->population);
+            return;
+        }
+
+        if (node->level == NodePool::kLeafLevel) {
+            size_t index;
+            for (uint32_t bits = node->bits; bits; bits &= bits - 1) {
+                int i = __builtin_ctz(bits);
+                if (grid.locate(x + (i & 3), y + (i >> 2), index)) ++counts[index];
+            }
+            return;
+        }
+
+        int64_t half = int64_t(1) << (node->level - 1);
+        count_node(node->nw, x,        y,        grid, counts);
+        count_node(node->ne, x + half, y,        grid, counts);
+        count_node(node->sw, x,        y + half, grid, counts);
+        count_node(node->se, x + half, y + half, grid, counts);
     }
 
     void flatten(QuadNode* node, int64_t x, int64_t y, CellSet& cells) {
         if (node->population == 0) return;
 
-        if (node->level == 0) {
-            if (node->population > 0) {
-                cells.insert({x, y});
+        if (node->level == NodePool::kLeafLevel) {
+            for (uint32_t bits = node->bits; bits; bits &= bits - 1) {
+                int i = __builtin_ctz(bits);
+                cells.insert({x + (i & 3), y + (i >> 2)});
             }
             return;
         }
@@ -466,3 +1466,7 @@ private:
 std::unique_ptr<SimulationEngine> create_hashlife_engine() {
     return std::make_unique<HashLifeEngine>();
 }
+
+std::unique_ptr<SimulationEngine> create_hashlife_fast_engine() {
+    return std::make_unique<HashLifeEngine>(true);
+}
@@ -1,11 +1,347 @@
 #include "engine.h"
+#include "parallel.h"
+#include "radix_sort.h"
+#include "rule.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// The parallel path shards the plane into vertical stripes 64 cells wide.
+// Stripe s = x >> kStripeBits belongs to shard s mod threads.
+constexpr int kStripeBits = 6;
+constexpr int64_t kStripeMask = (int64_t(1) << kStripeBits) - 1;
+
+// Below this population thread start-up costs more than it saves.
+constexpr size_t kParallelMinCells = size_t(1) << 14;
+
+// Cells whose keys are encoded and prefetched ahead of the packed count loop.
+constexpr size_t kPackedBatch = 16;
+
+// Count entries carry the cell's own state: each live cell adds kAlive to
+// its entry and 1 to each neighbor's, so one pass over the counts decides
+// birth and survival without looking anything up in the old CellSet.
+constexpr int kAlive = 0x10;
+constexpr int kCountMask = 0x0f;
+
+// Neighbor counts keyed by packed KeySpace coordinates: an open-addressed
+// table of 8-byte keys and 1-byte counts in separate arrays, 9 bytes a slot
+// against CellCountMap's 24-byte entries plus buckets. The arrays keep their
+// capacity from tick to tick; reset() only refills them.
+//
+// Keys are hashed in aligned groups of kGroup, and a key's home slot keeps
+// its offset within the group, so a cell's three vertical neighbors (keys
+// k - 1, k, k + 1) usually land in one cache line of each array.
+class PackedCountTable {
+public:
+    // Empty the table, sized for about `expected` keys.
+    void reset(size_t expected) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) capacity <<= 1;
+        if (keys_.size() < capacity || keys_.size() > capacity * 8) {
+            resize(capacity);
+        } else {
+            std::fill(keys_.begin(), keys_.end(), kEmpty);
+        }
+        size_ = 0;
+    }
+
+    // Add `amount` to the count of `key` (never kEmpty).
+    void add(uint64_t key, int amount) {
+        size_t slot = home(key);
+        while (true) {
+            if (keys_[slot] == key) {
+                counts_[slot] = static_cast<uint8_t>(counts_[slot] + amount);
+                return;
+            }
+            if (keys_[slot] == kEmpty) {
+                keys_[slot] = key;
+                counts_[slot] = static_cast<uint8_t>(amount);
+                if (++size_ * 2 > keys_.size()) grow();
+                return;
+            }
+            slot = (slot + 1) & mask_;
+        }
+    }
+
+    // Hint that `key` is about to be added.
+    void prefetch(uint64_t key) const noexcept {
+        size_t slot = home(key);
+        __builtin_prefetch(&keys_[slot], 1);
+        __builtin_prefetch(&counts_[slot], 1);
+    }
+
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (size_t i = 0; i < keys_.size(); i++) {
+            if (keys_[i] != kEmpty) fn(keys_[i], counts_[i]);
+        }
+    }
+
+    size_t size() const noexcept { return size_; }
+
+    // Times the table has doubled (rehashing every key) since it was made
+    uint64_t grows() const noexcept { return grows_; }
+
+    // Slots probed to find every key once: the sum of each key's distance
+    // from its home slot, plus one. Scans the whole table.
+    uint64_t probe_total() const noexcept {
+        uint64_t total = 0;
+        for (size_t i = 0; i < keys_.size(); i++) {
+            if (keys_[i] != kEmpty) total += ((i - home(keys_[i])) & mask_) + 1;
+        }
+        return total;
+    }
+
+private:
+    static constexpr uint64_t kEmpty = ~uint64_t(0);
+    static constexpr uint64_t kHashMultiplier = 0x9e3779b97f4a7c15ULL;
+    static constexpr int kGroupBits = 3;
+    static constexpr uint64_t kGroupMask = (uint64_t(1) << kGroupBits) - 1;
+
+    std::vector<uint64_t> keys_;
+    std::vector<uint8_t> counts_;
+    size_t mask_ = 0;
+    int shift_ = 64;
+    size_t size_ = 0;
+    uint64_t grows_ = 0;
+
+    void resize(size_t capacity) {
+        keys_.assign(capacity, kEmpty);
+        counts_.assign(capacity, 0);
+        mask_ = capacity - 1;
+        shift_ = 64 - (__builtin_ctzll(capacity) - kGroupBits);
+    }
+
+    size_t home(uint64_t key) const noexcept {
+        size_t group = static_cast<size_t>(((key >> kGroupBits) * kHashMultiplier) >> shift_);
+        return (group << kGroupBits) | static_cast<size_t>(key & kGroupMask);
+    }
+
+    void grow() {
+        ++grows_;
+        std::vector<uint64_t> keys = std::move(keys_);
+        std::vector<uint8_t> counts = std::move(counts_);
+        resize(keys.size() * 2);
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == kEmpty) continue;
+            size_t slot = home(keys[i]);
+            while (keys_[slot] != kEmpty) slot = (slot + 1) & mask_;
+            keys_[slot] = keys[i];
+            counts_[slot] = counts[i];
+        }
+    }
+};
+
+} // anonymous namespace
 
 class HashtableEngine : public SimulationEngine {
 public:
     void tick(CellSet& cells) override {
+        step(cells, cells);
+    }
+
+    // Every path reads `current` in full before replacing `next`, so the two
+    // may be the same set; distinct, `current` is never written.
+    void tick_into(const CellSet& current, CellSet& next) override {
+        step(current, next);
+    }
+
+    [[nodiscard]] std::unique_ptr<SimulationEngine> clone() const override {
+        auto copy = std::make_unique<HashtableEngine>();
+        copy->threads_ = threads_;
+        copy->rule_ = rule_;
+        copy->metrics_ = metrics_;
+        copy->track_changes_ = track_changes_;
+        copy->changes_ = changes_;
+        return copy;
+    }
+
+    [[nodiscard]] EngineType type() const noexcept override {
+        return EngineType::Hashtable;
+    }
+
+    void set_threads(unsigned threads) override {
+        threads_ = std::max(threads, 1u);
+    }
+
+    void set_rule(const Rule& rule) override {
+        rule_ = rule;
+    }
+
+    [[nodiscard]] Rule rule() const noexcept override {
+        return rule_;
+    }
+
+    void set_metrics(bool enabled) override {
+        metrics_ = enabled;
+        stats_ = Stats{};
+        grows_seen_ = packed_counts_.grows();
+    }
+
+    std::vector<EngineCounter> take_metrics() override {
+        std::vector<EngineCounter> out = {
+            {"packed_ticks", stats_.packed_ticks},
+            {"serial_ticks", stats_.serial_ticks},
+            {"parallel_ticks", stats_.parallel_ticks},
+            {"count_entries", stats_.count_entries},
+            {"probes", stats_.probes},
+            {"rehashes", packed_counts_.grows() - grows_seen_},
+        };
+        stats_ = Stats{};
+        grows_seen_ = packed_counts_.grows();
+        return out;
+    }
+
+    bool set_track_changes(bool enabled) override {
+        track_changes_ = enabled;
+        changes_.clear();
+        return true;
+    }
+
+    void take_changes(ChangeLog& log) override {
+        log.absorb(changes_);
+    }
+
+private:
+    // Metrics since the last take_metrics(). Probes are only known for the
+    // packed table; entries count every path's neighbor-count keys.
+    struct Stats {
+        uint64_t packed_ticks = 0;
+        uint64_t serial_ticks = 0;
+        uint64_t parallel_ticks = 0;
+        uint64_t count_entries = 0;
+        uint64_t probes = 0;
+    };
+
+    // Scratch owned by one worker thread during tick_parallel()
+    struct Shard {
+        std::vector<std::vector<Cell>> outbox;  // outbox[o]: cells routed to shard o
+        CellCountMap counts;
+        std::vector<Cell> born;
+        std::vector<Cell> turned_on;   // with change tracking: births
+        std::vector<Cell> turned_off;  // and deaths, folded in after the tick
+    };
+
+    CellCountMap neighbor_count_buffer_;
+    CellSet new_cells_buffer_;
+    PackedCountTable packed_counts_;
+    unsigned threads_ = 1;
+    Rule rule_;
+    std::vector<Shard> shards_;
+    std::vector<Cell> input_;
+    std::vector<Cell> merged_;
+    bool metrics_ = false;
+    Stats stats_;
+    uint64_t grows_seen_ = 0;
+    bool track_changes_ = false;
+    ChangeLog changes_;
+
+    void step(const CellSet& cells, CellSet& next) {
+        with_rule(rule_, [&](auto rule) {
+            if (threads_ > 1 && cells.size() >= kParallelMinCells) {
+                tick_parallel(cells, next, rule);
+                if (metrics_) {
+                    stats_.parallel_ticks++;
+                    for (const auto& shard : shards_) stats_.count_entries += shard.counts.size();
+                }
+            } else if (tick_packed(cells, next, rule)) {
+                if (metrics_) {
+                    stats_.packed_ticks++;
+                    stats_.count_entries += packed_counts_.size();
+                    stats_.probes += packed_counts_.probe_total();
+                }
+            } else {
+                tick_serial(cells, next, rule);
+                if (metrics_) {
+                    stats_.serial_ticks++;
+                    stats_.count_entries += neighbor_count_buffer_.size();
+                }
+            }
+        });
+    }
+
+    unsigned owner(int64_t stripe) const noexcept {
+        return static_cast<unsigned>(static_cast<uint64_t>(stripe) % threads_);
+    }
+
+    // The serial tick over packed keys, for cells whose bounding box (plus a
+    // 1-cell margin) packs into fewer than 64 bits. Returns false, having
+    // done nothing, for wider universes; tick_serial() handles those.
+    template <typename R>
+    bool tick_packed(const CellSet& cells, CellSet& next, const R& rule) {
+        if (cells.empty()) return false;
+        int64_t min_x = cells.begin()->x, max_x = min_x;
+        int64_t min_y = cells.begin()->y, max_y = min_y;
+        for (const auto& cell : cells) {
+            min_x = std::min(min_x, cell.x);
+            max_x = std::max(max_x, cell.x);
+            min_y = std::min(min_y, cell.y);
+            max_y = std::max(max_y, cell.y);
+        }
+        // Keys stay below 2^63, clear of the table's empty marker
+        KeySpace space;
+        if (!space.init(min_x, max_x, min_y, max_y) || space.bits > 63) return false;
+
+#if USE_FAST_HASH
+        const std::vector<Cell>& input = cells.values();
+#else
+        input_.assign(cells.begin(), cells.end());
+        const std::vector<Cell>& input = input_;
+#endif
+
+        // Neighbors are fixed offsets from a key, since the margin keeps
+        // every neighbor inside the key space. Keys are encoded a batch
+        // ahead, and the batch's columns are prefetched before any is added.
+        const uint64_t column = uint64_t(1) << space.ybits;
+        packed_counts_.reset(cells.size() * 4);
+        uint64_t batch[2][kPackedBatch];
+        auto load = [&](size_t begin, uint64_t* keys) {
+            size_t end = std::min(begin + kPackedBatch, input.size());
+            for (size_t i = begin; i < end; i++) {
+                uint64_t key = space.encode(input[i].x, input[i].y);
+                keys[i - begin] = key;
+                packed_counts_.prefetch(key - column);
+                packed_counts_.prefetch(key);
+                packed_counts_.prefetch(key + column);
+            }
+        };
+        load(0, batch[0]);
+        for (size_t begin = 0, b = 0; begin < input.size(); begin += kPackedBatch, b ^= 1) {
+            load(begin + kPackedBatch, batch[b ^ 1]);
+            size_t count = std::min(kPackedBatch, input.size() - begin);
+            for (size_t i = 0; i < count; i++) {
+                uint64_t key = batch[b][i];
+                for (uint64_t middle : {key - column, key + column}) {
+                    packed_counts_.add(middle - 1, 1);
+                    packed_counts_.add(middle, 1);
+                    packed_counts_.add(middle + 1, 1);
+                }
+                packed_counts_.add(key - 1, 1);
+                packed_counts_.add(key, kAlive);
+                packed_counts_.add(key + 1, 1);
+            }
+        }
+
+        merged_.clear();
+        packed_counts_.for_each([&](uint64_t key, uint8_t entry) {
+            bool alive = (entry & kAlive) != 0;
+            bool next = next_state(rule, entry & kCountMask, [&] { return alive; });
+            if (next) merged_.push_back(space.decode(key));
+            if (track_changes_ && next != alive) changes_.flip(space.decode(key), next);
+        });
+        adopt_merged(next);
+        return true;
+    }
+
+    template <typename R>
+    void tick_serial(const CellSet& cells, CellSet& next, const R& rule) {
         neighbor_count_buffer_.clear();
 
         for (const auto& cell : cells) {
+            // Cells at the int64_t limits keep their state but count nothing
+            neighbor_count_buffer_[cell] += kAlive;
             if (GameOfLife::would_overflow(cell.x, cell.y)) {
                 continue;
             }
@@ -20,29 +356,140 @@ public:
             ++neighbor_count_buffer_[{cell.x + 1, cell.y + 1}];
         }
 
-        new_cells_buffer_.clear();
-        new_cells_buffer_.reserve(cells.size());
-
+        merged_.clear();
         for (const auto& [cell, count] : neighbor_count_buffer_) {
-            if (count == 3 || (count == 2 && cells.find(cell) != cells.end())) {
-                new_cells_buffer_.insert(cell);
+            bool alive = (count & kAlive) != 0;
+            bool next = next_state(rule, static_cast<unsigned>(count & kCountMask),
+                                   [&] { return alive; });
+            if (next) merged_.push_back(cell);
+            if (track_changes_ && next != alive) changes_.flip(cell, next);
+        }
+        adopt_merged(next);
+    }
+
+    // Same result as the serial loop, computed in three phases:
+    //   1. Route: each thread takes a slice of the live cells and files every
+    //      cell under the shard owning its stripe. Cells in the first or last
+    //      column of a stripe are also copied to the neighboring stripe's
+    //      owner (the halo), since they contribute counts there.
+    //   2. Count: each shard counts neighbors into its own map, keeping only
+    //      coordinates in stripes it owns, and applies the rules. Ownership is
+    //      disjoint, so no count is split across shards.
+    //   3. Merge: the per-shard births are disjoint, so they're concatenated
+    //      and handed to the output set without deduplication or locking.
+    template <typename R>
+    void tick_parallel(const CellSet& cells, CellSet& next, const R& rule) {
+        const unsigned n = threads_;
+        if (shards_.size() != n) {
+            shards_.assign(n, Shard{});
+            for (auto& shard : shards_) {
+                shard.outbox.resize(n);
             }
         }
 
-        std::swap(cells, new_cells_buffer_);
-    }
+#if USE_FAST_HASH
+        const std::vector<Cell>& input = cells.values();
+#else
+        input_.assign(cells.begin(), cells.end());
+        const std::vector<Cell>& input = input_;
+#endif
 
-    [[nodiscard]] std::unique_ptr<SimulationEngine> clone() const override {
-        return std::make_unique<HashtableEngine>();
-    }
+        parallel_for(n, [&](unsigned t) {
+            Shard& shard = shards_[t];
+            for (auto& box : shard.outbox) {
+                box.clear();
+            }
+            size_t begin = input.size() * t / n;
+            size_t end = input.size() * (t + 1) / n;
+            for (size_t i = begin; i < end; i++) {
+                const Cell& cell = input[i];
+                int64_t stripe = cell.x >> kStripeBits;
+                unsigned home = owner(stripe);
+                shard.outbox[home].push_back(cell);
+                if (GameOfLife::would_overflow(cell.x, cell.y)) {
+                    continue;
+                }
 
-    [[nodiscard]] EngineType type() const noexcept override {
-        return EngineType::Hashtable;
+                int64_t column = cell.x & kStripeMask;
+                if (column == 0 || column == kStripeMask) {
+                    unsigned halo = owner(column == 0 ? stripe - 1 : stripe + 1);
+                    if (halo != home) {
+                        shard.outbox[halo].push_back(cell);
+                    }
+                }
+            }
+        });
+
+        parallel_for(n, [&](unsigned o) {
+            Shard& shard = shards_[o];
+            shard.counts.clear();
+            for (const auto& from : shards_) {
+                for (const auto& cell : from.outbox[o]) {
+                    // Halo copies live in another shard's stripe
+                    if (owner(cell.x >> kStripeBits) == o) {
+                        shard.counts[cell] += kAlive;
+                        if (GameOfLife::would_overflow(cell.x, cell.y)) continue;
+                    }
+                    for (int64_t dx = -1; dx <= 1; dx++) {
+                        int64_t x = cell.x + dx;
+                        if (owner(x >> kStripeBits) != o) continue;
+                        if (dx != 0) ++shard.counts[{x, cell.y}];
+                        ++shard.counts[{x, cell.y - 1}];
+                        ++shard.counts[{x, cell.y + 1}];
+                    }
+                }
+            }
+
+            shard.born.clear();
+            shard.turned_on.clear();
+            shard.turned_off.clear();
+            for (const auto& [cell, count] : shard.counts) {
+                bool alive = (count & kAlive) != 0;
+                bool next = next_state(rule, static_cast<unsigned>(count & kCountMask),
+                                       [&] { return alive; });
+                if (next) shard.born.push_back(cell);
+                if (track_changes_ && next != alive) {
+                    (next ? shard.turned_on : shard.turned_off).push_back(cell);
+                }
+            }
+        });
+
+        if (track_changes_) {
+            for (const auto& shard : shards_) {
+                for (const auto& cell : shard.turned_on) changes_.flip(cell, true);
+                for (const auto& cell : shard.turned_off) changes_.flip(cell, false);
+            }
+        }
+
+        merged_.clear();
+        size_t total = 0;
+        for (const auto& shard : shards_) {
+            total += shard.born.size();
+        }
+        merged_.reserve(total);
+        for (const auto& shard : shards_) {
+            merged_.insert(merged_.end(), shard.born.begin(), shard.born.end());
+        }
+
+        adopt_merged(next);
     }
 
-private:
-    CellCountMap neighbor_count_buffer_;
-    CellSet new_cells_buffer_;
+    // Make the distinct cells in merged_ the next generation, in `next`.
+    void adopt_merged(CellSet& next) {
+#if USE_FAST_HASH
+        // Adopt the vector as the set's storage; keep the old storage as
+        // next tick's merge buffer.
+        new_cells_buffer_.replace(std::move(merged_));
+        std::swap(next, new_cells_buffer_);
+        merged_ = std::move(new_cells_buffer_).extract();
+        new_cells_buffer_.clear();
+#else
+        new_cells_buffer_.clear();
+        new_cells_buffer_.reserve(merged_.size());
+        new_cells_buffer_.insert(merged_.begin(), merged_.end());
+        std::swap(next, new_cells_buffer_);
+#endif
+    }
 };
 
 std::unique_ptr<SimulationEngine> create_hashtable_engine() {
@@ -1,16 +1,332 @@
 #include "engine.h"
+#include "radix_sort.h"
+#include "rule.h"
 #include <algorithm>
+#include <chrono>
+#include <limits>
 #include <vector>
 
 class SortedVectorEngine : public SimulationEngine {
 public:
     void tick(CellSet& cells) override {
-        // 1. Copy live cells to sorted vector
-        sorted_alive_.clear();
-        sorted_alive_.reserve(cells.size());
+        advance(cells, 1);
+    }
+
+    void advance(CellSet& cells, uint64_t generations) override {
+        if (generations == 0) return;
+
+        // 1. Copy live cells to a sorted vector (only when not retained)
+        if (!loaded_) {
+            load(cells);
+        }
+
+        // Each step emits the next generation already sorted, and the result
+        // stays in sorted_alive_ between calls, so the sort of live cells is
+        // paid once rather than per tick.
+        for (uint64_t g = 0; g < generations; g++) {
+            step();
+            if (track_changes_) note_changes();
+            std::swap(sorted_alive_, next_alive_);
+            min_y_ = next_min_y_;
+            max_y_ = next_max_y_;
+        }
+    }
+
+    [[nodiscard]] std::unique_ptr<SimulationEngine> clone() const override {
+        auto copy = std::make_unique<SortedVectorEngine>();
+        copy->threads_ = threads_;
+        copy->rule_ = rule_;
+        copy->metrics_ = metrics_;
+        copy->track_changes_ = track_changes_;
+        copy->changes_ = changes_;
+        return copy;
+    }
+
+    [[nodiscard]] EngineType type() const noexcept override {
+        return EngineType::Sorted;
+    }
+
+    [[nodiscard]] bool retains_state() const noexcept override {
+        return loaded_;
+    }
+
+    void sync(CellSet& cells) override {
+        cells.clear();
+        cells.reserve(sorted_alive_.size());
+        for (const auto& cell : sorted_alive_) {
+            cells.insert(cell);
+        }
+    }
+
+    [[nodiscard]] size_t population() const noexcept override {
+        return sorted_alive_.size();
+    }
+
+    void set_threads(unsigned threads) override {
+        threads_ = std::max(threads, 1u);
+    }
+
+    void set_rule(const Rule& rule) override {
+        rule_ = rule;
+        loaded_ = false;
+    }
+
+    [[nodiscard]] Rule rule() const noexcept override {
+        return rule_;
+    }
+
+    void set_metrics(bool enabled) override {
+        metrics_ = enabled;
+        sort_ns_ = 0;
+        candidates_sorted_ = 0;
+    }
+
+    std::vector<EngineCounter> take_metrics() override {
+        std::vector<EngineCounter> out = {
+            {"sort_ns", sort_ns_},
+            {"candidates_sorted", candidates_sorted_},
+        };
+        sort_ns_ = 0;
+        candidates_sorted_ = 0;
+        return out;
+    }
+
+    bool set_track_changes(bool enabled) override {
+        track_changes_ = enabled;
+        changes_.clear();
+        return true;
+    }
+
+    void take_changes(ChangeLog& log) override {
+        log.absorb(changes_);
+    }
+
+    bool bounding_box(std::optional<BoundingBox>& box) const override {
+        box.reset();
+        if (!sorted_alive_.empty()) {
+            box = BoundingBox{sorted_alive_.front().x, sorted_alive_.back().x, min_y_, max_y_};
+        }
+        return true;
+    }
+
+    // Each column's run of cells is entered by binary search at rect.min_y
+    // and left at rect.max_y, so cells outside the rect's rows are skipped
+    // rather than visited.
+    bool cells_in_rect(const BoundingBox& rect, std::vector<Cell>& out) const override {
+        auto it = std::lower_bound(sorted_alive_.begin(), sorted_alive_.end(),
+                                   Cell{rect.min_x, rect.min_y}, cell_less);
+        while (it != sorted_alive_.end() && it->x <= rect.max_x) {
+            if (it->y < rect.min_y) {
+                it = std::lower_bound(it, sorted_alive_.end(), Cell{it->x, rect.min_y}, cell_less);
+            } else if (it->y > rect.max_y) {
+                if (it->x == std::numeric_limits<int64_t>::max()) break;
+                it = std::lower_bound(it, sorted_alive_.end(), Cell{it->x + 1, rect.min_y}, cell_less);
+            } else {
+                out.push_back(*it++);
+            }
+        }
+        return true;
+    }
+
+private:
+    std::vector<Cell> sorted_alive_;
+    std::vector<Cell> next_alive_;
+    std::vector<Cell> candidates_;
+    std::vector<uint64_t> keys_;
+    std::vector<uint64_t> key_scratch_;
+    std::vector<size_t> radix_counts_;
+    unsigned threads_ = 1;
+    Rule rule_;
+    bool loaded_ = false;
+
+    // Metrics since the last take_metrics(): time in the candidate sorts,
+    // and candidates sorted
+    bool metrics_ = false;
+    uint64_t sort_ns_ = 0;
+    uint64_t candidates_sorted_ = 0;
+
+    bool track_changes_ = false;
+    ChangeLog changes_;
+
+    // y extent of sorted_alive_ (x comes free from the sort order), and of
+    // next_alive_ as step() emits it
+    int64_t min_y_ = 0, max_y_ = 0;
+    int64_t next_min_y_ = 0, next_max_y_ = 0;
+
+    static bool cell_less(const Cell& a, const Cell& b) noexcept {
+        if (a.x != b.x) return a.x < b.x;
+        return a.y < b.y;
+    }
+
+    // Run sort(), timing it into the metrics when they are on
+    template <typename Sort>
+    void timed_sort(size_t count, Sort&& sort) {
+        if (!metrics_) {
+            sort();
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        sort();
+        sort_ns_ += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                              std::chrono::steady_clock::now() - start)
+                                              .count());
+        candidates_sorted_ += count;
+    }
+
+    void load(const CellSet& cells) {
         sorted_alive_.assign(cells.begin(), cells.end());
-        std::sort(sorted_alive_.begin(), sorted_alive_.end(), cell_less);
+        loaded_ = true;
+        if (sorted_alive_.empty()) return;
+
+        int64_t min_x = sorted_alive_[0].x, max_x = min_x;
+        int64_t min_y = sorted_alive_[0].y, max_y = min_y;
+        for (const auto& cell : sorted_alive_) {
+            min_x = std::min(min_x, cell.x);
+            max_x = std::max(max_x, cell.x);
+            min_y = std::min(min_y, cell.y);
+            max_y = std::max(max_y, cell.y);
+        }
+        min_y_ = min_y;
+        max_y_ = max_y;
+
+        KeySpace space;
+        if (!space.init(min_x, max_x, min_y, max_y)) {
+            std::sort(sorted_alive_.begin(), sorted_alive_.end(), cell_less);
+            return;
+        }
+        keys_.resize(sorted_alive_.size());
+        for (size_t i = 0; i < sorted_alive_.size(); i++) {
+            keys_[i] = space.encode(sorted_alive_[i].x, sorted_alive_[i].y);
+        }
+        radix_sort(keys_, key_scratch_, radix_counts_, space.bits, threads_);
+        for (size_t i = 0; i < keys_.size(); i++) {
+            sorted_alive_[i] = space.decode(keys_[i]);
+        }
+    }
+
+    // Both generations are sorted, so one merge walk finds the cells in only
+    // one of them: the births and deaths
+    void note_changes() {
+        size_t i = 0, j = 0;
+        while (i < sorted_alive_.size() || j < next_alive_.size()) {
+            if (j == next_alive_.size() ||
+                (i < sorted_alive_.size() && cell_less(sorted_alive_[i], next_alive_[j]))) {
+                changes_.flip(sorted_alive_[i++], false);
+            } else if (i == sorted_alive_.size() || cell_less(next_alive_[j], sorted_alive_[i])) {
+                changes_.flip(next_alive_[j++], true);
+            } else {
+                ++i;
+                ++j;
+            }
+        }
+    }
+
+    // Compute the generation after sorted_alive_ into next_alive_ (sorted).
+    void step() {
+        next_alive_.clear();
+        next_min_y_ = std::numeric_limits<int64_t>::max();
+        next_max_y_ = std::numeric_limits<int64_t>::min();
+        if (sorted_alive_.empty()) return;
+
+        KeySpace space;
+        bool packed = space.init(sorted_alive_.front().x, sorted_alive_.back().x, min_y_, max_y_);
+        with_rule(rule_, [&](auto rule) {
+            if (packed) {
+                step_radix(space, rule);
+            } else {
+                step_generic(rule);
+            }
+        });
+    }
+
+    // Append a cell of the next generation (in sorted order)
+    void emit(const Cell& cell) {
+        next_alive_.push_back(cell);
+        next_min_y_ = std::min(next_min_y_, cell.y);
+        next_max_y_ = std::max(next_max_y_, cell.y);
+    }
 
+    // Apply `rule` to a candidate with `count` live neighbors, reached in
+    // sorted order; cell() decodes it. `alive` is a cursor into the live
+    // cells moving in step with the candidates. Under S0 the live cells it
+    // passes got no candidates (no live neighbors), so they survive.
+    template <typename R, typename GetCell>
+    void apply(const R& rule, unsigned count, size_t& alive, GetCell&& cell) {
+        const bool zero_survives = rule.survive & 1u;
+        const bool born = (rule.birth >> count) & 1u;
+        const bool kept = (rule.survive >> count) & 1u;
+        if (born == kept && !zero_survives) {
+            if (born) emit(cell());
+            return;
+        }
+
+        const Cell current = cell();
+        while (alive < sorted_alive_.size() && cell_less(sorted_alive_[alive], current)) {
+            if (zero_survives) emit(sorted_alive_[alive]);
+            ++alive;
+        }
+        const bool is_alive = alive < sorted_alive_.size() && sorted_alive_[alive] == current;
+        alive += is_alive;
+        if (is_alive ? kept : born) emit(current);
+    }
+
+    // Under S0, the live cells after the last candidate survive
+    template <typename R>
+    void finish(const R& rule, size_t alive) {
+        if (!(rule.survive & 1u)) return;
+        while (alive < sorted_alive_.size()) {
+            emit(sorted_alive_[alive++]);
+        }
+    }
+
+    // Candidates as packed keys, radix sorted; rules applied in one merge
+    // walk against the (sorted) live cells.
+    template <typename R>
+    void step_radix(const KeySpace& space, const R& rule) {
+        // 2. Emit 8 neighbor keys per cell (no cell is at the int64_t limits)
+        const size_t n = sorted_alive_.size();
+        keys_.resize(n * 8);
+        unsigned threads = n * 8 >= kParallelMinKeys ? threads_ : 1;
+        parallel_for(threads, [&](unsigned t) {
+            for (size_t i = n * t / threads, end = n * (t + 1) / threads; i < end; i++) {
+                const Cell& cell = sorted_alive_[i];
+                uint64_t* out = &keys_[i * 8];
+                out[0] = space.encode(cell.x - 1, cell.y - 1);
+                out[1] = space.encode(cell.x,     cell.y - 1);
+                out[2] = space.encode(cell.x + 1, cell.y - 1);
+                out[3] = space.encode(cell.x - 1, cell.y);
+                out[4] = space.encode(cell.x + 1, cell.y);
+                out[5] = space.encode(cell.x - 1, cell.y + 1);
+                out[6] = space.encode(cell.x,     cell.y + 1);
+                out[7] = space.encode(cell.x + 1, cell.y + 1);
+            }
+        });
+
+        // 3. Sort candidates
+        timed_sort(keys_.size(), [&] {
+            radix_sort(keys_, key_scratch_, radix_counts_, space.bits, threads_);
+        });
+
+        // 4. Walk sorted keys counting runs → neighbor count
+        // 5. Apply rules; live cells are matched by a cursor moving in step
+        size_t alive = 0;
+        size_t i = 0;
+        while (i < keys_.size()) {
+            uint64_t key = keys_[i];
+            size_t count = 1;
+            while (i + count < keys_.size() && keys_[i + count] == key) {
+                ++count;
+            }
+
+            apply(rule, static_cast<unsigned>(count), alive, [&] { return space.decode(key); });
+            i += count;
+        }
+        finish(rule, alive);
+    }
+
+    // Fallback for universes whose extent doesn't fit packed keys
+    template <typename R>
+    void step_generic(const R& rule) {
         // 2. Emit 8 neighbor coords per cell into candidates
         candidates_.clear();
         candidates_.reserve(sorted_alive_.size() * 8);
@@ -29,52 +345,27 @@ public:
         }
 
         // 3. Sort candidates
-        std::sort(candidates_.begin(), candidates_.end(), cell_less);
+        timed_sort(candidates_.size(), [&] {
+            std::sort(candidates_.begin(), candidates_.end(), cell_less);
+        });
 
         // 4. Walk sorted candidates counting runs → neighbor count
-        // 5. Apply rules
-        cells.clear();
-        if (candidates_.empty()) return;
-
+        // 5. Apply rules, matching live cells with a cursor as above
+        size_t alive = 0;
         size_t i = 0;
         while (i < candidates_.size()) {
             Cell current = candidates_[i];
-            int count = 1;
+            size_t count = 1;
             while (i + count < candidates_.size() &&
                    candidates_[i + count].x == current.x &&
                    candidates_[i + count].y == current.y) {
                 ++count;
             }
 
-            // count==3 → alive; count==2 → alive if currently alive (binary search)
-            if (count == 3) {
-                cells.insert(current);
-            } else if (count == 2) {
-                if (std::binary_search(sorted_alive_.begin(), sorted_alive_.end(),
-                                       current, cell_less)) {
-                    cells.insert(current);
-                }
-            }
-
+            apply(rule, static_cast<unsigned>(count), alive, [&] { return current; });
             i += count;
         }
-    }
-
-    [[nodiscard]] std::unique_ptr<SimulationEngine> clone() const override {
-        return std::make_unique<SortedVectorEngine>();
-    }
-
-    [[nodiscard]] EngineType type() const noexcept override {
-        return EngineType::Sorted;
-    }
-
-private:
-    std::vector<Cell> sorted_alive_;
-    std::vector<Cell> candidates_;
-
-    static bool cell_less(const Cell& a, const Cell& b) noexcept {
-        if (a.x != b.x) return a.x < b.x;
-        return a.y < b.y;
+        finish(rule, alive);
     }
 };
 
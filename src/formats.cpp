@@ -0,0 +1,285 @@
+#include "game_of_life.h"
+#include "engine.h"
+#include "radix_sort.h"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// =============================================================================
+// RLE and macrocell pattern formats
+//
+// RLE is parsed straight into a CellSet. Macrocell files are handed to the
+// engine, which for HashLife builds the quadtree node by node; other engines
+// get the expanded cells.
+// =============================================================================
+
+namespace {
+
+std::string_view trim(std::string_view s) noexcept {
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string_view::npos) return {};
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+bool parse_int(std::string_view s, int64_t& value) noexcept {
+    s = trim(s);
+    auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    return ec == std::errc{} && end == s.data() + s.size() && !s.empty();
+}
+
+[[noreturn]] void rle_error(const std::string& what) {
+    throw std::runtime_error("Invalid RLE file: " + what);
+}
+
+// "x = 3, y = 3, rule = B3/S23"
+void parse_rle_header(std::string_view line, Rule& rule) {
+    bool has_x = false, has_y = false;
+    while (!line.empty()) {
+        size_t comma = line.find(',');
+        std::string_view field = line.substr(0, comma);
+        line = comma == std::string_view::npos ? std::string_view{} : line.substr(comma + 1);
+
+        size_t eq = field.find('=');
+        if (eq == std::string_view::npos) {
+            rle_error("malformed header field '" + std::string(trim(field)) + "'");
+        }
+        std::string_view key = trim(field.substr(0, eq));
+        std::string_view value = trim(field.substr(eq + 1));
+        int64_t size;
+        if (key == "x" || key == "y") {
+            if (!parse_int(value, size) || size < 0) {
+                rle_error("bad pattern size '" + std::string(value) + "'");
+            }
+            (key == "x" ? has_x : has_y) = true;
+        } else if (key == "rule") {
+            try {
+                rule = parse_rule(value);
+            } catch (const std::invalid_argument&) {
+                rle_error("unsupported rule '" + std::string(value) + "'");
+            }
+        }
+    }
+    if (!has_x || !has_y) {
+        rle_error("missing or invalid header (expected 'x = ..., y = ...')");
+    }
+}
+
+// "#CXRLE Pos=-3,-4 Gen=0": Golly's top-left corner for the pattern
+void parse_cxrle(std::string_view line, int64_t& ox, int64_t& oy) {
+    size_t pos = line.find("Pos=");
+    if (pos == std::string_view::npos) return;
+    std::string_view value = line.substr(pos + 4);
+    value = value.substr(0, value.find_first_of(" \t"));
+    size_t comma = value.find(',');
+    if (comma == std::string_view::npos || !parse_int(value.substr(0, comma), ox) ||
+        !parse_int(value.substr(comma + 1), oy)) {
+        rle_error("bad position '" + std::string(value) + "'");
+    }
+}
+
+// Cells sorted by (y, x), the order RLE rows are written in
+std::vector<Cell> rows_order(const CellSet& live_cells, int64_t min_x, int64_t max_x,
+                             int64_t min_y, int64_t max_y) {
+    std::vector<Cell> cells(live_cells.begin(), live_cells.end());
+    KeySpace space;
+    if (space.init(min_y, max_y, min_x, max_x)) {
+        std::vector<uint64_t> keys(cells.size());
+        std::vector<uint64_t> scratch;
+        std::vector<size_t> counts;
+        for (size_t i = 0; i < cells.size(); i++) {
+            keys[i] = space.encode(cells[i].y, cells[i].x);
+        }
+        radix_sort(keys, scratch, counts, space.bits, 1);
+        for (size_t i = 0; i < cells.size(); i++) {
+            Cell swapped = space.decode(keys[i]);
+            cells[i] = {swapped.y, swapped.x};
+        }
+    } else {
+        std::sort(cells.begin(), cells.end(), [](const Cell& a, const Cell& b) {
+            return a.y < b.y || (a.y == b.y && a.x < b.x);
+        });
+    }
+    return cells;
+}
+
+} // anonymous namespace
+
+// --- RLE ---
+
+GameOfLife GameOfLife::parse_rle(std::istream& input) {
+    return parse_rle(input, EngineType::Hashtable);
+}
+
+GameOfLife GameOfLife::parse_rle(std::istream& input, EngineType engine) {
+    CellSet cells;
+    int64_t ox = 0, oy = 0;  // top-left corner
+    int64_t x = 0, y = 0;    // position relative to the corner
+    Rule rule;
+    bool header_found = false;
+    bool done = false;
+    std::string line;
+
+    while (!done && std::getline(input, line)) {
+        std::string_view text = trim(line);
+        if (text.empty()) continue;
+
+        if (!header_found) {
+            if (text[0] == '#') {
+                if (text.rfind("#CXRLE", 0) == 0) parse_cxrle(text, ox, oy);
+                continue;
+            }
+            parse_rle_header(text, rule);
+            header_found = true;
+            continue;
+        }
+
+        // <count><tag> items: b/. dead, o alive, $ end of row, ! end of pattern
+        int64_t count = -1;
+        for (char c : text) {
+            if (c >= '0' && c <= '9') {
+                int64_t digit = c - '0';
+                if (count < 0) count = 0;
+                if (__builtin_mul_overflow(count, 10, &count) ||
+                    __builtin_add_overflow(count, digit, &count)) {
+                    rle_error("run count too large");
+                }
+                continue;
+            }
+            if (c == ' ' || c == '\t') continue;
+
+            int64_t n = count < 0 ? 1 : count;
+            count = -1;
+            if (c == 'b' || c == '.') {
+                if (__builtin_add_overflow(x, n, &x)) rle_error("coordinates out of range");
+            } else if (c == 'o') {
+                for (int64_t i = 0; i < n; i++) {
+                    int64_t cx, cy;
+                    if (__builtin_add_overflow(ox, x, &cx) || __builtin_add_overflow(oy, y, &cy) ||
+                        __builtin_add_overflow(x, 1, &x)) {
+                        rle_error("coordinates out of range");
+                    }
+                    cells.insert({cx, cy});
+                }
+            } else if (c == '$') {
+                if (__builtin_add_overflow(y, n, &y)) rle_error("coordinates out of range");
+                x = 0;
+            } else if (c == '!') {
+                done = true;
+                break;
+            } else {
+                rle_error("unexpected character '" + std::string(1, c) + "' in line '" +
+                          std::string(text) + "'");
+            }
+        }
+    }
+
+    if (!header_found) {
+        rle_error("missing or invalid header (expected 'x = ..., y = ...')");
+    }
+    GameOfLife game(std::move(cells), engine);
+    if (rule != Rule{}) game.set_rule(rule);
+    return game;
+}
+
+void GameOfLife::write_rle(std::ostream& out) const {
+    const CellSet& live_cells = cells();
+    if (live_cells.empty()) {
+        out << "x = 0, y = 0, rule = " << rule_string(rule()) << "\n!\n";
+        return;
+    }
+
+    int64_t min_x = live_cells.begin()->x, max_x = min_x;
+    int64_t min_y = live_cells.begin()->y, max_y = min_y;
+    for (const auto& cell : live_cells) {
+        min_x = std::min(min_x, cell.x);
+        max_x = std::max(max_x, cell.x);
+        min_y = std::min(min_y, cell.y);
+        max_y = std::max(max_y, cell.y);
+    }
+    std::vector<Cell> sorted = rows_order(live_cells, min_x, max_x, min_y, max_y);
+
+    out << "#CXRLE Pos=" << min_x << ',' << min_y << '\n';
+    out << "x = " << static_cast<uint64_t>(max_x) - static_cast<uint64_t>(min_x) + 1
+        << ", y = " << static_cast<uint64_t>(max_y) - static_cast<uint64_t>(min_y) + 1
+        << ", rule = " << rule_string(rule()) << '\n';
+
+    // Items are never split across lines; lines stay within 70 characters
+    constexpr size_t kMaxLine = 70;
+    constexpr size_t kFlushBytes = size_t(1) << 16;
+    std::string text;
+    size_t line_length = 0;
+    auto emit = [&](uint64_t n, char tag) {
+        std::string item = n > 1 ? std::to_string(n) : std::string();
+        item += tag;
+        if (line_length + item.size() > kMaxLine) {
+            text += '\n';
+            line_length = 0;
+        }
+        text += item;
+        line_length += item.size();
+        if (text.size() >= kFlushBytes) {
+            out.write(text.data(), static_cast<std::streamsize>(text.size()));
+            text.clear();
+        }
+    };
+
+    uint64_t row = static_cast<uint64_t>(min_y);
+    uint64_t next_x = static_cast<uint64_t>(min_x);
+    uint64_t run = 0;
+    for (const auto& cell : sorted) {
+        uint64_t cx = static_cast<uint64_t>(cell.x);
+        uint64_t cy = static_cast<uint64_t>(cell.y);
+        if (cy != row) {
+            if (run > 0) emit(run, 'o');
+            run = 0;
+            emit(cy - row, '$');
+            row = cy;
+            next_x = static_cast<uint64_t>(min_x);
+        }
+        if (cx != next_x) {
+            if (run > 0) emit(run, 'o');
+            run = 0;
+            emit(cx - next_x, 'b');
+        }
+        ++run;
+        next_x = cx + 1;
+    }
+    emit(run, 'o');
+    emit(1, '!');
+    text += '\n';
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+// --- Macrocell ---
+
+GameOfLife GameOfLife::parse_macrocell(std::istream& input) {
+    return parse_macrocell(input, EngineType::Hashlife);
+}
+
+GameOfLife GameOfLife::parse_macrocell(std::istream& input, EngineType engine) {
+    bool tree = engine == EngineType::Hashlife || engine == EngineType::HashlifeFast ||
+                engine == EngineType::Auto;
+    GameOfLife game(CellSet{}, tree ? engine : EngineType::Hashlife);
+    game.engine_->read_macrocell(input);
+    game.cells_stale_ = game.engine_->retains_state();
+    if (tree) return game;
+
+    game.sync_cells();
+    GameOfLife expanded(std::move(game.live_cells_), engine);
+    if (game.rule() != Rule{}) expanded.set_rule(game.rule());
+    return expanded;
+}
+
+void GameOfLife::write_macrocell(std::ostream& out) const {
+    // When the engine retains its own state it ignores live_cells_; while a
+    // tick is pending that state is already the next generation
+    if (!tick_pending() && engine_->write_macrocell(out, live_cells_)) return;
+    auto tree = create_engine(EngineType::Hashlife);
+    tree->set_rule(rule());
+    tree->write_macrocell(out, cells());
+}
@@ -1,13 +1,110 @@
 #include "game_of_life.h"
 #include "engine.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include "radix_sort.h"
 
 #include <algorithm>
+#include <cctype>
+#include <cerrno>
 #include <charconv>
+#include <chrono>
+#include <climits>
 #include <cstring>
+#include <fstream>
+#include <limits>
 #include <sstream>
 #include <stdexcept>
 #include <utility>
 #include <vector>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// --- Spatial index (see cells_in_rect()) ---
+//
+// Defined ahead of the constructors, which need CellIndex complete to
+// destroy and move the unique_ptr holding it.
+
+namespace {
+
+constexpr int kIndexChunkBits = 6;
+
+inline Cell chunk_of(const Cell& cell) noexcept {
+    return {cell.x >> kIndexChunkBits, cell.y >> kIndexChunkBits};
+}
+
+#if USE_FAST_HASH
+using ChunkMap = ankerl::unordered_dense::map<Cell, size_t, CellHash>;
+#else
+using ChunkMap = std::unordered_map<Cell, size_t, CellHash>;
+#endif
+
+} // anonymous namespace
+
+// Live cells bucketed by 64x64 chunk: chunk i (keys[i]) holds
+// cells[begin[i], begin[i + 1]).
+struct GameOfLife::CellIndex {
+    ChunkMap chunks;  // chunk -> i
+    std::vector<Cell> keys;
+    std::vector<size_t> begin;
+    std::vector<Cell> cells;
+
+    explicit CellIndex(const CellSet& live) {
+        // Count the cells per chunk, turn the counts into offsets, then place
+        // each cell in its chunk's next free slot
+        for (const auto& cell : live) {
+            auto [it, inserted] = chunks.try_emplace(chunk_of(cell), keys.size());
+            if (inserted) {
+                keys.push_back(chunk_of(cell));
+                begin.push_back(0);
+            }
+            ++begin[it->second];
+        }
+        size_t offset = 0;
+        for (auto& b : begin) {
+            size_t count = b;
+            b = offset;
+            offset += count;
+        }
+        begin.push_back(offset);
+
+        std::vector<size_t> fill(begin.begin(), begin.end() - 1);
+        cells.resize(offset);
+        for (const auto& cell : live) {
+            cells[fill[chunks.find(chunk_of(cell))->second]++] = cell;
+        }
+    }
+
+    void query(const BoundingBox& rect, std::vector<Cell>& out) const {
+        const Cell low = chunk_of({rect.min_x, rect.min_y});
+        const Cell high = chunk_of({rect.max_x, rect.max_y});
+        auto scan = [&](size_t i) {
+            for (size_t c = begin[i]; c < begin[i + 1]; c++) {
+                if (rect.contains(cells[c])) out.push_back(cells[c]);
+            }
+        };
+
+        // Look up each chunk under the rect, or filter every chunk when
+        // there are fewer of those
+        uint64_t span_x = static_cast<uint64_t>(high.x) - static_cast<uint64_t>(low.x) + 1;
+        uint64_t span_y = static_cast<uint64_t>(high.y) - static_cast<uint64_t>(low.y) + 1;
+        if (span_x <= keys.size() / span_y) {
+            for (int64_t cy = low.y; cy <= high.y; cy++) {
+                for (int64_t cx = low.x; cx <= high.x; cx++) {
+                    auto it = chunks.find({cx, cy});
+                    if (it != chunks.end()) scan(it->second);
+                }
+            }
+            return;
+        }
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i].x >= low.x && keys[i].x <= high.x && keys[i].y >= low.y &&
+                keys[i].y <= high.y) {
+                scan(i);
+            }
+        }
+    }
+};
 
 // --- Constructors ---
 
@@ -26,105 +123,247 @@ GameOfLife::GameOfLife(const CellSet& cells, EngineType engine)
 GameOfLife::GameOfLife(CellSet&& cells, EngineType engine)
     : live_cells_(std::move(cells)), engine_(create_engine(engine)) {}
 
-GameOfLife::~GameOfLife() = default;
+GameOfLife::~GameOfLife() {
+    cancel_tick();
+}
 
 // --- Copy ---
 
+// The copy reads as the generation `other` does, so with a tick pending the
+// engine's change log (by then only that tick's changes) is left behind
 GameOfLife::GameOfLife(const GameOfLife& other)
-    : live_cells_(other.live_cells_),
-      engine_(other.engine_ ? other.engine_->clone() : create_engine(EngineType::Hashtable)) {}
+    : live_cells_(other.cells()),
+      threads_(other.threads_),
+      detect_cycles_(other.detect_cycles_),
+      cycle_(other.cycle_),
+      metrics_(other.metrics_),
+      memory_limit_(other.memory_limit_),
+      track_changes_(other.track_changes_),
+      engine_tracks_(other.engine_tracks_),
+      changes_(other.changes_),
+      baseline_(other.baseline_) {
+    // The pending tick writes to the engine's log
+    if (other.track_changes_ && other.pending_.valid()) other.pending_.wait();
+    engine_ = other.engine_ ? other.engine_->clone() : create_engine(EngineType::Hashtable);
+    if (other.pending_.valid()) drop_engine_changes();
+}
 
 GameOfLife& GameOfLife::operator=(const GameOfLife& other) {
     if (this != &other) {
-        live_cells_ = other.live_cells_;
-        engine_ = other.engine_ ? other.engine_->clone() : create_engine(EngineType::Hashtable);
+        *this = GameOfLife(other);
     }
     return *this;
 }
 
 // --- Move ---
 
+// A pending tick of `other` is dropped: the moved-to game holds the
+// generation `other` read as.
 GameOfLife::GameOfLife(GameOfLife&& other) noexcept
-    : live_cells_(std::move(other.live_cells_)),
-      engine_(std::move(other.engine_)) {}
+    : live_cells_((other.cancel_tick(), std::move(other.live_cells_))),
+      cells_stale_(std::exchange(other.cells_stale_, false)),
+      engine_(std::move(other.engine_)),
+      threads_(other.threads_),
+      detect_cycles_(other.detect_cycles_),
+      cycle_(std::move(other.cycle_)),
+      metrics_(other.metrics_),
+      step_ns_(std::exchange(other.step_ns_, 0)),
+      memory_limit_(other.memory_limit_),
+      track_changes_(other.track_changes_),
+      engine_tracks_(other.engine_tracks_),
+      changes_(std::move(other.changes_)),
+      baseline_(std::move(other.baseline_)) {}
 
 GameOfLife& GameOfLife::operator=(GameOfLife&& other) noexcept {
     if (this != &other) {
+        cancel_tick();
+        other.cancel_tick();
         live_cells_ = std::move(other.live_cells_);
+        cells_stale_ = std::exchange(other.cells_stale_, false);
         engine_ = std::move(other.engine_);
+        threads_ = other.threads_;
+        detect_cycles_ = other.detect_cycles_;
+        cycle_ = std::move(other.cycle_);
+        metrics_ = other.metrics_;
+        step_ns_ = std::exchange(other.step_ns_, 0);
+        memory_limit_ = other.memory_limit_;
+        track_changes_ = other.track_changes_;
+        engine_tracks_ = other.engine_tracks_;
+        changes_ = std::move(other.changes_);
+        baseline_ = std::move(other.baseline_);
+        reset_queries();
     }
     return *this;
 }
 
 // --- Parsing ---
 
+namespace {
+
+constexpr std::string_view kLifeHeader = "#Life 1.06";
+
+// Files at least this large per extra thread are split for parallel parsing
+constexpr size_t kMinParseChunk = size_t(1) << 20;
+
+// Strip trailing whitespace; a blank line comes back empty
+std::string_view trim_line(std::string_view line) noexcept {
+    size_t end = line.find_last_not_of(" \t\r\n");
+    return end == std::string_view::npos ? std::string_view{} : line.substr(0, end + 1);
+}
+
+// Parse a trimmed, non-empty "x y" coordinate line with std::from_chars
+// (no heap allocation on success)
+Cell parse_coordinate_line(std::string_view line) {
+    const char* ptr = line.data();
+    const char* const line_end = ptr + line.size();
+
+    // Skip leading whitespace
+    while (ptr < line_end && (*ptr == ' ' || *ptr == '\t')) ++ptr;
+
+    int64_t x, y;
+    auto [p1, ec1] = std::from_chars(ptr, line_end, x);
+    if (ec1 != std::errc{}) {
+        throw std::runtime_error(
+            "Invalid Life 1.06 file: malformed coordinate line '" + std::string(line) + "'");
+    }
+
+    // Skip whitespace between x and y
+    ptr = p1;
+    while (ptr < line_end && (*ptr == ' ' || *ptr == '\t')) ++ptr;
+    if (ptr == p1) {
+        // No whitespace separator found
+        throw std::runtime_error(
+            "Invalid Life 1.06 file: malformed coordinate line '" + std::string(line) + "'");
+    }
+
+    auto [p2, ec2] = std::from_chars(ptr, line_end, y);
+    if (ec2 != std::errc{}) {
+        throw std::runtime_error(
+            "Invalid Life 1.06 file: malformed coordinate line '" + std::string(line) + "'");
+    }
+
+    // Check for trailing garbage (skip whitespace, then must be at end)
+    ptr = p2;
+    while (ptr < line_end && (*ptr == ' ' || *ptr == '\t')) ++ptr;
+    if (ptr != line_end) {
+        throw std::runtime_error(
+            "Invalid Life 1.06 file: unexpected content after coordinates '" + std::string(line) + "'");
+    }
+
+    return {x, y};
+}
+
+void check_header(std::string_view line) {
+    if (line != kLifeHeader) {
+        throw std::runtime_error(
+            "Invalid Life 1.06 file: missing or invalid header (expected '#Life 1.06')");
+    }
+}
+
+[[noreturn]] void throw_missing_header() {
+    throw std::runtime_error("Invalid Life 1.06 file: empty or missing header");
+}
+
+// Parse the coordinate lines in `text` (which must start at a line start)
+void parse_lines(std::string_view text, std::vector<Cell>& out) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t nl = text.find('\n', pos);
+        if (nl == std::string_view::npos) nl = text.size();
+        std::string_view line = trim_line(text.substr(pos, nl - pos));
+        pos = nl + 1;
+        if (!line.empty()) {
+            out.push_back(parse_coordinate_line(line));
+        }
+    }
+}
+
+} // anonymous namespace
+
 CellSet GameOfLife::parse_cells(std::istream& input) {
     CellSet cells;
     std::string line;
     bool header_found = false;
 
     while (std::getline(input, line)) {
-        // Trim trailing whitespace in-place
-        size_t end = line.find_last_not_of(" \t\r\n");
-        if (end == std::string::npos) {
+        std::string_view trimmed = trim_line(line);
+        if (trimmed.empty()) {
             continue; // Empty line
         }
-        line.resize(end + 1);
 
         // First non-empty line must be the header
         if (!header_found) {
-            if (line != "#Life 1.06") {
-                throw std::runtime_error(
-                    "Invalid Life 1.06 file: missing or invalid header (expected '#Life 1.06')");
-            }
+            check_header(trimmed);
             header_found = true;
             continue;
         }
 
-        // Parse "x y" coordinate pair with std::from_chars (no heap allocation)
-        const char* ptr = line.data();
-        const char* const line_end = ptr + line.size();
-
-        // Skip leading whitespace
-        while (ptr < line_end && (*ptr == ' ' || *ptr == '\t')) ++ptr;
-
-        int64_t x, y;
-        auto [p1, ec1] = std::from_chars(ptr, line_end, x);
-        if (ec1 != std::errc{}) {
-            throw std::runtime_error(
-                "Invalid Life 1.06 file: malformed coordinate line '" + line + "'");
-        }
+        cells.insert(parse_coordinate_line(trimmed));
+    }
 
-        // Skip whitespace between x and y
-        ptr = p1;
-        while (ptr < line_end && (*ptr == ' ' || *ptr == '\t')) ++ptr;
-        if (ptr == p1) {
-            // No whitespace separator found
-            throw std::runtime_error(
-                "Invalid Life 1.06 file: malformed coordinate line '" + line + "'");
-        }
+    if (!header_found) {
+        throw_missing_header();
+    }
 
-        auto [p2, ec2] = std::from_chars(ptr, line_end, y);
-        if (ec2 != std::errc{}) {
-            throw std::runtime_error(
-                "Invalid Life 1.06 file: malformed coordinate line '" + line + "'");
-        }
+    return cells;
+}
 
-        // Check for trailing garbage (skip whitespace, then must be at end)
-        ptr = p2;
-        while (ptr < line_end && (*ptr == ' ' || *ptr == '\t')) ++ptr;
-        if (ptr != line_end) {
-            throw std::runtime_error(
-                "Invalid Life 1.06 file: unexpected content after coordinates '" + line + "'");
+// The header is checked serially; the rest of the mapping is cut into
+// newline-aligned chunks, each parsed into its own vector. The first error of
+// the earliest failing chunk is rethrown, which is the error a serial parse
+// would report. The vectors are then bulk-inserted into a pre-reserved set.
+CellSet GameOfLife::parse_file_cells(const std::string& path, unsigned threads) {
+    MappedFile file(path);
+    if (!file.regular()) {
+        std::ifstream stream(path);
+        if (!stream) {
+            throw std::runtime_error("Cannot open file '" + path + "'");
         }
-
-        cells.insert({x, y});
+        return parse_cells(stream);
     }
 
+    std::string_view text = file.text();
+    size_t pos = 0;
+    bool header_found = false;
+    while (pos < text.size() && !header_found) {
+        size_t nl = text.find('\n', pos);
+        if (nl == std::string_view::npos) nl = text.size();
+        std::string_view line = trim_line(text.substr(pos, nl - pos));
+        pos = std::min(nl + 1, text.size());
+        if (line.empty()) continue;
+        check_header(line);
+        header_found = true;
+    }
     if (!header_found) {
-        throw std::runtime_error("Invalid Life 1.06 file: empty or missing header");
+        throw_missing_header();
     }
 
+    std::string_view body = text.substr(pos);
+    size_t chunks = std::clamp<size_t>(body.size() / kMinParseChunk, 1, std::max(threads, 1u));
+    std::vector<size_t> bounds(chunks + 1, body.size());
+    bounds[0] = 0;
+    for (size_t c = 1; c < chunks; c++) {
+        size_t nl = body.find('\n', std::max(body.size() * c / chunks, bounds[c - 1]));
+        bounds[c] = nl == std::string_view::npos ? body.size() : nl + 1;
+    }
+
+    std::vector<std::vector<Cell>> parts(chunks);
+    parallel_for(static_cast<unsigned>(chunks), [&](unsigned c) {
+        std::string_view chunk = body.substr(bounds[c], bounds[c + 1] - bounds[c]);
+        // Typical lines are a dozen bytes or more
+        parts[c].reserve(chunk.size() / 12);
+        parse_lines(chunk, parts[c]);
+    });
+
+    size_t total = 0;
+    for (const auto& part : parts) {
+        total += part.size();
+    }
+    CellSet cells;
+    cells.reserve(total);
+    for (const auto& part : parts) {
+        cells.insert(part.begin(), part.end());
+    }
     return cells;
 }
 
@@ -148,83 +387,721 @@ GameOfLife GameOfLife::parse(std::istream& input, EngineType engine) {
     return GameOfLife(std::move(cells), engine);
 }
 
+GameOfLife GameOfLife::parse_file(const std::string& path) {
+    return parse_file(path, EngineType::Hashtable);
+}
+
+GameOfLife GameOfLife::parse_file(const std::string& path, EngineType engine, unsigned threads) {
+    CellSet cells = parse_file_cells(path, threads);
+    return GameOfLife(std::move(cells), engine);
+}
+
+// --- Rules ---
+
+namespace {
+
+[[noreturn]] void rule_error(std::string_view text) {
+    throw std::invalid_argument("Invalid rule '" + std::string(text) + "'");
+}
+
+// Set the bit for each neighbor count in `digits` (0-8, each at most once)
+void parse_counts(std::string_view digits, std::string_view text, uint16_t& mask) {
+    for (char c : digits) {
+        if (c < '0' || c > '8') rule_error(text);
+        uint16_t bit = static_cast<uint16_t>(1u << (c - '0'));
+        if (mask & bit) rule_error(text);
+        mask |= bit;
+    }
+}
+
+}  // namespace
+
+Rule parse_rule(std::string_view text) {
+    Rule rule{0, 0};
+    if (text.empty()) rule_error(text);
+
+    char first = static_cast<char>(std::tolower(static_cast<unsigned char>(text[0])));
+    if (first == 'b' || first == 's') {
+        // "B3/S23", "S23/B3", "b3s23": each part once, '/' between them optional
+        bool seen_birth = false, seen_survive = false;
+        size_t i = 0;
+        while (i < text.size()) {
+            char tag = static_cast<char>(std::tolower(static_cast<unsigned char>(text[i])));
+            if (tag != 'b' && tag != 's') rule_error(text);
+            bool& seen = tag == 'b' ? seen_birth : seen_survive;
+            if (seen) rule_error(text);
+            seen = true;
+            size_t end = std::min(text.find_first_not_of("012345678", i + 1), text.size());
+            parse_counts(text.substr(i + 1, end - i - 1), text,
+                         tag == 'b' ? rule.birth : rule.survive);
+            i = end;
+            if (i < text.size() && text[i] == '/' && ++i == text.size()) rule_error(text);
+        }
+        if (!seen_birth || !seen_survive) rule_error(text);
+    } else {
+        // "23/3": survival counts, then birth counts
+        size_t slash = text.find('/');
+        if (slash == std::string_view::npos) rule_error(text);
+        parse_counts(text.substr(0, slash), text, rule.survive);
+        parse_counts(text.substr(slash + 1), text, rule.birth);
+    }
+
+    if (rule.birth & 1u) {
+        throw std::invalid_argument("Unsupported rule '" + std::string(text) +
+                                    "': B0 rules are not supported");
+    }
+    return rule;
+}
+
+std::string rule_string(const Rule& rule) {
+    std::string text = "B";
+    for (unsigned n = 0; n <= 8; n++) {
+        if ((rule.birth >> n) & 1u) text += static_cast<char>('0' + n);
+    }
+    text += "/S";
+    for (unsigned n = 0; n <= 8; n++) {
+        if ((rule.survive >> n) & 1u) text += static_cast<char>('0' + n);
+    }
+    return text;
+}
+
 // --- Simulation ---
 
+// Run `step`, adding its wall time to step_ns_ while metrics are on
+template <typename Fn>
+void GameOfLife::timed_step(Fn&& step) {
+    if (!metrics_) {
+        step();
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    step();
+    step_ns_ += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now() - start)
+                                          .count());
+}
+
 void GameOfLife::tick() {
-    engine_->tick(live_cells_);
+    finish_tick();
+    reset_queries();
+    timed_step([&] { engine_->tick(live_cells_); });
+    cells_stale_ = engine_->retains_state();
 }
 
-void GameOfLife::run(int iterations) {
+void GameOfLife::run(int64_t iterations) {
     if (iterations < 0) {
         throw std::invalid_argument("Iterations must be non-negative");
     }
-    for (int i = 0; i < iterations; i++) {
-        tick();
+    finish_tick();
+    if (iterations == 0) return;
+    reset_queries();
+    uint64_t remaining = static_cast<uint64_t>(iterations);
+    if (detect_cycles_) {
+        remaining = run_detecting_cycles(remaining);
     }
+    if (remaining == 0) return;
+    timed_step([&] { engine_->advance(live_cells_, remaining); });
+    cells_stale_ = engine_->retains_state();
 }
 
-// --- Output ---
+void GameOfLife::set_threads(unsigned threads) {
+    if (threads == 0) {
+        throw std::invalid_argument("Thread count must be positive");
+    }
+    finish_tick();
+    threads_ = threads;
+    engine_->set_threads(threads);
+}
 
-void GameOfLife::write(std::ostream& out, bool sorted) const {
-    // Use std::to_chars into a buffer for fast integer formatting,
-    // then flush with a single write() call per cell.
-    // This avoids iostream's locale handling and virtual dispatch overhead.
-    constexpr size_t kBufSize = 8192;
-    char buf[kBufSize];
-    char* pos = buf;
-    char* const end = buf + kBufSize;
-
-    // Reserve space for the longest possible line: two int64_t + space + newline
-    // max int64_t is 20 digits, so worst case is 20 + 1 + 20 + 1 = 42 bytes
-    constexpr size_t kMaxLineLen = 44;
-
-    auto flush = [&]() {
-        out.write(buf, pos - buf);
-        pos = buf;
-    };
+void GameOfLife::set_memory_limit(size_t bytes) {
+    if (bytes == 0) {
+        throw std::invalid_argument("Memory limit must be positive");
+    }
+    finish_tick();
+    memory_limit_ = bytes;
+    engine_->set_memory_limit(bytes);
+}
 
-    auto write_cell = [&](const Cell& cell) {
-        if (static_cast<size_t>(end - pos) < kMaxLineLen) {
-            flush();
+void GameOfLife::set_rule(const Rule& rule) {
+    finish_tick();
+    // The engine drops any retained generation, so take the cells first
+    if (cells_stale_) sync_cells();
+    engine_->set_rule(rule);
+    cells_stale_ = false;
+    cycle_.reset();
+    reset_queries();
+}
+
+Rule GameOfLife::rule() const noexcept {
+    return engine_->rule();
+}
+
+std::vector<EngineCounter> GameOfLife::engine_counters() const {
+    if (pending_.valid()) pending_.wait();
+    return engine_->counters();
+}
+
+void GameOfLife::set_metrics(bool enabled) {
+    finish_tick();
+    metrics_ = enabled;
+    step_ns_ = 0;
+    engine_->set_metrics(enabled);
+}
+
+void GameOfLife::set_track_changes(bool enabled) {
+    finish_tick();
+    track_changes_ = enabled;
+    changes_.clear();
+    engine_tracks_ = engine_->set_track_changes(enabled);
+    baseline_ = enabled && !engine_tracks_ ? cells() : CellSet{};
+}
+
+CellDelta GameOfLife::take_changes() {
+    CellDelta delta;
+    if (!track_changes_) return delta;
+    if (!engine_tracks_) {
+        const CellSet& current = cells();
+        for (const auto& cell : current) {
+            if (!baseline_.count(cell)) delta.born.push_back(cell);
+        }
+        for (const auto& cell : baseline_) {
+            if (!current.count(cell)) delta.died.push_back(cell);
         }
-        auto [p1, ec1] = std::to_chars(pos, end, cell.x);
-        *p1++ = ' ';
-        auto [p2, ec2] = std::to_chars(p1, end, cell.y);
-        *p2++ = '\n';
-        pos = p2;
+        baseline_ = current;
+    } else {
+        // tick_async() took the engine's changes up to the current generation
+        if (!pending_.valid()) engine_->take_changes(changes_);
+        changes_.take(delta);
+    }
+    sort_cells(delta.born, threads_);
+    sort_cells(delta.died, threads_);
+    return delta;
+}
+
+std::vector<EngineCounter> GameOfLife::take_metrics() {
+    if (!metrics_) return {};
+    if (pending_.valid()) pending_.wait();
+    std::vector<EngineCounter> metrics = {{"step_ns", step_ns_}};
+    step_ns_ = 0;
+    for (auto& metric : engine_->take_metrics()) {
+        metrics.push_back(std::move(metric));
+    }
+    return metrics;
+}
+
+void GameOfLife::count_blocks(const BlockGrid& grid, std::vector<uint64_t>& counts) const {
+    counts.assign(static_cast<size_t>(grid.width) * static_cast<size_t>(grid.height), 0);
+    if (engine_current() && engine_->count_blocks(grid, counts)) return;
+    size_t index;
+    for (const auto& cell : cells()) {
+        if (grid.locate(cell.x, cell.y, index)) ++counts[index];
+    }
+}
+
+// --- Batch simulation ---
+
+void GameOfLife::advance_on(std::unique_ptr<SimulationEngine>& engine, uint64_t generations) {
+    finish_tick();
+    if (generations == 0) return;
+    if (metrics_) {
+        // The counters live in the engine, so step on our own
+        while (generations > 0) {
+            uint64_t step = std::min<uint64_t>(generations, std::numeric_limits<int64_t>::max());
+            run(static_cast<int64_t>(step));
+            generations -= step;
+        }
+        return;
+    }
+    if (cells_stale_) sync_cells();
+    // set_rule() also drops whatever the previous pattern left in the engine
+    engine->set_rule(engine_->rule());
+    engine->set_threads(1);
+
+    // Also drops any changes the engine noted for an earlier game
+    engine->set_track_changes(track_changes_ && engine_tracks_);
+
+    std::swap(engine_, engine);
+    try {
+        reset_queries();
+        uint64_t remaining = detect_cycles_ ? run_detecting_cycles(generations) : generations;
+        if (remaining > 0) {
+            engine_->advance(live_cells_, remaining);
+            cells_stale_ = engine_->retains_state();
+        }
+        if (cells_stale_) sync_cells();
+        if (track_changes_ && engine_tracks_) engine_->take_changes(changes_);
+    } catch (...) {
+        std::swap(engine_, engine);
+        engine_->set_rule(engine_->rule());
+        cells_stale_ = false;
+        throw;
+    }
+    // Our engine may still hold the generation the batch started from
+    std::swap(engine_, engine);
+    engine_->set_rule(engine_->rule());
+}
+
+void simulate_batch(std::vector<GameOfLife>& games, uint64_t generations) {
+    simulate_batch(games, generations, hardware_threads());
+}
+
+void simulate_batch(std::vector<GameOfLife>& games, uint64_t generations, unsigned threads) {
+    if (threads == 0) {
+        throw std::invalid_argument("Thread count must be positive");
+    }
+    // Per worker: (memory limit, engine) pairs, one per engine type and limit
+    std::vector<std::vector<std::pair<size_t, std::unique_ptr<SimulationEngine>>>> engines(threads);
+    parallel_for_stealing(games.size(), threads, [&](size_t i, unsigned worker) {
+        GameOfLife& game = games[i];
+        std::unique_ptr<SimulationEngine>* engine = nullptr;
+        for (auto& [limit, cached] : engines[worker]) {
+            if (cached->type() == game.engine_->type() && limit == game.memory_limit_) {
+                engine = &cached;
+            }
+        }
+        if (!engine) {
+            engines[worker].emplace_back(game.memory_limit_, game.engine_->clone());
+            engine = &engines[worker].back().second;
+        }
+        game.advance_on(*engine, generations);
+    });
+}
+
+// --- Spatial queries ---
+
+namespace {
+
+BoundingBox bounds_of(const CellSet& cells) {
+    BoundingBox b;
+    if (cells.empty()) return b;
+    b.min_x = b.max_x = cells.begin()->x;
+    b.min_y = b.max_y = cells.begin()->y;
+    for (const auto& cell : cells) {
+        b.min_x = std::min(b.min_x, cell.x);
+        b.max_x = std::max(b.max_x, cell.x);
+        b.min_y = std::min(b.min_y, cell.y);
+        b.max_y = std::max(b.max_y, cell.y);
+    }
+    return b;
+}
+
+} // anonymous namespace
+
+std::optional<BoundingBox> GameOfLife::bounding_box() const {
+    if (!box_cached_) {
+        if (!engine_current() || !engine_->bounding_box(box_)) {
+            const CellSet& live = cells();
+            box_ = live.empty() ? std::nullopt : std::optional<BoundingBox>(bounds_of(live));
+        }
+        box_cached_ = true;
+    }
+    return box_;
+}
+
+void GameOfLife::cells_in_rect(const BoundingBox& rect, std::vector<Cell>& out) const {
+    if (rect.min_x > rect.max_x || rect.min_y > rect.max_y) return;
+    if (engine_current() && engine_->cells_in_rect(rect, out)) return;
+
+    // A single query is cheapest as a plain scan; the index only pays off
+    // once the same generation is queried again
+    if (!index_ && ++rect_queries_ >= 2) {
+        index_ = std::make_unique<CellIndex>(cells());
+    }
+    if (index_) {
+        index_->query(rect, out);
+        return;
+    }
+    for (const auto& cell : cells()) {
+        if (rect.contains(cell)) out.push_back(cell);
+    }
+}
+
+// Called before anything that changes the generation
+void GameOfLife::reset_queries() noexcept {
+    box_cached_ = false;
+    box_.reset();
+    rect_queries_ = 0;
+    index_.reset();
+}
+
+// --- Cycle detection ---
+
+namespace {
+
+// Translation-normalized summary of a generation. `hash` is order-independent
+// (a sum of per-cell hashes of coordinates relative to the bounding box
+// corner), so equal hashes suggest the pattern recurred, possibly shifted by
+// the difference in (min_x, min_y).
+struct Signature {
+    uint64_t hash = 0;
+    int64_t min_x = 0;
+    int64_t min_y = 0;
+};
+
+// Cell relative to the bounding box corner; unsigned so any extent fits
+using Offset = std::pair<uint64_t, uint64_t>;
+
+Signature signature_of(const CellSet& cells) {
+    BoundingBox b = bounds_of(cells);
+    CellHash hasher;
+    uint64_t sum = 0;
+    for (const auto& cell : cells) {
+        uint64_t dx = static_cast<uint64_t>(cell.x) - static_cast<uint64_t>(b.min_x);
+        uint64_t dy = static_cast<uint64_t>(cell.y) - static_cast<uint64_t>(b.min_y);
+        sum += hasher({static_cast<int64_t>(dx), static_cast<int64_t>(dy)});
+    }
+    uint64_t width = static_cast<uint64_t>(b.max_x) - static_cast<uint64_t>(b.min_x);
+    uint64_t height = static_cast<uint64_t>(b.max_y) - static_cast<uint64_t>(b.min_y);
+    Signature sig;
+    sig.hash = sum ^ hasher({static_cast<int64_t>(width), static_cast<int64_t>(height)}) ^
+               (cells.size() * CellHash::kHashMultiplier);
+    sig.min_x = b.min_x;
+    sig.min_y = b.min_y;
+    return sig;
+}
+
+std::vector<Offset> normalized(const CellSet& cells, const Signature& sig) {
+    std::vector<Offset> offsets;
+    offsets.reserve(cells.size());
+    for (const auto& cell : cells) {
+        offsets.push_back({static_cast<uint64_t>(cell.x) - static_cast<uint64_t>(sig.min_x),
+                           static_cast<uint64_t>(cell.y) - static_cast<uint64_t>(sig.min_y)});
+    }
+    std::sort(offsets.begin(), offsets.end());
+    return offsets;
+}
+
+// Whether `v` lies strictly inside the int64_t range, clear of the values
+// where would_overflow() changes the rules
+inline bool inside_limits(__int128 v) noexcept {
+    return v > std::numeric_limits<int64_t>::min() && v < std::numeric_limits<int64_t>::max();
+}
+
+#if USE_FAST_HASH
+using SignatureIndex = ankerl::unordered_dense::map<uint64_t, uint64_t>;
+#else
+using SignatureIndex = std::unordered_map<uint64_t, uint64_t>;
+#endif
+
+} // anonymous namespace
+
+// Step one generation at a time, indexing each generation's signature by
+// hash. When a hash recurs p generations later, step p more and compare the
+// two generations cell-for-cell (up to translation); a match proves the
+// pattern is periodic from here on. Returns the generations left for the
+// engine to run normally.
+uint64_t GameOfLife::run_detecting_cycles(uint64_t generations) {
+    if (cycle_) return skip_cycles(generations);
+
+    SignatureIndex seen;                           // hash -> generation
+    std::vector<uint64_t> recent(kCycleWindow);    // hash of generation g at g % window
+    uint64_t generation = 0;
+    auto remember = [&](const Signature& sig) {
+        uint64_t& slot = recent[generation % kCycleWindow];
+        if (generation >= kCycleWindow) {
+            auto old = seen.find(slot);
+            if (old != seen.end() && old->second == generation - kCycleWindow) {
+                seen.erase(old);
+            }
+        }
+        slot = sig.hash;
+        seen[sig.hash] = generation;
     };
 
-    // Write header
-    constexpr char kHeader[] = "#Life 1.06\n";
-    constexpr size_t kHeaderLen = sizeof(kHeader) - 1;
-    std::memcpy(pos, kHeader, kHeaderLen);
-    pos += kHeaderLen;
-
-    if (sorted) {
-        std::vector<Cell> sorted_cells;
-        sorted_cells.reserve(live_cells_.size());
-        sorted_cells.assign(live_cells_.begin(), live_cells_.end());
-        std::sort(sorted_cells.begin(), sorted_cells.end(),
-            [](const Cell& a, const Cell& b) {
-                if (a.x != b.x) return a.x < b.x;
-                return a.y < b.y;
-            });
-        for (const auto& cell : sorted_cells) {
-            write_cell(cell);
+    remember(signature_of(cells()));
+    while (generations > 0) {
+        tick();
+        --generations;
+        ++generation;
+        Signature sig = signature_of(cells());
+
+        auto it = seen.find(sig.hash);
+        uint64_t period = it != seen.end() ? generation - it->second : 0;
+        if (period == 0 || period > generations) {
+            remember(sig);
+            continue;
         }
-    } else {
-        for (const auto& cell : live_cells_) {
-            write_cell(cell);
+
+        // Candidate: verify by running one more period from here
+        std::vector<Offset> before = normalized(cells(), sig);
+        for (uint64_t g = 0; g < period; g++) {
+            tick();
         }
+        generations -= period;
+        generation += period;
+        Signature after_sig = signature_of(cells());
+        __int128 dx = static_cast<__int128>(after_sig.min_x) - sig.min_x;
+        __int128 dy = static_cast<__int128>(after_sig.min_y) - sig.min_y;
+        if (after_sig.hash == sig.hash && inside_limits(dx) && inside_limits(dy) &&
+            normalized(cells(), after_sig) == before) {
+            cycle_ = Cycle{period, static_cast<int64_t>(dx), static_cast<int64_t>(dy)};
+            return skip_cycles(generations);
+        }
+
+        // Hash collision: start over from this generation
+        seen.clear();
+        remember(after_sig);
+    }
+    return 0;
+}
+
+// Jump over the whole periods in `generations` by translating the current
+// generation, then return the remainder. The shift is only applied if every
+// skipped generation stays clear of the int64_t limits (each phase lies
+// within `period` cells of the current bounding box); otherwise all
+// generations are left to the engine.
+uint64_t GameOfLife::skip_cycles(uint64_t generations) {
+    const Cycle& cycle = *cycle_;
+    uint64_t periods = generations / cycle.period;
+    uint64_t rest = generations % cycle.period;
+    if (periods == 0) return generations;
+    if (cycle.dx == 0 && cycle.dy == 0) return rest;
+
+    const CellSet& current = cells();
+    if (current.empty()) return rest;
+    BoundingBox b = bounds_of(current);
+    __int128 margin = static_cast<__int128>(cycle.period) + 1;
+    __int128 shift_x = static_cast<__int128>(cycle.dx) * periods;
+    __int128 shift_y = static_cast<__int128>(cycle.dy) * periods;
+    if (!inside_limits(b.min_x + shift_x - margin) || !inside_limits(b.max_x + shift_x + margin) ||
+        !inside_limits(b.min_y + shift_y - margin) || !inside_limits(b.max_y + shift_y + margin)) {
+        return generations;
+    }
+
+    CellSet shifted;
+    shifted.reserve(current.size());
+    for (const auto& cell : current) {
+        shifted.insert({static_cast<int64_t>(cell.x + shift_x),
+                        static_cast<int64_t>(cell.y + shift_y)});
     }
+    // No engine stepped across the jump, so its changes are found here
+    if (track_changes_ && engine_tracks_) {
+        for (const auto& cell : current) {
+            if (!shifted.count(cell)) changes_.flip(cell, false);
+        }
+        for (const auto& cell : shifted) {
+            if (!current.count(cell)) changes_.flip(cell, true);
+        }
+    }
+    live_cells_ = std::move(shifted);
+    cells_stale_ = false;
+    // A fresh engine with the same settings, so no retained state survives
+    engine_ = engine_->clone();
+    return rest;
+}
 
-    if (pos > buf) {
-        flush();
+// --- Asynchronous ticks ---
+
+std::shared_future<void> GameOfLife::tick_async() {
+    finish_tick();
+    // The worker must not write live_cells_, so bring it up to date first
+    if (cells_stale_) sync_cells();
+    // Changes so far belong to the current generation; the engine's log
+    // then holds only the pending tick's
+    if (track_changes_ && engine_tracks_) engine_->take_changes(changes_);
+    pending_ = std::async(std::launch::async, [this] {
+        timed_step([&] { engine_->tick_into(live_cells_, next_cells_); });
+    }).share();
+    return pending_;
+}
+
+void GameOfLife::finish_tick() {
+    if (!pending_.valid()) return;
+    std::shared_future<void> done = std::move(pending_);
+    try {
+        done.get();
+    } catch (...) {
+        // Drop whatever the engine got to; it restarts from live_cells_
+        engine_->set_rule(engine_->rule());
+        drop_engine_changes();
+        throw;
     }
+    std::swap(live_cells_, next_cells_);
+    cells_stale_ = false;
+    reset_queries();
 }
 
+void GameOfLife::cancel_tick() noexcept {
+    if (!pending_.valid()) return;
+    pending_.wait();
+    pending_ = {};
+    engine_->set_rule(engine_->rule());
+    drop_engine_changes();
+}
+
+// Discard the changes of a tick that never became current
+void GameOfLife::drop_engine_changes() noexcept {
+    if (!track_changes_ || !engine_tracks_) return;
+    ChangeLog dropped;
+    engine_->take_changes(dropped);
+}
+
+// The engine's own index describes live_cells_ unless a tick is pending
+bool GameOfLife::engine_current() const noexcept {
+    return !pending_.valid() && engine_->retains_state();
+}
+
+// --- Retained engine state ---
+
+void GameOfLife::sync_cells() const {
+    engine_->sync(live_cells_);
+    cells_stale_ = false;
+}
+
+size_t GameOfLife::count() const noexcept {
+    return cells_stale_ ? engine_->population() : live_cells_.size();
+}
+
+// --- Output ---
+
+namespace {
+
+constexpr std::string_view kLifeHeaderLine = "#Life 1.06\n";
+
+// Longest possible line: two int64_t + space + newline
+// max int64_t is 20 digits, so worst case is 20 + 1 + 20 + 1 = 42 bytes
+constexpr size_t kMaxLineLen = 42;
+
+// Cells each thread formats per round of the streaming writers; bounds the
+// per-thread buffers to a few MB.
+constexpr size_t kWriteChunkCells = size_t(1) << 16;
+
+inline size_t decimal_length(int64_t value) noexcept {
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    size_t digits = 1;
+    while (magnitude >= 10) {
+        magnitude /= 10;
+        ++digits;
+    }
+    return digits + (value < 0);
+}
+
+inline size_t line_length(const Cell& cell) noexcept {
+    return decimal_length(cell.x) + decimal_length(cell.y) + 2;
+}
+
+// Format cells[begin, end) as "x y\n" lines at `pos`; there must be room for
+// kMaxLineLen bytes per cell. Uses std::to_chars, avoiding iostream's locale
+// handling and virtual dispatch.
+char* format_cells(const Cell* cells, size_t begin, size_t end, char* pos) noexcept {
+    for (size_t i = begin; i < end; i++) {
+        pos = std::to_chars(pos, pos + 20, cells[i].x).ptr;
+        *pos++ = ' ';
+        pos = std::to_chars(pos, pos + 20, cells[i].y).ptr;
+        *pos++ = '\n';
+    }
+    return pos;
+}
+
+// The cells in output order. Unsorted output reads the set's own storage
+// when it has one; otherwise (or when sorting) the cells are copied into
+// `storage`.
+const std::vector<Cell>& output_order(const CellSet& live_cells, bool sorted, unsigned threads,
+                                      std::vector<Cell>& storage) {
+#if USE_FAST_HASH
+    if (!sorted) return live_cells.values();
+#endif
+    storage.assign(live_cells.begin(), live_cells.end());
+    if (sorted) sort_cells(storage, threads);
+    return storage;
+}
+
+// Format `cells` in rounds of up to threads * kWriteChunkCells cells, each
+// thread into its own buffer, and hand each round's buffers (the first round
+// led by the header) to emit(const std::string_view*, count).
+template <typename Emit>
+void write_life(const std::vector<Cell>& cells, unsigned threads, Emit&& emit) {
+    const size_t n = cells.size();
+    threads = static_cast<unsigned>(std::clamp<size_t>(n / kWriteChunkCells, 1, threads));
+    std::vector<std::vector<char>> buffers(threads);
+    std::vector<std::string_view> parts(threads + 1);
+    parts[0] = kLifeHeaderLine;
+    size_t first = 1;  // parts[0] only goes out with the first round
+
+    size_t done = 0;
+    do {
+        size_t round = std::min(n - done, threads * kWriteChunkCells);
+        parallel_for(threads, [&](unsigned t) {
+            size_t begin = done + round * t / threads;
+            size_t end = done + round * (t + 1) / threads;
+            buffers[t].resize((end - begin) * kMaxLineLen);
+            char* out = buffers[t].data();
+            parts[t + 1] = std::string_view(out, format_cells(cells.data(), begin, end, out) - out);
+        });
+        emit(parts.data() + 1 - first, threads + first);
+        first = 0;
+        done += round;
+    } while (done < n);
+}
+
+} // anonymous namespace
+
+void GameOfLife::write(std::ostream& out, bool sorted) const {
+    std::vector<Cell> storage;
+    const std::vector<Cell>& cells = output_order(this->cells(), sorted, threads_, storage);
+    write_life(cells, threads_, [&](const std::string_view* parts, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            out.write(parts[i].data(), static_cast<std::streamsize>(parts[i].size()));
+        }
+    });
+}
+
+void GameOfLife::write_fd(int fd, bool sorted) const {
+    std::vector<Cell> storage;
+    const std::vector<Cell>& cells = output_order(this->cells(), sorted, threads_, storage);
+    std::vector<iovec> iov;
+    write_life(cells, threads_, [&](const std::string_view* parts, size_t count) {
+        // One writev() per round, resumed after partial writes
+        iov.clear();
+        for (size_t i = 0; i < count; i++) {
+            if (parts[i].empty()) continue;
+            iov.push_back({const_cast<char*>(parts[i].data()), parts[i].size()});
+        }
+        size_t next = 0;
+        while (next < iov.size()) {
+            int batch = static_cast<int>(std::min<size_t>(iov.size() - next, IOV_MAX));
+            ssize_t written = ::writev(fd, &iov[next], batch);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("Cannot write output: ") + std::strerror(errno));
+            }
+            size_t left = static_cast<size_t>(written);
+            while (next < iov.size() && left >= iov[next].iov_len) {
+                left -= iov[next++].iov_len;
+            }
+            if (left > 0) {
+                iov[next].iov_base = static_cast<char*>(iov[next].iov_base) + left;
+                iov[next].iov_len -= left;
+            }
+        }
+    });
+}
+
+// The exact length is summed per slice first, so each thread formats its
+// cells straight into their final place in the string.
 std::string GameOfLife::format() const {
-    std::ostringstream out;
-    write(out);
-    return out.str();
+    std::vector<Cell> storage;
+    const std::vector<Cell>& cells = output_order(this->cells(), false, threads_, storage);
+    const size_t n = cells.size();
+    unsigned threads = static_cast<unsigned>(std::clamp<size_t>(n / kWriteChunkCells, 1, threads_));
+
+    std::vector<size_t> offsets(threads + 1, 0);
+    parallel_for(threads, [&](unsigned t) {
+        size_t bytes = 0;
+        for (size_t i = n * t / threads, end = n * (t + 1) / threads; i < end; i++) {
+            bytes += line_length(cells[i]);
+        }
+        offsets[t + 1] = bytes;
+    });
+    offsets[0] = kLifeHeaderLine.size();
+    for (unsigned t = 0; t < threads; t++) {
+        offsets[t + 1] += offsets[t];
+    }
+
+    std::string text(offsets[threads], '\0');
+    std::memcpy(text.data(), kLifeHeaderLine.data(), kLifeHeaderLine.size());
+    parallel_for(threads, [&](unsigned t) {
+        format_cells(cells.data(), n * t / threads, n * (t + 1) / threads, text.data() + offsets[t]);
+    });
+    return text;
 }
@@ -1,5 +1,8 @@
+#include <algorithm>
+#include <charconv>
 #include <iostream>
 #include <fstream>
+#include <iterator>
 #include <string>
 #include <vector>
 #include <cstdlib>
@@ -8,11 +11,18 @@
 #include <chrono>
 #include <filesystem>
 #include <limits>
+#include <optional>
 #include <sys/wait.h>
 #include <unistd.h>
 #include "game_of_life.h"
 #include "engine.h"
 #include "renderer.h"
+#include "snapshot.h"
+#include "video.h"
+#include "distributed.h"
+#include "delta_stream.h"
+#include "parallel.h"
+#include "radix_sort.h"
 
 namespace fs = std::filesystem;
 
@@ -20,12 +30,53 @@ void print_usage(const char* program) {
     std::cerr << "Usage: " << program << " [OPTIONS]\n"
               << "\n"
               << "Options:\n"
-              << "  -f, --file FILE    Read from FILE (.life or .lif extension required)\n"
+              << "  -f, --file FILE    Read from FILE: Life 1.06 (.life, .lif), RLE (.rle) or\n"
+              << "                     Golly macrocell (.mc)\n"
               << "  -n, --iterations N Run N iterations (default: 10)\n"
-              << "  --engine ENGINE    Simulation engine: hashtable (default), sorted, hashlife\n"
+              << "  --engine ENGINE    Simulation engine: hashtable (default), sorted, hashlife,\n"
+              << "                     hashlife-fast (2^k generations per step), tiled,\n"
+              << "                     auto (picks and re-picks as the pattern evolves)\n"
+              << "  --rule RULE        Life-like rule in B/S notation, e.g. B36/S23 (default:\n"
+              << "                     B3/S23, or the rule in an RLE or macrocell file)\n"
+              << "  --threads N        Worker threads (default: 1; parsing, output, hashtable, sorted)\n"
+              << "  --max-memory MB    Memory budget for HashLife's node cache (default: 256)\n"
+              << "  --detect-cycles    Skip ahead once the pattern repeats (possibly shifted)\n"
+              << "  --output-format F  Output format: life (default), rle, mc\n"
+              << "  --batch            Run many patterns: the input is either concatenated Life\n"
+              << "                     1.06 documents or a manifest of pattern files, one per\n"
+              << "                     line. Results are written in input order, on --threads\n"
+              << "                     workers (default: all cores)\n"
               << "  --stats            Print performance stats to stderr\n"
               << "  -h, --help         Show this help message\n"
               << "\n"
+              << "Distributed:\n"
+              << "  --distributed N    Split the plane into N column stripes, each stepped by its\n"
+              << "                     own process on this host (engine: tiled unless\n"
+              << "                     --engine is given)\n"
+              << "  --halo K           Exchange K-wide halos every K generations (default: 1)\n"
+              << "  --save-shards P    Each process saves its stripe as snapshot P.<rank>.snap\n"
+              << "                     (at the end, and every --snapshot-every K generations)\n"
+              << "  --merge-shards OUT SHARD...  Merge snapshot shards into OUT and exit\n"
+              << "\n"
+              << "Delta stream:\n"
+              << "  --emit-every N     Emit the state every N generations (and at the start and\n"
+              << "                     end) as the cells born and died since the last emit\n"
+              << "  --emit-file FILE   Write the stream to FILE (default: stdout, in place of\n"
+              << "                     the final state)\n"
+              << "  --emit-format F    Stream format: text (default) or binary\n"
+              << "  --keyframe-every K A full keyframe every K emits (default: 64; 0: only the\n"
+              << "                     first)\n"
+              << "\n"
+              << "Metrics:\n"
+              << "  --metrics-json FILE  Stream per-tick engine metrics to FILE as JSON Lines\n"
+              << "  --metrics-every N    One line per N generations (default: 1)\n"
+              << "\n"
+              << "Snapshots:\n"
+              << "  --load-snapshot FILE  Resume from a binary snapshot instead of a Life file;\n"
+              << "                        -n counts from generation 0, so only the rest is run\n"
+              << "  --save-snapshot FILE  Write a binary snapshot of the final state\n"
+              << "  --snapshot-every K    Also save the snapshot every K generations\n"
+              << "\n"
               << "PNG Output:\n"
               << "  --png DIR          Save each frame as PNG to DIR\n"
               << "  --cell-size N      Pixels per cell (default: 4)\n"
@@ -35,7 +86,8 @@ void print_usage(const char* program) {
               << "Video Output (requires ffmpeg):\n"
               << "  --video FILE       Generate video file (MP4, WebM, or GIF)\n"
               << "  --fps N            Frames per second (default: 30)\n"
-              << "  --keep-frames      Keep PNG frames after video generation\n"
+              << "  --keep-frames      Accepted for compatibility; frames are streamed to\n"
+              << "                     ffmpeg, and only written to disk with --png\n"
               << "\n"
               << "If no file is specified, reads from stdin.\n";
 }
@@ -58,6 +110,21 @@ bool parse_positive_int(const char* str, int& result) {
     return true;
 }
 
+// Strict 64-bit integer parsing for iteration counts
+bool parse_positive_int64(const char* str, int64_t& result) {
+    if (str == nullptr || *str == '\0') return false;
+
+    char* end;
+    errno = 0;
+    long long val = std::strtoll(str, &end, 10);
+
+    if (*end != '\0') return false;
+    if (errno == ERANGE || val < 0) return false;
+
+    result = static_cast<int64_t>(val);
+    return true;
+}
+
 // Overflow-safe subtraction that clamps to INT64_MIN/MAX
 int64_t safe_sub(int64_t a, int64_t b) {
     if (b > 0 && a < std::numeric_limits<int64_t>::min() + b) {
@@ -80,33 +147,6 @@ int64_t safe_add(int64_t a, int64_t b) {
     return a + b;
 }
 
-std::string get_temp_dir() {
-    // Use mkdtemp for secure temp directory creation
-    // Must use char array, not std::string, because mkdtemp modifies in-place
-    // and we need to copy the result before the array goes out of scope
-    char tmpl[] = "/tmp/life_frames_XXXXXX";
-    char* result = mkdtemp(tmpl);
-    if (!result) {
-        throw std::runtime_error("Failed to create temp directory");
-    }
-    return std::string(result);
-}
-
-void remove_directory_contents(const std::string& dir) {
-    // Remove all PNG files in directory using std::filesystem
-    std::error_code ec;
-    for (const auto& entry : fs::directory_iterator(dir, ec)) {
-        if (entry.path().extension() == ".png") {
-            fs::remove(entry.path(), ec);
-        }
-    }
-}
-
-void remove_directory(const std::string& dir) {
-    std::error_code ec;
-    fs::remove_all(dir, ec);
-}
-
 std::string get_file_extension(const std::string& path) {
     size_t dot = path.rfind('.');
     if (dot == std::string::npos) return "";
@@ -118,116 +158,262 @@ std::string get_file_extension(const std::string& path) {
     return ext;
 }
 
-bool generate_video(const std::string& frame_dir, const std::string& output_path,
-                    int fps, bool show_stats) {
-    std::string ext = get_file_extension(output_path);
-
-    // Build ffmpeg arguments directly (no shell interpretation)
-    std::vector<std::string> args;
-    args.push_back("ffmpeg");
-    args.push_back("-y");
-    args.push_back("-framerate");
-    args.push_back(std::to_string(fps));
-    args.push_back("-i");
-    args.push_back(frame_dir + "/frame_%05d.png");
-
-    // Add codec-specific arguments
-    if (ext == ".mp4") {
-        args.push_back("-vf");
-        args.push_back("pad=ceil(iw/2)*2:ceil(ih/2)*2");
-        args.push_back("-c:v");
-        args.push_back("libx264");
-        args.push_back("-pix_fmt");
-        args.push_back("yuv420p");
-        args.push_back("-preset");
-        args.push_back("fast");
-        args.push_back("-crf");
-        args.push_back("18");
-    } else if (ext == ".webm") {
-        args.push_back("-vf");
-        args.push_back("pad=ceil(iw/2)*2:ceil(ih/2)*2");
-        args.push_back("-c:v");
-        args.push_back("libvpx-vp9");
-        args.push_back("-crf");
-        args.push_back("30");
-        args.push_back("-b:v");
-        args.push_back("0");
-    } else if (ext == ".gif") {
-        args.push_back("-vf");
-        args.push_back("split[s0][s1];[s0]palettegen[p];[s1][p]paletteuse");
-    } else if (ext == ".mov") {
-        args.push_back("-vf");
-        args.push_back("pad=ceil(iw/2)*2:ceil(ih/2)*2");
-        args.push_back("-c:v");
-        args.push_back("prores_ks");
-        args.push_back("-profile:v");
-        args.push_back("3");
-        args.push_back("-pix_fmt");
-        args.push_back("yuv422p10le");
-    } else {
-        // Default to MP4
-        args.push_back("-vf");
-        args.push_back("pad=ceil(iw/2)*2:ceil(ih/2)*2");
-        args.push_back("-c:v");
-        args.push_back("libx264");
-        args.push_back("-pix_fmt");
-        args.push_back("yuv420p");
-        args.push_back("-preset");
-        args.push_back("fast");
-        args.push_back("-crf");
-        args.push_back("18");
-    }
+// Batch mode (--batch): every pattern in `input` is parsed, run and written
+// out in input order. The input is several Life 1.06 documents back to back,
+// or else a manifest naming one pattern file per line.
+struct BatchOptions {
+    EngineType engine = EngineType::Hashtable;
+    std::optional<Rule> rule;
+    int64_t iterations = 10;
+    unsigned threads = 1;
+    int max_memory_mb = 0;
+    bool detect_cycles = false;
+    std::string output_format = "life";
+    bool show_stats = false;
+};
 
-    args.push_back(output_path);
+int run_batch(std::istream& input, const BatchOptions& options) {
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+    auto parse_start = Clock::now();
+    std::string text((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
 
-    if (show_stats) {
-        std::cerr << "   🎬 Encoding video...\n";
+    // Split into documents at each header line, or into manifest paths
+    std::vector<std::string_view> lines;
+    for (size_t pos = 0; pos < text.size();) {
+        size_t end = std::min(text.find('\n', pos), text.size());
+        lines.push_back(std::string_view(text).substr(pos, end - pos));
+        pos = end + 1;
+    }
+    auto trimmed = [](std::string_view line) {
+        size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string_view::npos) return std::string_view{};
+        return line.substr(begin, line.find_last_not_of(" \t\r") - begin + 1);
+    };
+    auto first = std::find_if(lines.begin(), lines.end(),
+                              [&](std::string_view line) { return !trimmed(line).empty(); });
+    bool documents = first != lines.end() && trimmed(*first).rfind("#Life 1.06", 0) == 0;
+    std::vector<std::string_view> items;
+    for (std::string_view line : lines) {
+        std::string_view item = trimmed(line);
+        if (documents) {
+            if (item.rfind("#Life 1.06", 0) == 0) {
+                items.push_back(line);
+            } else if (!items.empty()) {
+                // Extend the current document through this line
+                items.back() = std::string_view(items.back().data(),
+                                                line.data() + line.size() - items.back().data());
+            }
+        } else if (!item.empty()) {
+            items.push_back(item);
+        }
     }
 
-    // Fork and exec ffmpeg directly (no shell interpretation = no injection)
-    pid_t pid = fork();
-    if (pid < 0) {
-        std::cerr << "Error: Failed to fork for ffmpeg\n";
-        return false;
+    std::vector<GameOfLife> games(items.size());
+    std::vector<std::string> errors(items.size());
+    parallel_for_stealing(items.size(), options.threads, [&](size_t i, unsigned) {
+        try {
+            GameOfLife game;
+            if (documents) {
+                game = GameOfLife::parse(std::string(items[i]), options.engine);
+            } else {
+                std::string path(items[i]);
+                std::string ext = get_file_extension(path);
+                if (!has_valid_life_extension(path) && ext != ".rle" && ext != ".mc") {
+                    throw std::runtime_error("File must have .life, .lif, .rle or .mc extension");
+                }
+                std::ifstream file(path);
+                if (!file) throw std::runtime_error("Cannot open file");
+                game = ext == ".rle"  ? GameOfLife::parse_rle(file, options.engine)
+                       : ext == ".mc" ? GameOfLife::parse_macrocell(file, options.engine)
+                                      : GameOfLife::parse_file(path, options.engine, 1);
+            }
+            if (options.rule) game.set_rule(*options.rule);
+            if (options.max_memory_mb > 0) {
+                game.set_memory_limit(static_cast<size_t>(options.max_memory_mb) << 20);
+            }
+            game.set_cycle_detection(options.detect_cycles);
+            games[i] = std::move(game);
+        } catch (const std::exception& e) {
+            errors[i] = e.what();
+        }
+    });
+    for (size_t i = 0; i < items.size(); i++) {
+        if (errors[i].empty()) continue;
+        std::cerr << "Error: ";
+        if (documents) {
+            std::cerr << "pattern " << i + 1;
+        } else {
+            std::cerr << "'" << items[i] << "'";
+        }
+        std::cerr << ": " << errors[i] << "\n";
+        return 1;
     }
+    size_t input_cells = 0;
+    for (const auto& game : games) input_cells += game.count();
+    auto parse_end = Clock::now();
 
-    if (pid == 0) {
-        // Child process: exec ffmpeg
-        // Redirect stdout/stderr to /dev/null
-        freopen("/dev/null", "w", stdout);
-        freopen("/dev/null", "w", stderr);
+    simulate_batch(games, static_cast<uint64_t>(options.iterations), options.threads);
+    auto sim_end = Clock::now();
 
-        // Build argv array for execvp
-        std::vector<char*> argv;
-        for (auto& arg : args) {
-            argv.push_back(arg.data());
+    size_t output_cells = 0;
+    for (const auto& game : games) {
+        if (options.output_format == "rle") {
+            game.write_rle(std::cout);
+        } else if (options.output_format == "mc") {
+            game.write_macrocell(std::cout);
+        } else {
+            game.write(std::cout);
         }
-        argv.push_back(nullptr);
+        output_cells += game.count();
+    }
+    std::cout.flush();
+    auto write_end = Clock::now();
 
-        execvp("ffmpeg", argv.data());
-        // If execvp returns, it failed
-        _exit(127);
+    if (options.show_stats) {
+        std::cerr << "🧬 Game of Life Batch\n";
+        std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        std::cerr << "📥 Patterns:   " << games.size() << " (" << input_cells << " cells)\n";
+        std::cerr << "🔄 Iterations: " << options.iterations << " each\n";
+        std::cerr << "🧵 Workers:    " << options.threads << "\n";
+        std::cerr << "📤 Output:     " << output_cells << " cells\n";
+        std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        std::cerr << "⏱️  Timing\n";
+        std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        std::cerr << "   Parse:      " << ms(parse_end - parse_start) << " ms\n";
+        std::cerr << "   Simulate:   " << ms(sim_end - parse_end) << " ms\n";
+        std::cerr << "   Write:      " << ms(write_end - sim_end) << " ms\n";
+        std::cerr << "   ─────────────────────\n";
+        std::cerr << "   Total:      " << ms(write_end - parse_start) << " ms\n";
+        std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        if (options.iterations > 0 && sim_end > parse_end && !games.empty()) {
+            double patterns_per_sec = games.size() / (ms(sim_end - parse_end) / 1000.0);
+            std::cerr << "🚀 Speed:      " << static_cast<int64_t>(patterns_per_sec) << " patterns/sec\n";
+        }
+        std::cerr << "✅ Done!\n";
     }
+    return 0;
+}
 
-    // Parent process: wait for child
-    int status;
-    waitpid(pid, &status, 0);
+// Distributed mode (--distributed): the parsed pattern is handed to a
+// DistributedLife and the result streamed back from the ranks as Life 1.06
+struct DistributedRunOptions {
+    DistributedOptions life;
+    int64_t iterations = 10;
+    std::string shard_prefix;
+    int64_t snapshot_every = 0;
+    bool show_stats = false;
+};
 
-    bool cmd_success = (WIFEXITED(status) && WEXITSTATUS(status) == 0);
+int run_distributed(const CellSet& cells, uint64_t start_generation,
+                    const DistributedRunOptions& options) {
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+    auto start = Clock::now();
+    DistributedLife life(cells, options.life, start_generation);
+    uint64_t input_cells = life.count();
+    auto sim_start = Clock::now();
 
-    // Also verify the output file exists and has content
-    std::error_code ec;
-    bool file_exists = fs::exists(output_path, ec) && fs::file_size(output_path, ec) > 0;
+    // Run up to each checkpoint, then save the shards
+    uint64_t end = start_generation + static_cast<uint64_t>(options.iterations);
+    uint64_t every = static_cast<uint64_t>(options.snapshot_every);
+    while (life.generation() < end) {
+        uint64_t step = end - life.generation();
+        if (every > 0) step = std::min(step, every - life.generation() % every);
+        life.run(step);
+        if (every > 0 && life.generation() % every == 0 && life.generation() < end) {
+            life.save_shards(options.shard_prefix);
+        }
+    }
+    if (!options.shard_prefix.empty()) life.save_shards(options.shard_prefix);
+    auto sim_end = Clock::now();
 
-    return cmd_success || file_exists;
+    std::string text = "#Life 1.06\n";
+    life.for_each_batch([&](const std::vector<Cell>& batch) {
+        char number[24];
+        for (const auto& cell : batch) {
+            text.append(number, std::to_chars(number, number + sizeof(number), cell.x).ptr);
+            text += ' ';
+            text.append(number, std::to_chars(number, number + sizeof(number), cell.y).ptr);
+            text += '\n';
+        }
+        std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+        text.clear();
+    });
+    std::cout.flush();
+    auto write_end = Clock::now();
+
+    if (options.show_stats) {
+        const DistributedStats& stats = life.stats();
+        std::cerr << "🧬 Game of Life Distributed\n";
+        std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        std::cerr << "📥 Input:      " << input_cells << " cells\n";
+        std::cerr << "🔄 Iterations: " << options.iterations << "\n";
+        std::cerr << "🖧  Ranks:      " << options.life.ranks << " (" << engine_type_name(options.life.engine)
+                  << ", halo " << options.life.halo << ")\n";
+        std::cerr << "📤 Output:     " << life.count() << " cells\n";
+        std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        std::cerr << "🔁 Exchanges:  " << stats.exchanges << " (" << stats.halo_cells << " halo cells)\n";
+        std::cerr << "⚖️  Rebalances: " << stats.rebalances << " (" << stats.migrated_cells
+                  << " cells moved)\n";
+        for (size_t r = 0; r < life.populations().size(); r++) {
+            std::cerr << "   Rank " << r << ":     " << life.populations()[r] << " cells from x = ";
+            if (r == 0) {
+                std::cerr << "-inf\n";
+            } else {
+                std::cerr << life.boundaries()[r] << "\n";
+            }
+        }
+        std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        std::cerr << "⏱️  Timing\n";
+        std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        std::cerr << "   Partition:  " << ms(sim_start - start) << " ms\n";
+        std::cerr << "   Simulate:   " << ms(sim_end - sim_start) << " ms\n";
+        std::cerr << "   Write:      " << ms(write_end - sim_end) << " ms\n";
+        std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+        std::cerr << "✅ Done!\n";
+    }
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
-    int iterations = 10;
+    int64_t iterations = 10;
     std::string filepath;
     bool use_stdin = true;
     bool show_stats = false;
+    bool detect_cycles = false;
+    bool batch = false;
+    bool threads_given = false;
+    bool engine_given = false;
+    std::string output_format = "life";
     EngineType engine_type = EngineType::Hashtable;
+    std::optional<Rule> rule;
+    int threads = 1;
+    int max_memory_mb = 0;
+
+    // Snapshot options
+    std::string load_snapshot_path;
+    std::string save_snapshot_path;
+    int64_t snapshot_every = 0;
+
+    // Distributed options
+    int distributed_ranks = 0;
+    int64_t halo = 1;
+    std::string shard_prefix;
+
+    // Delta stream options
+    int64_t emit_every = 0;
+    std::string emit_path;
+    DeltaFormat emit_format = DeltaFormat::Text;
+    int64_t keyframe_every = 64;
+
+    // Metrics options
+    std::string metrics_path;
+    int64_t metrics_every = 1;
 
     // PNG options
     bool render_png = false;
@@ -237,8 +423,6 @@ int main(int argc, char* argv[]) {
     bool generate_video_output = false;
     std::string video_output_path;
     int video_fps = 30;
-    bool keep_frames = false;
-    bool using_temp_dir = false;
 
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -258,7 +442,7 @@ int main(int argc, char* argv[]) {
                 std::cerr << "Error: " << arg << " requires a number argument\n";
                 return 1;
             }
-            if (!parse_positive_int(argv[++i], iterations)) {
+            if (!parse_positive_int64(argv[++i], iterations)) {
                 std::cerr << "Error: Invalid iteration count (must be a non-negative integer)\n";
                 return 1;
             }
@@ -269,12 +453,169 @@ int main(int argc, char* argv[]) {
             }
             try {
                 engine_type = parse_engine_type(argv[++i]);
+                engine_given = true;
             } catch (const std::invalid_argument& e) {
                 std::cerr << "Error: " << e.what() << "\n";
                 return 1;
             }
+        } else if (arg == "--rule") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a rule argument\n";
+                return 1;
+            }
+            try {
+                rule = parse_rule(argv[++i]);
+            } catch (const std::invalid_argument& e) {
+                std::cerr << "Error: " << e.what() << "\n";
+                return 1;
+            }
+        } else if (arg == "--threads") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a number argument\n";
+                return 1;
+            }
+            if (!parse_positive_int(argv[++i], threads) || threads < 1) {
+                std::cerr << "Error: Invalid thread count (must be a positive integer)\n";
+                return 1;
+            }
+            threads_given = true;
+        } else if (arg == "--max-memory") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a number argument\n";
+                return 1;
+            }
+            if (!parse_positive_int(argv[++i], max_memory_mb) || max_memory_mb < 1) {
+                std::cerr << "Error: Invalid memory budget (must be a positive number of MB)\n";
+                return 1;
+            }
+        } else if (arg == "--detect-cycles") {
+            detect_cycles = true;
+        } else if (arg == "--batch") {
+            batch = true;
+        } else if (arg == "--distributed") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a number argument\n";
+                return 1;
+            }
+            if (!parse_positive_int(argv[++i], distributed_ranks) || distributed_ranks < 1) {
+                std::cerr << "Error: Invalid process count (must be a positive integer)\n";
+                return 1;
+            }
+        } else if (arg == "--halo") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a number argument\n";
+                return 1;
+            }
+            if (!parse_positive_int64(argv[++i], halo) || halo < 1) {
+                std::cerr << "Error: Invalid halo width (must be a positive integer)\n";
+                return 1;
+            }
+        } else if (arg == "--save-shards") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a prefix argument\n";
+                return 1;
+            }
+            shard_prefix = argv[++i];
+        } else if (arg == "--merge-shards") {
+            if (i + 2 >= argc) {
+                std::cerr << "Error: " << arg << " requires an output file and at least one shard\n";
+                return 1;
+            }
+            std::string output = argv[++i];
+            std::vector<std::string> shards(argv + i + 1, argv + argc);
+            try {
+                uint64_t merged = merge_snapshots(shards, output);
+                std::cerr << "Merged " << shards.size() << " shards (" << merged << " cells) into "
+                          << output << "\n";
+                return 0;
+            } catch (const std::exception& e) {
+                std::cerr << "❌ Error: " << e.what() << "\n";
+                return 1;
+            }
+        } else if (arg == "--load-snapshot") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a filename argument\n";
+                return 1;
+            }
+            load_snapshot_path = argv[++i];
+        } else if (arg == "--save-snapshot") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a filename argument\n";
+                return 1;
+            }
+            save_snapshot_path = argv[++i];
+        } else if (arg == "--snapshot-every") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a number argument\n";
+                return 1;
+            }
+            if (!parse_positive_int64(argv[++i], snapshot_every) || snapshot_every < 1) {
+                std::cerr << "Error: Invalid snapshot interval (must be a positive integer)\n";
+                return 1;
+            }
+        } else if (arg == "--output-format") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a format argument\n";
+                return 1;
+            }
+            output_format = argv[++i];
+            if (output_format != "life" && output_format != "rle" && output_format != "mc") {
+                std::cerr << "Error: Unknown output format '" << output_format
+                          << "' (expected life, rle or mc)\n";
+                return 1;
+            }
         } else if (arg == "--stats") {
             show_stats = true;
+        } else if (arg == "--emit-every") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a number argument\n";
+                return 1;
+            }
+            if (!parse_positive_int64(argv[++i], emit_every) || emit_every < 1) {
+                std::cerr << "Error: Invalid emit interval (must be a positive integer)\n";
+                return 1;
+            }
+        } else if (arg == "--emit-file") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a filename argument\n";
+                return 1;
+            }
+            emit_path = argv[++i];
+        } else if (arg == "--emit-format") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a format argument\n";
+                return 1;
+            }
+            try {
+                emit_format = parse_delta_format(argv[++i]);
+            } catch (const std::invalid_argument& e) {
+                std::cerr << "Error: " << e.what() << "\n";
+                return 1;
+            }
+        } else if (arg == "--keyframe-every") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a number argument\n";
+                return 1;
+            }
+            if (!parse_positive_int64(argv[++i], keyframe_every) || keyframe_every < 0) {
+                std::cerr << "Error: Invalid keyframe interval (must be a non-negative integer)\n";
+                return 1;
+            }
+        } else if (arg == "--metrics-json") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a filename argument\n";
+                return 1;
+            }
+            metrics_path = argv[++i];
+        } else if (arg == "--metrics-every") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a number argument\n";
+                return 1;
+            }
+            if (!parse_positive_int64(argv[++i], metrics_every) || metrics_every < 1) {
+                std::cerr << "Error: Invalid metrics interval (must be a positive integer)\n";
+                return 1;
+            }
         } else if (arg == "--png") {
             if (i + 1 >= argc) {
                 std::cerr << "Error: " << arg << " requires a directory argument\n";
@@ -319,7 +660,8 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
         } else if (arg == "--keep-frames") {
-            keep_frames = true;
+            // Accepted for compatibility: video frames are streamed to
+            // ffmpeg, and PNG frames are only written (and kept) with --png
         } else {
             std::cerr << "Error: Unknown argument '" << arg << "'\n";
             print_usage(argv[0]);
@@ -327,17 +669,68 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    // Validate file extension if reading from file
-    if (!use_stdin && !has_valid_life_extension(filepath)) {
-        std::cerr << "Error: File must have .life or .lif extension\n";
+    if (!load_snapshot_path.empty() && !use_stdin) {
+        std::cerr << "Error: --load-snapshot and --file are mutually exclusive\n";
+        return 1;
+    }
+    if (snapshot_every > 0 && save_snapshot_path.empty() && shard_prefix.empty()) {
+        std::cerr << "Error: --snapshot-every requires --save-snapshot or --save-shards\n";
         return 1;
     }
+    bool emit = emit_every > 0;
+    if (!emit && !emit_path.empty()) {
+        std::cerr << "Error: --emit-file requires --emit-every\n";
+        return 1;
+    }
+    bool distributed = distributed_ranks > 0;
+    if (distributed && (batch || render_png || generate_video_output || !save_snapshot_path.empty() ||
+                        detect_cycles || !metrics_path.empty() || emit || output_format != "life")) {
+        std::cerr << "Error: --distributed can't be combined with --batch, PNG, video, --save-snapshot,\n"
+                  << "       --detect-cycles, metrics, --emit-every or output formats other than life\n";
+        return 1;
+    }
+    if (!distributed && (halo != 1 || !shard_prefix.empty())) {
+        std::cerr << "Error: --halo and --save-shards require --distributed\n";
+        return 1;
+    }
+    bool metrics = !metrics_path.empty();
 
-    // If video output is requested but no PNG dir specified, use temp directory
-    if (generate_video_output && !render_png) {
-        render_config.output_dir = get_temp_dir();
-        render_png = true;
-        using_temp_dir = true;
+    if (batch) {
+        if (render_png || generate_video_output || !load_snapshot_path.empty() ||
+            !save_snapshot_path.empty() || metrics || emit) {
+            std::cerr << "Error: --batch can't be combined with PNG, video, snapshot, metrics or\n"
+                      << "       delta stream options\n";
+            return 1;
+        }
+        BatchOptions options;
+        options.engine = engine_type;
+        options.rule = rule;
+        options.iterations = iterations;
+        options.threads = threads_given ? static_cast<unsigned>(threads) : hardware_threads();
+        options.max_memory_mb = max_memory_mb;
+        options.detect_cycles = detect_cycles;
+        options.output_format = output_format;
+        options.show_stats = show_stats;
+        try {
+            if (use_stdin) return run_batch(std::cin, options);
+            std::ifstream file(filepath, std::ios::binary);
+            if (!file) {
+                std::cerr << "Error: Cannot open file '" << filepath << "'\n";
+                return 1;
+            }
+            return run_batch(file, options);
+        } catch (const std::exception& e) {
+            std::cerr << "❌ Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // Validate file extension if reading from file
+    std::string input_ext = use_stdin ? "" : get_file_extension(filepath);
+    if (!use_stdin && !has_valid_life_extension(filepath) && input_ext != ".rle" &&
+        input_ext != ".mc") {
+        std::cerr << "Error: File must have .life, .lif, .rle or .mc extension\n";
+        return 1;
     }
 
     // Validate PNG output directory
@@ -356,43 +749,68 @@ int main(int argc, char* argv[]) {
         // Parse phase
         auto parse_start = std::chrono::high_resolution_clock::now();
         GameOfLife game;
-        if (use_stdin) {
+        uint64_t start_generation = 0;
+        if (!load_snapshot_path.empty()) {
+            game = load_snapshot(load_snapshot_path, engine_type, start_generation);
+        } else if (use_stdin) {
             game = GameOfLife::parse(std::cin, engine_type);
         } else {
-            std::ifstream file(filepath);
-            if (!file) {
+            if (!std::ifstream(filepath)) {
                 std::cerr << "Error: Cannot open file '" << filepath << "'\n";
                 return 1;
             }
-            game = GameOfLife::parse(file, engine_type);
+            if (input_ext == ".rle" || input_ext == ".mc") {
+                std::ifstream file(filepath);
+                game = input_ext == ".rle" ? GameOfLife::parse_rle(file, engine_type)
+                                           : GameOfLife::parse_macrocell(file, engine_type);
+            } else {
+                game = GameOfLife::parse_file(filepath, engine_type, static_cast<unsigned>(threads));
+            }
+        }
+        if (rule) game.set_rule(*rule);
+        game.set_threads(static_cast<unsigned>(threads));
+        if (max_memory_mb > 0) {
+            game.set_memory_limit(static_cast<size_t>(max_memory_mb) << 20);
         }
+        game.set_cycle_detection(detect_cycles);
         auto parse_end = std::chrono::high_resolution_clock::now();
 
+        if (distributed) {
+            DistributedRunOptions options;
+            options.life.ranks = static_cast<unsigned>(distributed_ranks);
+            options.life.halo = static_cast<uint64_t>(halo);
+            options.life.engine = engine_given ? engine_type : EngineType::Tiled;
+            options.life.threads = static_cast<unsigned>(threads);
+            options.life.rule = game.rule();
+            options.iterations = std::max<int64_t>(
+                iterations - static_cast<int64_t>(std::min<uint64_t>(start_generation, INT64_MAX)), 0);
+            options.shard_prefix = shard_prefix;
+            options.snapshot_every = snapshot_every;
+            options.show_stats = show_stats;
+            CellSet cells = game.cells();
+            game = GameOfLife();
+            return run_distributed(cells, start_generation, options);
+        }
+
+        // A resumed run only covers the generations the snapshot hasn't
+        int64_t first_generation = static_cast<int64_t>(
+            std::min<uint64_t>(start_generation, std::numeric_limits<int64_t>::max()));
+        iterations = std::max<int64_t>(iterations - first_generation, 0);
+
         size_t initial_cells = game.count();
 
-        // Calculate fixed viewport for PNG rendering (based on initial state + padding for growth)
+        // Calculate fixed viewport for PNG/video rendering (based on initial state + padding for growth)
         int64_t vp_min_x = 0, vp_max_x = 0, vp_min_y = 0, vp_max_y = 0;
-        if (render_png) {
+        if (render_png || generate_video_output) {
             if (get_bounding_box(game, vp_min_x, vp_max_x, vp_min_y, vp_max_y)) {
-                // Check if bounding box is too large for rendering
-                int64_t width = vp_max_x - vp_min_x + 1;
-                int64_t height = vp_max_y - vp_min_y + 1;
-                constexpr int64_t MAX_RENDER_CELLS = 10000;
-
-                if (width > MAX_RENDER_CELLS || height > MAX_RENDER_CELLS) {
-                    std::cerr << "Warning: Pattern spans " << width << " x " << height
-                              << " cells, too large for PNG rendering.\n";
-                    std::cerr << "         PNG/video output disabled. Use a smaller pattern.\n";
-                    render_png = false;
-                    generate_video_output = false;
-                } else {
-                    // Add extra padding for pattern growth (using overflow-safe arithmetic)
-                    int64_t growth_padding = render_config.padding + iterations / 2;
-                    vp_min_x = safe_sub(vp_min_x, growth_padding);
-                    vp_max_x = safe_add(vp_max_x, growth_padding);
-                    vp_min_y = safe_sub(vp_min_y, growth_padding);
-                    vp_max_y = safe_add(vp_max_y, growth_padding);
-                }
+                // Add extra padding for pattern growth (using overflow-safe arithmetic).
+                // Viewports over render_config.max_cells_dimension are drawn
+                // downsampled, one pixel per 2^k x 2^k block.
+                int64_t growth_padding = safe_add(render_config.padding, iterations / 2);
+                vp_min_x = safe_sub(vp_min_x, growth_padding);
+                vp_max_x = safe_add(vp_max_x, growth_padding);
+                vp_min_y = safe_sub(vp_min_y, growth_padding);
+                vp_max_y = safe_add(vp_max_y, growth_padding);
             } else {
                 vp_min_x = vp_min_y = -50;
                 vp_max_x = vp_max_y = 50;
@@ -405,7 +823,13 @@ int main(int argc, char* argv[]) {
             std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
             std::cerr << "📥 Input:      " << initial_cells << " cells\n";
             std::cerr << "🔄 Iterations: " << iterations << "\n";
-            if (render_png && !using_temp_dir) {
+            if (!load_snapshot_path.empty()) {
+                std::cerr << "💾 Resumed:    generation " << start_generation << "\n";
+            }
+            if (threads > 1) {
+                std::cerr << "🧵 Threads:    " << threads << "\n";
+            }
+            if (render_png) {
                 std::cerr << "🖼️  PNG:        " << render_config.output_dir << "/\n";
             }
             if (generate_video_output) {
@@ -414,63 +838,231 @@ int main(int argc, char* argv[]) {
             std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
         }
 
-        auto sim_start = std::chrono::high_resolution_clock::now();
+        // One JSON object per line, written after every metrics_every
+        // generations (and after the last): where the run is, then what
+        // GameOfLife::take_metrics() collected since the previous line
+        std::ofstream metrics_out;
+        if (metrics) {
+            metrics_out.open(metrics_path);
+            if (!metrics_out) {
+                std::cerr << "Error: Cannot open metrics file '" << metrics_path << "'\n";
+                return 1;
+            }
+            game.set_metrics(true);
+        }
+        int64_t metrics_generation = first_generation;
+        auto emit_metrics = [&](int64_t generation) {
+            metrics_out << "{\"generation\":" << generation
+                        << ",\"generations\":" << generation - metrics_generation
+                        << ",\"population\":" << game.count();
+            for (const auto& metric : game.take_metrics()) {
+                metrics_out << ",\"" << metric.name << "\":" << metric.value;
+            }
+            metrics_out << "}\n";
+            metrics_generation = generation;
+        };
+        auto metrics_due = [&](int64_t generation) {
+            return metrics && ((generation - first_generation) % metrics_every == 0 ||
+                               generation == first_generation + iterations);
+        };
 
-        // Render initial state (frame 0)
-        if (render_png) {
-            if (!render_frame_fixed_viewport(game, render_config, 0,
-                                              vp_min_x, vp_max_x, vp_min_y, vp_max_y)) {
-                std::cerr << "Warning: Failed to render frame 0\n";
+        // The delta stream: a keyframe of the first generation, then every
+        // emit_every generations (and at the end) the changes the engine
+        // tracked since the previous frame, or a keyframe every
+        // keyframe_every frames
+        std::ofstream emit_file;
+        std::optional<DeltaWriter> emitter;
+        if (emit) {
+            if (!emit_path.empty()) {
+                emit_file.open(emit_path, std::ios::binary | std::ios::trunc);
+                if (!emit_file) {
+                    std::cerr << "Error: Cannot open delta stream file '" << emit_path << "'\n";
+                    return 1;
+                }
             }
+            emitter.emplace(emit_path.empty() ? std::cout : emit_file, emit_format);
+            game.set_track_changes(true);
         }
+        auto emit_state = [&](int64_t generation) {
+            if (emitter->frames() == 0 ||
+                (keyframe_every > 0 && emitter->frames() % static_cast<uint64_t>(keyframe_every) == 0)) {
+                game.take_changes();
+                std::vector<Cell> cells(game.cells().begin(), game.cells().end());
+                sort_cells(cells, static_cast<unsigned>(threads));
+                emitter->keyframe(static_cast<uint64_t>(generation), cells);
+            } else {
+                emitter->delta(static_cast<uint64_t>(generation), game.take_changes());
+            }
+        };
+        auto emit_due = [&](int64_t generation) {
+            return emit && (generation % emit_every == 0 || generation == first_generation + iterations);
+        };
+        if (emit) emit_state(first_generation);
 
-        // Run simulation with optional per-frame rendering
-        for (int i = 0; i < iterations; i++) {
-            game.tick();
+        auto sim_start = std::chrono::high_resolution_clock::now();
 
+        // Frames are rasterized here, once each, against a background drawn
+        // once for the viewport. PNG compression runs on a pool of encoder
+        // threads and video encoding in ffmpeg, both while the simulation
+        // continues; full queues push back on this loop.
+        using Clock = std::chrono::high_resolution_clock;
+        Clock::duration render_time{};
+        std::optional<FrameRenderer> renderer;
+        std::optional<PngEncoder> png_encoder;
+        if (render_png || generate_video_output) {
+            renderer.emplace(render_config, vp_min_x, vp_max_x, vp_min_y, vp_max_y);
+            if (show_stats && renderer->downsampled()) {
+                std::cerr << "   🔍 Downsampled to " << renderer->width() << " x " << renderer->height()
+                          << " pixels, each a density-shaded block of cells\n";
+            }
+        }
+        if (render_png) {
+            png_encoder.emplace(render_config, hardware_threads());
+        }
+        Frame frame;
+        Frame video_frame;
+        VideoStream video;
+        bool video_ok = false;
+        auto emit_frame = [&](int64_t number) {
+            auto render_start = Clock::now();
+            if (!renderer->valid()) {
+                std::cerr << "Warning: Failed to render frame " << number << "\n";
+                return;
+            }
+            renderer->render(game, frame);
+            if (generate_video_output) {
+                if (number == 0) {
+                    video_ok = video.open_ffmpeg(video_output_path, video_fps, frame.width, frame.height);
+                }
+                if (render_png) {
+                    video_frame = frame;
+                    video_ok = video_ok && video.write_frame(video_frame);
+                } else {
+                    video_ok = video_ok && video.write_frame(frame);
+                }
+            }
             if (render_png) {
-                if (!render_frame_fixed_viewport(game, render_config, i + 1,
-                                                  vp_min_x, vp_max_x, vp_min_y, vp_max_y)) {
-                    std::cerr << "Warning: Failed to render frame " << (i + 1) << "\n";
+                png_encoder->submit(frame, static_cast<int>(number));
+            }
+            render_time += Clock::now() - render_start;
+        };
+
+        if (render_png || generate_video_output) {
+            // Per-frame rendering needs every generation. Each generation is
+            // rendered (and checkpointed) while the engine computes the next
+            // one on its own thread.
+            if (iterations > 0) game.tick_async();
+            emit_frame(0);
+            for (int64_t i = 0; i < iterations; i++) {
+                game.finish_tick();
+                // Taken before the next tick starts, so they cover this one
+                if (metrics_due(first_generation + i + 1)) emit_metrics(first_generation + i + 1);
+                if (emit_due(first_generation + i + 1)) emit_state(first_generation + i + 1);
+                if (i + 1 < iterations) game.tick_async();
+                if (snapshot_every > 0 && (first_generation + i + 1) % snapshot_every == 0) {
+                    save_snapshot(game, save_snapshot_path, first_generation + i + 1);
                 }
 
+                emit_frame(i + 1);
+
                 // Progress indicator for long renders
                 if (show_stats && iterations >= 10 && (i + 1) % (iterations / 10) == 0) {
                     std::cerr << "   📸 Rendered frame " << (i + 1) << "/" << iterations << "\n";
                 }
             }
+        } else if (snapshot_every > 0 || metrics || emit) {
+            // Run up to each checkpoint, metrics line or delta frame, then
+            // save or emit
+            int64_t generation = first_generation;
+            int64_t end = first_generation + iterations;
+            while (generation < end) {
+                int64_t step = end - generation;
+                if (snapshot_every > 0) {
+                    step = std::min(step, snapshot_every - generation % snapshot_every);
+                }
+                if (metrics) {
+                    step = std::min(step, metrics_every - (generation - first_generation) % metrics_every);
+                }
+                if (emit) {
+                    step = std::min(step, emit_every - generation % emit_every);
+                }
+                game.run(step);
+                generation += step;
+                if (metrics_due(generation)) emit_metrics(generation);
+                if (emit_due(generation)) emit_state(generation);
+                if (snapshot_every > 0 && generation % snapshot_every == 0) {
+                    save_snapshot(game, save_snapshot_path, generation);
+                }
+            }
+        } else {
+            // Let the engine amortize its setup over the whole run
+            game.run(iterations);
+        }
+        int64_t final_generation = first_generation + iterations;
+        if (!save_snapshot_path.empty() &&
+            (snapshot_every == 0 || final_generation % snapshot_every != 0 || iterations == 0)) {
+            save_snapshot(game, save_snapshot_path, final_generation);
         }
 
         auto sim_end = std::chrono::high_resolution_clock::now();
+        if (metrics) {
+            metrics_out.close();
+            if (!metrics_out) {
+                std::cerr << "Warning: Failed to write metrics to '" << metrics_path << "'\n";
+            }
+        }
 
-        // Generate video if requested
+        // Wait for the queued frames to be encoded
+        auto encode_start = Clock::now();
+        if (png_encoder) {
+            for (int number : png_encoder->finish()) {
+                std::cerr << "Warning: Failed to render frame " << number << "\n";
+            }
+        }
         bool video_success = false;
-        if (generate_video_output && render_png) {
-            video_success = generate_video(render_config.output_dir, video_output_path,
-                                           video_fps, show_stats);
+        if (generate_video_output) {
+            if (show_stats) {
+                std::cerr << "   🎬 Encoding video...\n";
+            }
+            video_success = video.finish() && video_ok;
             if (!video_success) {
                 std::cerr << "Warning: Video generation failed. Is ffmpeg installed?\n";
             }
         }
+        // Time spent only on rendering: rasterizing, waiting on full queues,
+        // and draining them at the end. Ticks overlapped with rendering, so
+        // the simulation time is only what the frames had to wait for.
+        Clock::duration encode_time = Clock::now() - encode_start;
+        Clock::duration sim_time = (sim_end - sim_start) - render_time;
+        render_time += encode_time;
 
-        // Clean up temp frames if using temp directory and not keeping frames
-        if (using_temp_dir && !keep_frames) {
-            remove_directory(render_config.output_dir);
-        } else if (generate_video_output && !keep_frames && !using_temp_dir) {
-            // User specified --png and --video but not --keep-frames
-            // Keep the frames since they explicitly requested PNG output
+        if (!emit_path.empty()) {
+            emit_file.close();
+            if (!emit_file) {
+                std::cerr << "Warning: Failed to write delta stream to '" << emit_path << "'\n";
+            }
         }
 
-        // Output phase
+        // Output phase; a delta stream on stdout already ends with the final state
         auto write_start = std::chrono::high_resolution_clock::now();
-        game.write(std::cout);
+        if (!emit || !emit_path.empty()) {
+            if (output_format == "rle") {
+                game.write_rle(std::cout);
+            } else if (output_format == "mc") {
+                game.write_macrocell(std::cout);
+            } else {
+                std::cout.flush();
+                game.write_fd(STDOUT_FILENO);
+            }
+        }
         auto write_end = std::chrono::high_resolution_clock::now();
 
         auto total_end = std::chrono::high_resolution_clock::now();
 
         if (show_stats) {
             auto parse_ms = std::chrono::duration_cast<std::chrono::microseconds>(parse_end - parse_start).count() / 1000.0;
-            auto sim_ms = std::chrono::duration_cast<std::chrono::microseconds>(sim_end - sim_start).count() / 1000.0;
+            auto sim_ms = std::chrono::duration_cast<std::chrono::microseconds>(sim_time).count() / 1000.0;
+            auto render_ms = std::chrono::duration_cast<std::chrono::microseconds>(render_time).count() / 1000.0;
             auto write_ms = std::chrono::duration_cast<std::chrono::microseconds>(write_end - write_start).count() / 1000.0;
             auto total_ms = std::chrono::duration_cast<std::chrono::microseconds>(total_end - total_start).count() / 1000.0;
 
@@ -486,29 +1078,56 @@ int main(int argc, char* argv[]) {
             } else {
                 std::cerr << "no change\n";
             }
-            if (render_png && !using_temp_dir) {
+            if (const auto& cycle = game.cycle()) {
+                std::cerr << "🔁 Period:     " << cycle->period;
+                if (cycle->dx != 0 || cycle->dy != 0) {
+                    std::cerr << " (shift " << cycle->dx << ", " << cycle->dy << ")";
+                }
+                std::cerr << "\n";
+            } else if (detect_cycles) {
+                std::cerr << "🔁 Period:     none detected\n";
+            }
+            if (render_png) {
                 std::cerr << "🖼️  Frames:     " << (iterations + 1) << " PNG files\n";
             }
             if (generate_video_output && video_success) {
                 std::cerr << "🎬 Video:      " << video_output_path << "\n";
             }
+            if (!save_snapshot_path.empty()) {
+                std::cerr << "💾 Snapshot:   " << save_snapshot_path << " (generation "
+                          << final_generation << ")\n";
+            }
+            if (emitter) {
+                std::cerr << "🎞️  Deltas:     " << emitter->frames() << " frames ("
+                          << emitter->keyframes() << " keyframes), " << emitter->bytes_written()
+                          << " bytes\n";
+            }
             std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
             std::cerr << "⏱️  Timing\n";
             std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
             std::cerr << "   Parse:      " << parse_ms << " ms\n";
-            std::cerr << "   Simulate:   " << sim_ms << " ms";
-            if (render_png) {
-                std::cerr << " (includes rendering)";
+            std::cerr << "   Simulate:   " << sim_ms << " ms\n";
+            if (render_png || generate_video_output) {
+                std::cerr << "   Render:     " << render_ms << " ms\n";
             }
-            std::cerr << "\n";
             std::cerr << "   Write:      " << write_ms << " ms\n";
             std::cerr << "   ─────────────────────\n";
             std::cerr << "   Total:      " << total_ms << " ms\n";
             std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
 
+            auto counters = game.engine_counters();
+            if (!counters.empty()) {
+                std::cerr << "⚙️  Engine\n";
+                std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+                for (const auto& counter : counters) {
+                    std::cerr << "   " << counter.name << ": " << counter.value << "\n";
+                }
+                std::cerr << "━━━━━━━━━━━━━━━━━━━━━━━━━━\n";
+            }
+
             if (iterations > 0 && sim_ms > 0) {
                 double ticks_per_sec = iterations / (sim_ms / 1000.0);
-                std::cerr << "🚀 Speed:      " << static_cast<int>(ticks_per_sec) << " ticks/sec\n";
+                std::cerr << "🚀 Speed:      " << static_cast<int64_t>(ticks_per_sec) << " ticks/sec\n";
             }
             std::cerr << "✅ Done!\n";
         }
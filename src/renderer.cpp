@@ -4,58 +4,54 @@
 
 #include <vector>
 #include <algorithm>
+#include <cmath>
 #include <cstdio>
-#include <limits>
+#include <optional>
 #include <string>
 
 bool get_bounding_box(const GameOfLife& game,
                       int64_t& min_x, int64_t& max_x,
                       int64_t& min_y, int64_t& max_y) {
-    const auto& cells = game.cells();
-    if (cells.empty()) {
+    std::optional<BoundingBox> box = game.bounding_box();
+    if (!box) {
         // Initialize output params to sensible defaults even on failure
         min_x = max_x = 0;
         min_y = max_y = 0;
         return false;
     }
 
-    min_x = std::numeric_limits<int64_t>::max();
-    max_x = std::numeric_limits<int64_t>::min();
-    min_y = std::numeric_limits<int64_t>::max();
-    max_y = std::numeric_limits<int64_t>::min();
-
-    for (const auto& cell : cells) {
-        min_x = std::min(min_x, cell.x);
-        max_x = std::max(max_x, cell.x);
-        min_y = std::min(min_y, cell.y);
-        max_y = std::max(max_y, cell.y);
-    }
-
+    min_x = box->min_x;
+    max_x = box->max_x;
+    min_y = box->min_y;
+    max_y = box->max_y;
     return true;
 }
 
-bool render_frame_fixed_viewport(const GameOfLife& game, const RenderConfig& config,
-                                  int frame_number,
-                                  int64_t min_x, int64_t max_x,
-                                  int64_t min_y, int64_t max_y) {
-    // Check for potential overflow in dimension calculation (max_x - min_x + 1)
-    // This can overflow if max_x is very large and min_x is very negative
-    if (max_x > 0 && min_x < 0 && max_x > std::numeric_limits<int64_t>::max() + min_x) {
-        return false;  // Overflow would occur
-    }
-    if (max_y > 0 && min_y < 0 && max_y > std::numeric_limits<int64_t>::max() + min_y) {
-        return false;  // Overflow would occur
+FrameRenderer::FrameRenderer(const RenderConfig& config,
+                             int64_t min_x, int64_t max_x,
+                             int64_t min_y, int64_t max_y)
+    : min_x_(min_x), min_y_(min_y), alive_color_(config.alive_color) {
+    if (max_x < min_x || max_y < min_y) return;
+
+    // Viewports over max_cells_dimension (including ones too wide for
+    // max_x - min_x + 1 to fit in int64_t) are drawn downsampled
+    uint64_t span_x = static_cast<uint64_t>(max_x) - static_cast<uint64_t>(min_x);
+    uint64_t span_y = static_cast<uint64_t>(max_y) - static_cast<uint64_t>(min_y);
+    if (span_x >= static_cast<uint64_t>(config.max_cells_dimension) ||
+        span_y >= static_cast<uint64_t>(config.max_cells_dimension)) {
+        if (config.downsample) init_density(config, min_x, max_x, min_y, max_y);
+        return;
     }
 
     // Calculate viewport dimensions in cells
-    int64_t width_cells = max_x - min_x + 1;
-    int64_t height_cells = max_y - min_y + 1;
+    width_cells_ = max_x - min_x + 1;
+    height_cells_ = max_y - min_y + 1;
 
     // Sanity check: if viewport is too large, we can't render it
-    if (width_cells > config.max_cells_dimension || height_cells > config.max_cells_dimension ||
-        width_cells <= 0 || height_cells <= 0) {
+    if (width_cells_ > config.max_cells_dimension || height_cells_ > config.max_cells_dimension ||
+        width_cells_ <= 0 || height_cells_ <= 0) {
         // Viewport too large or invalid, skip rendering
-        return false;
+        return;
     }
 
     // Calculate effective cell size
@@ -63,7 +59,7 @@ bool render_frame_fixed_viewport(const GameOfLife& game, const RenderConfig& con
 
     // Check for overflow in pixel calculation before computing
     // width_cells * height_cells * eff_cell_size * eff_cell_size
-    int64_t cell_area = width_cells * height_cells;  // Safe because both are <= max_cells_dimension
+    int64_t cell_area = width_cells_ * height_cells_;  // Safe because both are <= max_cells_dimension
     int64_t cell_size_sq = static_cast<int64_t>(eff_cell_size) * eff_cell_size;
     if (cell_area > config.max_pixels / cell_size_sq) {
         // Would overflow or exceed max, need to scale down
@@ -78,113 +74,235 @@ bool render_frame_fixed_viewport(const GameOfLife& game, const RenderConfig& con
     }
 
     // Calculate image dimensions
-    int img_width = static_cast<int>(width_cells * eff_cell_size);
-    int img_height = static_cast<int>(height_cells * eff_cell_size);
+    int img_width = static_cast<int>(width_cells_ * eff_cell_size);
+    int img_height = static_cast<int>(height_cells_ * eff_cell_size);
 
     // Clamp to max dimensions
     img_width = std::min(img_width, config.max_width);
     img_height = std::min(img_height, config.max_height);
 
     if (img_width <= 0 || img_height <= 0) {
-        return false;
+        return;
     }
 
-    // Create image buffer (RGBA)
-    std::vector<uint32_t> pixels(static_cast<size_t>(img_width) * img_height, config.dead_color);
 
-    // Precompute grid settings to avoid repeated checks in hot loop
-    const bool draw_grid = config.show_grid && eff_cell_size > 2;
+    width_ = img_width;
+    height_ = img_height;
+    cell_size_ = eff_cell_size;
+    draw_grid_ = config.show_grid && eff_cell_size > 2;
 
-    // Draw grid lines if enabled
-    // Note: This is O(num_lines * pixels_per_line) which can be significant for large images
-    if (draw_grid) {
+    // Background (dead cells and grid lines), drawn once and copied into
+    // every frame
+    background_.assign(static_cast<size_t>(width_) * height_, config.dead_color);
+    if (draw_grid_) {
         // Draw vertical lines
-        for (int64_t cx = 0; cx <= width_cells; cx++) {
-            int x = static_cast<int>(cx * eff_cell_size);
-            if (x < img_width) {
-                for (int y = 0; y < img_height; y++) {
-                    pixels[static_cast<size_t>(y) * img_width + x] = config.grid_color;
+        for (int64_t cx = 0; cx <= width_cells_; cx++) {
+            int x = static_cast<int>(cx * cell_size_);
+            if (x < width_) {
+                for (int y = 0; y < height_; y++) {
+                    background_[static_cast<size_t>(y) * width_ + x] = config.grid_color;
                 }
             }
         }
         // Draw horizontal lines
-        for (int64_t cy = 0; cy <= height_cells; cy++) {
-            int y = static_cast<int>(cy * eff_cell_size);
-            if (y < img_height) {
-                for (int x = 0; x < img_width; x++) {
-                    pixels[static_cast<size_t>(y) * img_width + x] = config.grid_color;
-                }
+        for (int64_t cy = 0; cy <= height_cells_; cy++) {
+            int y = static_cast<int>(cy * cell_size_);
+            if (y < height_) {
+                std::fill_n(&background_[static_cast<size_t>(y) * width_], width_, config.grid_color);
             }
         }
     }
+    valid_ = true;
+}
 
-    // Draw live cells - separate code paths for grid/no-grid to avoid branch in hot loop
-    if (draw_grid) {
-        // With grid: skip first row/column of each cell (where grid lines are)
-        for (const auto& cell : game.cells()) {
-            int64_t rel_x = cell.x - min_x;
-            int64_t rel_y = cell.y - min_y;
+// Each pixel is a 2^level square block, the smallest level whose block grid
+// (aligned to multiples of 2^level) fits max_width x max_height and
+// max_pixels.
+void FrameRenderer::init_density(const RenderConfig& config,
+                                 int64_t min_x, int64_t max_x,
+                                 int64_t min_y, int64_t max_y) {
+    for (int level = 1; level <= 62; level++) {
+        int64_t aligned_x = (min_x >> level) * (int64_t(1) << level);
+        int64_t aligned_y = (min_y >> level) * (int64_t(1) << level);
+        uint64_t blocks_x = ((static_cast<uint64_t>(max_x) - static_cast<uint64_t>(aligned_x)) >> level) + 1;
+        uint64_t blocks_y = ((static_cast<uint64_t>(max_y) - static_cast<uint64_t>(aligned_y)) >> level) + 1;
+        if (blocks_x > static_cast<uint64_t>(config.max_width) ||
+            blocks_y > static_cast<uint64_t>(config.max_height) ||
+            blocks_x * blocks_y > static_cast<uint64_t>(config.max_pixels)) {
+            continue;
+        }
 
-            if (rel_x < 0 || rel_x >= width_cells || rel_y < 0 || rel_y >= height_cells) {
-                continue;
+        blocks_ = BlockGrid{aligned_x, aligned_y, level, static_cast<int>(blocks_x),
+                            static_cast<int>(blocks_y)};
+        width_ = blocks_.width;
+        height_ = blocks_.height;
+        background_.assign(static_cast<size_t>(width_) * height_, config.dead_color);
+
+        // Shades from dead_color to alive_color. Density is shown on a square
+        // root scale so sparse regions stay visible; any live cell gets at
+        // least the first shade.
+        for (int i = 0; i < 256; i++) {
+            uint32_t color = 0;
+            for (int shift = 0; shift < 32; shift += 8) {
+                int dead = static_cast<int>((config.dead_color >> shift) & 0xFF);
+                int alive = static_cast<int>((config.alive_color >> shift) & 0xFF);
+                color |= static_cast<uint32_t>(dead + (alive - dead) * i / 255) << shift;
             }
+            shades_[i] = color;
+        }
+        density_ = true;
+        valid_ = true;
+        return;
+    }
+}
 
-            int px_start_x = static_cast<int>(rel_x * eff_cell_size);
-            int px_start_y = static_cast<int>(rel_y * eff_cell_size);
-
-            if (px_start_x >= img_width || px_start_y >= img_height) {
-                continue;
-            }
+void FrameRenderer::render(const GameOfLife& game, Frame& frame) {
+    // Copy the background, reusing the frame's allocation
+    frame.width = width_;
+    frame.height = height_;
+    frame.pixels = background_;
+    if (!valid_) return;
+
+    if (density_) {
+        // One block count per pixel, taken from the engine's spatial index
+        // where it has one
+        game.count_blocks(blocks_, counts_);
+        const double cells_per_block = std::ldexp(1.0, 2 * blocks_.level);
+        for (size_t i = 0; i < counts_.size(); i++) {
+            if (counts_[i] == 0) continue;
+            double shade = std::sqrt(static_cast<double>(counts_[i]) / cells_per_block) * 255.0;
+            frame.pixels[i] = shades_[std::clamp(static_cast<int>(shade + 0.5), 1, 255)];
+        }
+        return;
+    }
 
-            // Fill cell rectangle, starting at offset 1 to skip grid lines
-            int max_dy = std::min(eff_cell_size, img_height - px_start_y);
-            int max_dx = std::min(eff_cell_size, img_width - px_start_x);
-            for (int dy = 1; dy < max_dy; dy++) {
-                for (int dx = 1; dx < max_dx; dx++) {
-                    pixels[static_cast<size_t>(px_start_y + dy) * img_width + (px_start_x + dx)] = config.alive_color;
-                }
-            }
+    // Only the cells in the visible part of the viewport are fetched, so an
+    // engine with a spatial index never visits the rest of the pattern
+    const int64_t visible_x = std::min<int64_t>(width_cells_, (width_ + cell_size_ - 1) / cell_size_);
+    const int64_t visible_y = std::min<int64_t>(height_cells_, (height_ + cell_size_ - 1) / cell_size_);
+    visible_.clear();
+    game.cells_in_rect(BoundingBox{min_x_, min_x_ + visible_x - 1, min_y_, min_y_ + visible_y - 1},
+                       visible_);
+
+    // With grid lines, skip the first row/column of each cell (where the
+    // lines are)
+    const int inset = draw_grid_ ? 1 : 0;
+    uint32_t* pixels = frame.pixels.data();
+    for (const auto& cell : visible_) {
+        int64_t rel_x = cell.x - min_x_;
+        int64_t rel_y = cell.y - min_y_;
+
+        if (rel_x < 0 || rel_x >= width_cells_ || rel_y < 0 || rel_y >= height_cells_) {
+            continue;
         }
-    } else {
-        // No grid: fill entire cell rectangle
-        for (const auto& cell : game.cells()) {
-            int64_t rel_x = cell.x - min_x;
-            int64_t rel_y = cell.y - min_y;
-
-            if (rel_x < 0 || rel_x >= width_cells || rel_y < 0 || rel_y >= height_cells) {
-                continue;
-            }
 
-            int px_start_x = static_cast<int>(rel_x * eff_cell_size);
-            int px_start_y = static_cast<int>(rel_y * eff_cell_size);
+        int px_start_x = static_cast<int>(rel_x * cell_size_);
+        int px_start_y = static_cast<int>(rel_y * cell_size_);
 
-            if (px_start_x >= img_width || px_start_y >= img_height) {
-                continue;
-            }
+        if (px_start_x >= width_ || px_start_y >= height_) {
+            continue;
+        }
 
-            // Fill entire cell rectangle
-            int max_dy = std::min(eff_cell_size, img_height - px_start_y);
-            int max_dx = std::min(eff_cell_size, img_width - px_start_x);
-            for (int dy = 0; dy < max_dy; dy++) {
-                for (int dx = 0; dx < max_dx; dx++) {
-                    pixels[static_cast<size_t>(px_start_y + dy) * img_width + (px_start_x + dx)] = config.alive_color;
-                }
-            }
+        // Fill cell rectangle
+        int max_dy = std::min(cell_size_, height_ - px_start_y);
+        int max_dx = std::min(cell_size_, width_ - px_start_x);
+        for (int dy = inset; dy < max_dy; dy++) {
+            std::fill_n(&pixels[static_cast<size_t>(px_start_y + dy) * width_ + px_start_x + inset],
+                        max_dx - inset, alive_color_);
         }
     }
+}
 
+bool render_pixels(const GameOfLife& game, const RenderConfig& config,
+                   int64_t min_x, int64_t max_x,
+                   int64_t min_y, int64_t max_y, Frame& frame) {
+    FrameRenderer renderer(config, min_x, max_x, min_y, max_y);
+    if (!renderer.valid()) return false;
+    renderer.render(game, frame);
+    return true;
+}
+
+bool write_png(const Frame& frame, const RenderConfig& config, int frame_number) {
     // Generate filename using std::string (avoids fixed buffer issues)
     char frame_str[16];
     snprintf(frame_str, sizeof(frame_str), "%05d", frame_number);
     std::string filename = config.output_dir + "/frame_" + frame_str + ".png";
 
     // Write PNG (RGBA = 4 channels)
-    int result = stbi_write_png(filename.c_str(), img_width, img_height, 4,
-                                 pixels.data(), img_width * 4);
+    int result = stbi_write_png(filename.c_str(), frame.width, frame.height, 4,
+                                 frame.pixels.data(), frame.width * 4);
 
     return result != 0;
 }
 
+PngEncoder::PngEncoder(const RenderConfig& config, unsigned threads)
+    : config_(config), capacity_(kQueuedFramesPerThread * std::max(threads, 1u)) {
+    for (unsigned t = 0; t < std::max(threads, 1u); t++) {
+        workers_.emplace_back(&PngEncoder::encode_loop, this);
+    }
+}
+
+PngEncoder::~PngEncoder() {
+    (void)finish();
+}
+
+void PngEncoder::submit(Frame& frame, int frame_number) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return queue_.size() < capacity_; });
+    Frame spare;
+    if (!spare_.empty()) {
+        spare = std::move(spare_.back());
+        spare_.pop_back();
+    }
+    queue_.emplace_back(frame_number, std::move(frame));
+    frame = std::move(spare);
+    cv_.notify_all();
+}
+
+std::vector<int> PngEncoder::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    std::vector<int> failed;
+    failed.swap(failed_);
+    std::sort(failed.begin(), failed.end());
+    return failed;
+}
+
+void PngEncoder::encode_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [&] { return !queue_.empty() || closing_; });
+        if (queue_.empty()) return;
+
+        auto [number, frame] = std::move(queue_.front());
+        queue_.pop_front();
+        cv_.notify_all();  // room for another submit()
+        lock.unlock();
+
+        bool ok = write_png(frame, config_, number);
+
+        lock.lock();
+        if (!ok) failed_.push_back(number);
+        spare_.push_back(std::move(frame));
+    }
+}
+
+bool render_frame_fixed_viewport(const GameOfLife& game, const RenderConfig& config,
+                                  int frame_number,
+                                  int64_t min_x, int64_t max_x,
+                                  int64_t min_y, int64_t max_y) {
+    Frame frame;
+    return render_pixels(game, config, min_x, max_x, min_y, max_y, frame) &&
+           write_png(frame, config, frame_number);
+}
+
 bool render_frame(const GameOfLife& game, const RenderConfig& config, int frame_number) {
     int64_t min_x, max_x, min_y, max_y;
 
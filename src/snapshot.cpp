@@ -0,0 +1,361 @@
+#include "snapshot.h"
+#include "engine.h"
+#include "mapped_file.h"
+#include "radix_sort.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[8] = {'L', 'I', 'F', 'E', 'S', 'N', 'A', 'P'};
+constexpr size_t kHeaderBytes = 8 + 4 + 4 + 8 + 8 + 4 * 8 + 8;
+
+struct Header {
+    uint32_t version = kSnapshotVersion;
+    uint32_t flags = 0;
+    uint64_t generation = 0;
+    uint64_t cells = 0;
+    int64_t min_x = 0, max_x = 0, min_y = 0, max_y = 0;
+    uint64_t payload_bytes = 0;
+};
+
+// Little-endian fixed-width fields, independent of host byte order
+void put_le(unsigned char*& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        *out++ = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+uint64_t get_le(const unsigned char*& in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= uint64_t(*in++) << (8 * i);
+    }
+    return value;
+}
+
+void encode_header(const Header& h, unsigned char* out) {
+    std::memcpy(out, kMagic, sizeof(kMagic));
+    out += sizeof(kMagic);
+    put_le(out, h.version, 4);
+    put_le(out, h.flags, 4);
+    put_le(out, h.generation, 8);
+    put_le(out, h.cells, 8);
+    put_le(out, static_cast<uint64_t>(h.min_x), 8);
+    put_le(out, static_cast<uint64_t>(h.max_x), 8);
+    put_le(out, static_cast<uint64_t>(h.min_y), 8);
+    put_le(out, static_cast<uint64_t>(h.max_y), 8);
+    put_le(out, h.payload_bytes, 8);
+}
+
+Header decode_header(const unsigned char* in) {
+    in += sizeof(kMagic);
+    Header h;
+    h.version = static_cast<uint32_t>(get_le(in, 4));
+    h.flags = static_cast<uint32_t>(get_le(in, 4));
+    h.generation = get_le(in, 8);
+    h.cells = get_le(in, 8);
+    h.min_x = static_cast<int64_t>(get_le(in, 8));
+    h.max_x = static_cast<int64_t>(get_le(in, 8));
+    h.min_y = static_cast<int64_t>(get_le(in, 8));
+    h.max_y = static_cast<int64_t>(get_le(in, 8));
+    h.payload_bytes = get_le(in, 8);
+    return h;
+}
+
+inline unsigned char* put_varint(unsigned char* out, uint64_t value) noexcept {
+    while (value >= 0x80) {
+        *out++ = static_cast<unsigned char>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<unsigned char>(value);
+    return out;
+}
+
+// Returns false on truncated or over-long input
+inline bool get_varint(const unsigned char*& in, const unsigned char* end, uint64_t& value) noexcept {
+    value = 0;
+    for (int shift = 0; shift < 64 && in < end; shift += 7) {
+        unsigned char byte = *in++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+[[noreturn]] void throw_corrupt(const std::string& path) {
+    throw std::runtime_error("Invalid snapshot '" + path + "': corrupt cell data");
+}
+
+// Streams cells, in strictly increasing (x, y) order, into a temporary file
+// next to `path`; finish() writes the header and renames it into place
+class SnapshotWriter {
+public:
+    SnapshotWriter(const std::string& path, const Header& header)
+        : path_(path), tmp_path_(path + ".tmp"), h_(header),
+          out_(tmp_path_, std::ios::binary | std::ios::trunc),
+          prev_x_(static_cast<uint64_t>(header.min_x)) {
+        if (!out_) {
+            throw std::runtime_error("Cannot write snapshot '" + tmp_path_ + "'");
+        }
+        // Header placeholder; rewritten once the payload size is known
+        unsigned char placeholder[kHeaderBytes] = {};
+        out_.write(reinterpret_cast<const char*>(placeholder), kHeaderBytes);
+        h_.cells = 0;
+        h_.payload_bytes = 0;
+    }
+
+    ~SnapshotWriter() {
+        if (!finished_) {
+            out_.close();
+            std::remove(tmp_path_.c_str());
+        }
+    }
+
+    void add(const Cell& cell) {
+        if (static_cast<size_t>(buf_ + kBufSize - pos_) < kMaxCellBytes) flush();
+        uint64_t x = static_cast<uint64_t>(cell.x);
+        uint64_t y = static_cast<uint64_t>(cell.y);
+        uint64_t dx = x - prev_x_;
+        pos_ = put_varint(pos_, dx);
+        if (h_.cells > 0 && dx == 0) {
+            pos_ = put_varint(pos_, y - prev_y_ - 1);
+        } else {
+            pos_ = put_varint(pos_, y - static_cast<uint64_t>(h_.min_y));
+        }
+        prev_x_ = x;
+        prev_y_ = y;
+        ++h_.cells;
+    }
+
+    void finish() {
+        flush();
+        unsigned char header[kHeaderBytes];
+        encode_header(h_, header);
+        out_.seekp(0);
+        out_.write(reinterpret_cast<const char*>(header), kHeaderBytes);
+        out_.close();
+        finished_ = true;
+        if (!out_) {
+            std::remove(tmp_path_.c_str());
+            throw std::runtime_error("Cannot write snapshot '" + tmp_path_ + "'");
+        }
+        if (std::rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+            std::remove(tmp_path_.c_str());
+            throw std::runtime_error("Cannot write snapshot '" + path_ + "'");
+        }
+    }
+
+private:
+    // Two varints per cell, at most 10 bytes each
+    static constexpr size_t kBufSize = 1 << 16;
+    static constexpr size_t kMaxCellBytes = 20;
+
+    std::string path_;
+    std::string tmp_path_;
+    Header h_;
+    std::ofstream out_;
+    unsigned char buf_[kBufSize];
+    unsigned char* pos_ = buf_;
+    uint64_t prev_x_;
+    uint64_t prev_y_ = 0;
+    bool finished_ = false;
+
+    void flush() {
+        out_.write(reinterpret_cast<const char*>(buf_), pos_ - buf_);
+        h_.payload_bytes += static_cast<uint64_t>(pos_ - buf_);
+        pos_ = buf_;
+    }
+};
+
+// Decodes a snapshot straight out of its mapping, checking every cell
+// against the bounding box and the strict (x, y) order so a damaged file
+// can't produce duplicates or stray cells
+class SnapshotReader {
+public:
+    explicit SnapshotReader(const std::string& path) : path_(path), file_(path) {
+        std::string_view data = file_.text();
+        if (data.size() < kHeaderBytes) {
+            throw std::runtime_error("Invalid snapshot '" + path + "': truncated header");
+        }
+        const auto* in = reinterpret_cast<const unsigned char*>(data.data());
+        if (std::memcmp(in, kMagic, sizeof(kMagic)) != 0) {
+            throw std::runtime_error("Invalid snapshot '" + path + "': not a snapshot file");
+        }
+        h_ = decode_header(in);
+        if (h_.version != kSnapshotVersion) {
+            throw std::runtime_error("Invalid snapshot '" + path + "': unsupported version " +
+                                     std::to_string(h_.version));
+        }
+        if (h_.flags != 0) {
+            throw std::runtime_error("Invalid snapshot '" + path + "': unsupported flags");
+        }
+        if (h_.payload_bytes != data.size() - kHeaderBytes || h_.cells > h_.payload_bytes / 2 ||
+            (h_.cells > 0 && (h_.min_x > h_.max_x || h_.min_y > h_.max_y))) {
+            throw_corrupt(path);
+        }
+        pos_ = in + kHeaderBytes;
+        end_ = pos_ + h_.payload_bytes;
+        width_ = static_cast<uint64_t>(h_.max_x) - static_cast<uint64_t>(h_.min_x);
+        height_ = static_cast<uint64_t>(h_.max_y) - static_cast<uint64_t>(h_.min_y);
+    }
+
+    const Header& header() const noexcept { return h_; }
+
+    /** The next cell, or false once all h.cells are read. */
+    bool next(Cell& cell) {
+        if (read_ == h_.cells) {
+            if (pos_ != end_) throw_corrupt(path_);
+            return false;
+        }
+        uint64_t dx, v;
+        if (!get_varint(pos_, end_, dx) || !get_varint(pos_, end_, v) || dx > width_ - ux_) {
+            throw_corrupt(path_);
+        }
+        ux_ += dx;
+        if (read_ > 0 && dx == 0) {
+            if (v >= height_ - uy_) throw_corrupt(path_);
+            uy_ += v + 1;
+        } else {
+            if (v > height_) throw_corrupt(path_);
+            uy_ = v;
+        }
+        ++read_;
+        cell = {static_cast<int64_t>(static_cast<uint64_t>(h_.min_x) + ux_),
+                static_cast<int64_t>(static_cast<uint64_t>(h_.min_y) + uy_)};
+        return true;
+    }
+
+private:
+    std::string path_;
+    MappedFile file_;
+    Header h_;
+    const unsigned char* pos_ = nullptr;
+    const unsigned char* end_ = nullptr;
+    uint64_t width_ = 0;
+    uint64_t height_ = 0;
+    uint64_t read_ = 0;
+    uint64_t ux_ = 0;  // x - min_x
+    uint64_t uy_ = 0;  // y - min_y
+};
+
+bool cell_less(const Cell& a, const Cell& b) noexcept {
+    return a.x != b.x ? a.x < b.x : a.y < b.y;
+}
+
+} // anonymous namespace
+
+void save_snapshot(const GameOfLife& game, const std::string& path, uint64_t generation) {
+    save_snapshot(game.cells(), path, generation, game.threads());
+}
+
+void save_snapshot(const CellSet& live_cells, const std::string& path, uint64_t generation,
+                   unsigned threads) {
+    std::vector<Cell> cells(live_cells.begin(), live_cells.end());
+
+    Header h;
+    h.generation = generation;
+    if (!cells.empty()) {
+        h.min_x = h.max_x = cells.front().x;
+        h.min_y = h.max_y = cells.front().y;
+        for (const auto& cell : cells) {
+            h.min_x = std::min(h.min_x, cell.x);
+            h.max_x = std::max(h.max_x, cell.x);
+            h.min_y = std::min(h.min_y, cell.y);
+            h.max_y = std::max(h.max_y, cell.y);
+        }
+    }
+
+    sort_cells(cells, threads);
+
+    SnapshotWriter writer(path, h);
+    for (const auto& cell : cells) {
+        writer.add(cell);
+    }
+    writer.finish();
+}
+
+GameOfLife load_snapshot(const std::string& path, EngineType engine, uint64_t& generation) {
+    SnapshotReader reader(path);
+    std::vector<Cell> cells;
+    cells.reserve(reader.header().cells);
+    Cell cell;
+    while (reader.next(cell)) {
+        cells.push_back(cell);
+    }
+
+    CellSet set;
+#if USE_FAST_HASH
+    // Cells are distinct, so the vector can become the set's storage as is
+    set.replace(std::move(cells));
+#else
+    set.reserve(cells.size());
+    set.insert(cells.begin(), cells.end());
+#endif
+    generation = reader.header().generation;
+    return GameOfLife(std::move(set), engine);
+}
+
+uint64_t merge_snapshots(const std::vector<std::string>& inputs, const std::string& path) {
+    if (inputs.empty()) {
+        throw std::invalid_argument("No snapshots to merge");
+    }
+    std::vector<std::unique_ptr<SnapshotReader>> readers;
+    Header h;
+    bool any_cells = false;
+    for (const auto& input : inputs) {
+        readers.push_back(std::make_unique<SnapshotReader>(input));
+        const Header& part = readers.back()->header();
+        if (part.generation != readers.front()->header().generation) {
+            throw std::runtime_error("Cannot merge snapshot '" + input + "': generation " +
+                                     std::to_string(part.generation) + ", expected " +
+                                     std::to_string(readers.front()->header().generation));
+        }
+        if (part.cells == 0) continue;
+        h.min_x = any_cells ? std::min(h.min_x, part.min_x) : part.min_x;
+        h.max_x = any_cells ? std::max(h.max_x, part.max_x) : part.max_x;
+        h.min_y = any_cells ? std::min(h.min_y, part.min_y) : part.min_y;
+        h.max_y = any_cells ? std::max(h.max_y, part.max_y) : part.max_y;
+        any_cells = true;
+    }
+    h.generation = readers.front()->header().generation;
+
+    // k-way merge of the sorted inputs, holding one cell per input
+    std::vector<std::pair<Cell, size_t>> heads;
+    auto later = [](const std::pair<Cell, size_t>& a, const std::pair<Cell, size_t>& b) {
+        return cell_less(b.first, a.first);
+    };
+    for (size_t i = 0; i < readers.size(); i++) {
+        Cell cell;
+        if (readers[i]->next(cell)) heads.emplace_back(cell, i);
+    }
+    std::make_heap(heads.begin(), heads.end(), later);
+
+    SnapshotWriter writer(path, h);
+    uint64_t written = 0;
+    Cell last{};
+    while (!heads.empty()) {
+        std::pop_heap(heads.begin(), heads.end(), later);
+        auto [cell, i] = heads.back();
+        heads.pop_back();
+        // The same cell in several inputs is written once
+        if (written == 0 || cell_less(last, cell)) {
+            writer.add(cell);
+            last = cell;
+            ++written;
+        }
+        Cell next;
+        if (readers[i]->next(next)) {
+            heads.emplace_back(next, i);
+            std::push_heap(heads.begin(), heads.end(), later);
+        }
+    }
+    writer.finish();
+    return written;
+}
@@ -0,0 +1,189 @@
+#include "video.h"
+
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+std::vector<std::string> ffmpeg_output_args(const std::string& output_path) {
+    size_t dot = output_path.rfind('.');
+    std::string ext = dot == std::string::npos ? "" : output_path.substr(dot);
+    for (char& c : ext) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+
+    // Codecs other than GIF need even dimensions
+    if (ext == ".webm") {
+        return {"-vf", "pad=ceil(iw/2)*2:ceil(ih/2)*2", "-c:v", "libvpx-vp9",
+                "-crf", "30", "-b:v", "0"};
+    }
+    if (ext == ".gif") {
+        return {"-vf", "split[s0][s1];[s0]palettegen[p];[s1][p]paletteuse"};
+    }
+    if (ext == ".mov") {
+        return {"-vf", "pad=ceil(iw/2)*2:ceil(ih/2)*2", "-c:v", "prores_ks",
+                "-profile:v", "3", "-pix_fmt", "yuv422p10le"};
+    }
+    // MP4, also the default
+    return {"-vf", "pad=ceil(iw/2)*2:ceil(ih/2)*2", "-c:v", "libx264",
+            "-pix_fmt", "yuv420p", "-preset", "fast", "-crf", "18"};
+}
+
+VideoStream::~VideoStream() {
+    if (pid_ >= 0) {
+        (void)finish();
+    }
+}
+
+bool VideoStream::open(const std::vector<std::string>& argv, int width, int height) {
+    if (pid_ >= 0 || argv.empty() || width <= 0 || height <= 0) return false;
+
+    // Everything the child needs is built before fork(): only
+    // async-signal-safe calls are allowed between fork() and exec().
+    std::vector<std::string> args = argv;
+    std::vector<char*> child_argv;
+    for (auto& arg : args) {
+        child_argv.push_back(arg.data());
+    }
+    child_argv.push_back(nullptr);
+
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) return false;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        // Child process: the pipe becomes stdin, output goes to /dev/null
+        dup2(fds[0], STDIN_FILENO);
+        int null_fd = ::open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+        }
+        execvp(child_argv[0], child_argv.data());
+        // If execvp returns, it failed
+        _exit(127);
+    }
+
+    close(fds[0]);
+    pid_ = pid;
+    fd_ = fds[1];
+    width_ = width;
+    height_ = height;
+    closing_ = false;
+    failed_ = false;
+    writer_ = std::thread(&VideoStream::write_loop, this);
+    return true;
+}
+
+bool VideoStream::open_ffmpeg(const std::string& output_path, int fps, int width, int height) {
+    std::vector<std::string> args = {
+        "ffmpeg", "-y",
+        "-f", "rawvideo", "-pix_fmt", "rgba",
+        "-s", std::to_string(width) + "x" + std::to_string(height),
+        "-framerate", std::to_string(fps),
+        "-i", "-",
+    };
+    for (auto& arg : ffmpeg_output_args(output_path)) {
+        args.push_back(std::move(arg));
+    }
+    args.push_back(output_path);
+    return open(args, width, height);
+}
+
+bool VideoStream::write_frame(Frame& frame) {
+    if (pid_ < 0 || frame.width != width_ || frame.height != height_ ||
+        frame.pixels.size() != static_cast<size_t>(width_) * height_) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return queue_.size() < kMaxQueuedFrames || failed_; });
+    if (failed_) return false;
+
+    Frame spare;
+    if (!spare_.empty()) {
+        spare = std::move(spare_.back());
+        spare_.pop_back();
+    }
+    queue_.push_back(std::move(frame));
+    frame = std::move(spare);
+    cv_.notify_all();
+    return true;
+}
+
+bool VideoStream::finish() {
+    if (pid_ < 0) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    cv_.notify_all();
+    writer_.join();
+    close(fd_);
+    fd_ = -1;
+
+    int status = 0;
+    while (waitpid(pid_, &status, 0) < 0 && errno == EINTR) {
+    }
+    pid_ = -1;
+    queue_.clear();
+    return !failed_ && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+void VideoStream::write_loop() {
+    // A child that stops reading must fail the write with EPIPE rather than
+    // kill the whole process with SIGPIPE. The signal is blocked on this
+    // thread only, and any pending one is consumed before returning.
+    sigset_t sigpipe;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, nullptr);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [&] { return !queue_.empty() || closing_; });
+        if (queue_.empty()) break;
+
+        Frame frame = std::move(queue_.front());
+        queue_.pop_front();
+        lock.unlock();
+
+        const char* data = reinterpret_cast<const char*>(frame.pixels.data());
+        size_t left = frame.pixels.size() * sizeof(uint32_t);
+        bool ok = true;
+        while (left > 0) {
+            ssize_t written = ::write(fd_, data, left);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                ok = false;
+                break;
+            }
+            data += written;
+            left -= static_cast<size_t>(written);
+        }
+
+        lock.lock();
+        spare_.push_back(std::move(frame));
+        if (!ok) {
+            failed_ = true;
+            queue_.clear();
+            cv_.notify_all();
+            break;
+        }
+        cv_.notify_all();
+    }
+    lock.unlock();
+
+    timespec no_wait = {0, 0};
+    while (sigtimedwait(&sigpipe, nullptr, &no_wait) > 0) {
+    }
+}
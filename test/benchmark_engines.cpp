@@ -1,47 +1,142 @@
-// Comparative benchmark for all simulation engines
-// Compile: make benchmark-engines
+// Benchmark suite for the simulation engines, parsing, output and rendering.
+// Every case runs repeated trials and reports percentiles, peak heap, peak RSS
+// and allocation counts; results can be saved as JSON and compared against a
+// saved baseline to catch regressions.
+// Compile: make benchmark-engines (pass options with BENCH_ARGS="...")
 
 #include <iostream>
+#include <atomic>
 #include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
 #include <random>
+#include <sstream>
 #include <vector>
 #include <string>
 #include <iomanip>
 #include <algorithm>
+#include <limits>
+#include <filesystem>
+#include <fcntl.h>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <unistd.h>
 #include "game_of_life.h"
 #include "engine.h"
-
-struct BenchmarkResult {
-    std::string engine_name;
-    std::string pattern_name;
-    size_t cells;
-    int iterations;
-    double total_ms;
-    double per_tick_us;
+#include "parallel.h"
+#include "renderer.h"
+
+// --- Allocation tracking ---
+//
+// The global operator new/delete are replaced to count allocations and the
+// live heap while a case's memory run is tracked. Timed trials run with
+// tracking off, so they only pay for one relaxed load per allocation.
+//
+// Every block carries a header in front of it holding the offset back to
+// the malloc'd pointer and the bytes it was counted with (0 if it was
+// allocated untracked), so freeing a block only subtracts what its own
+// allocation added, whether or not tracking is on at the time.
+
+namespace {
+
+std::atomic<bool> g_tracking{false};
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<int64_t> g_live_bytes{0};
+std::atomic<int64_t> g_peak_bytes{0};
+
+struct BlockHeader {
+    size_t offset;   // block - malloc'd pointer
+    int64_t counted; // bytes added to g_live_bytes
 };
 
-struct PatternSpec {
-    std::string name;
-    CellSet cells;
-    int ticks;
-};
+constexpr size_t kHeaderBytes = 2 * sizeof(BlockHeader);
+static_assert(kHeaderBytes >= alignof(std::max_align_t), "Header must keep blocks aligned");
+
+inline BlockHeader* header_of(void* p) noexcept {
+    return static_cast<BlockHeader*>(p) - 1;
+}
 
-const char* engine_name(EngineType t) {
-    switch (t) {
-        case EngineType::Hashtable: return "hashtable";
-        case EngineType::Sorted:    return "sorted";
-        case EngineType::Hashlife:  return "hashlife";
+int64_t note_alloc(size_t size) {
+    if (!g_tracking.load(std::memory_order_relaxed)) return 0;
+    auto bytes = static_cast<int64_t>(size);
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    int64_t live = g_live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int64_t peak = g_peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak &&
+           !g_peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
     }
-    return "unknown";
+    return bytes;
+}
+
+void* tracked_alloc(size_t size, size_t alignment) {
+    size_t offset = std::max(kHeaderBytes, alignment);
+    void* base = alignment <= alignof(std::max_align_t)
+                     ? std::malloc(offset + size)
+                     : std::aligned_alloc(alignment, (offset + size + alignment - 1) / alignment * alignment);
+    if (base == nullptr) throw std::bad_alloc();
+    void* p = static_cast<char*>(base) + offset;
+    *header_of(p) = {offset, note_alloc(size)};
+    return p;
 }
 
+void tracked_free(void* p) noexcept {
+    if (p == nullptr) return;
+    BlockHeader header = *header_of(p);
+    if (header.counted != 0) g_live_bytes.fetch_sub(header.counted, std::memory_order_relaxed);
+    std::free(static_cast<char*>(p) - header.offset);
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return tracked_alloc(size, 0); }
+void* operator new(size_t size, std::align_val_t al) {
+    return tracked_alloc(size, static_cast<size_t>(al));
+}
+void operator delete(void* p) noexcept { tracked_free(p); }
+void operator delete(void* p, size_t) noexcept { tracked_free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { tracked_free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { tracked_free(p); }
+
+namespace {
+
+// Linux: writing 5 to clear_refs resets the VmHWM high-water mark to the
+// current RSS, so each case's peak is its own. Heap freed by earlier cases
+// is returned to the system first, or it would count towards every later one.
+void reset_peak_rss() {
+    malloc_trim(0);
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+uint64_t peak_rss_kb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) return std::strtoull(line.c_str() + 6, nullptr, 10);
+    }
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_maxrss);
+}
+
+// Case names are lowercase; --filter is matched against them in lowercase
+std::string lowercase(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+// --- Patterns ---
+
 CellSet generate_random_soup(int64_t size, uint64_t seed) {
     std::mt19937_64 rng(seed);
     std::uniform_int_distribution<int64_t> dist(-size/2, size/2);
 
     CellSet cells;
-    int target = static_cast<int>(size * size * 0.3);
-    for (int i = 0; i < target; i++) {
+    int64_t target = size * size * 3 / 10;
+    for (int64_t i = 0; i < target; i++) {
         cells.insert({dist(rng), dist(rng)});
     }
     return cells;
@@ -77,38 +172,223 @@ CellSet generate_gliders(int count) {
     return cells;
 }
 
-BenchmarkResult run_engine_benchmark(EngineType engine, const std::string& pattern_name,
-                                      const CellSet& initial_cells, int ticks) {
-    GameOfLife game(initial_cells, engine);
+// Gliders scattered over most of the int64_t plane (HashLife's cluster path)
+CellSet generate_spread_gliders(int count, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int64_t> dist(std::numeric_limits<int64_t>::min() / 2,
+                                                std::numeric_limits<int64_t>::max() / 2);
+    CellSet cells;
+    for (int i = 0; i < count; i++) {
+        int64_t ox = dist(rng);
+        int64_t oy = dist(rng);
+        cells.insert({ox + 0, oy + 1});
+        cells.insert({ox + 1, oy + 2});
+        cells.insert({ox + 2, oy + 0});
+        cells.insert({ox + 2, oy + 1});
+        cells.insert({ox + 2, oy + 2});
+    }
+    return cells;
+}
+
+struct PatternSpec {
+    std::string name;
+    CellSet cells;
+    int ticks;
+};
+
+const std::vector<EngineType> kEngines = {EngineType::Hashtable, EngineType::Sorted,
+                                          EngineType::Hashlife,  EngineType::HashlifeFast,
+                                          EngineType::Tiled,     EngineType::Auto};
+
+// --- Measurement ---
+
+struct Options {
+    int trials = 5;
+    bool quick = false;
+    std::string filter;
+    std::string json_path;
+    std::string compare_path;
+    double threshold = 10.0;  // percent
+};
+
+// One benchmark case: `work` units (ticks, frames, bytes) per trial on
+// `cells` live cells. Times are per trial, in nanoseconds.
+struct CaseResult {
+    std::string name;
+    size_t cells = 0;
+    uint64_t work = 0;
+    std::vector<uint64_t> samples;
+    uint64_t peak_heap_bytes = 0;
+    uint64_t peak_rss_kb = 0;
+    uint64_t allocations = 0;
+
+    // Nearest-rank percentile of the sorted samples
+    uint64_t percentile(double p) const {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+        return samples[std::max<size_t>(rank, 1) - 1];
+    }
+    uint64_t median() const { return percentile(50); }
+};
+
+template <typename Fn>
+uint64_t elapsed_ns(Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+            .count());
+}
+
+// A trial sets up untimed state, times the work, and returns the time
+using Trial = std::function<uint64_t()>;
+
+// Trials this slow are long enough that 3 of them give a stable median
+constexpr uint64_t kLongTrialNs = 2'000'000'000;
+
+class Suite {
+public:
+    explicit Suite(const Options& options) : options_(options) {}
+
+    // Run one warmup, options.trials timed trials (at most 3 if the warmup
+    // took over kLongTrialNs) and one tracked trial for memory and
+    // allocations. Skipped unless the name matches --filter.
+    void run(const std::string& name, size_t cells, uint64_t work, const Trial& trial) {
+        if (!options_.filter.empty() && name.find(options_.filter) == std::string::npos) return;
 
-    // Warmup: 3 ticks
-    GameOfLife warmup(initial_cells, engine);
-    for (int i = 0; i < 3; i++) warmup.tick();
+        CaseResult result{name, cells, work, {}, 0, 0, 0};
+        int trials = trial() > kLongTrialNs ? std::min(options_.trials, 3) : options_.trials;
+        for (int i = 0; i < trials; i++) {
+            result.samples.push_back(trial());
+        }
+        std::sort(result.samples.begin(), result.samples.end());
+
+        reset_peak_rss();
+        g_allocations = 0;
+        g_live_bytes = 0;
+        g_peak_bytes = 0;
+        g_tracking = true;
+        trial();
+        g_tracking = false;
+        result.allocations = g_allocations;
+        result.peak_heap_bytes = static_cast<uint64_t>(g_peak_bytes.load());
+        result.peak_rss_kb = peak_rss_kb();
+
+        print(result);
+        results_.push_back(std::move(result));
+    }
 
-    // Timed run
-    auto start = std::chrono::high_resolution_clock::now();
-    for (int i = 0; i < ticks; i++) {
-        game.tick();
+    void section(const std::string& title) const {
+        std::cout << "\n--- " << title << " ---\n";
+        std::cout << std::setw(46) << std::left << "Case" << std::setw(10) << std::right << "Cells"
+                  << std::setw(7) << "Work" << std::setw(12) << "Median ms" << std::setw(11)
+                  << "p90 ms" << std::setw(12) << "us/unit" << std::setw(11) << "Heap MB"
+                  << std::setw(10) << "RSS MB" << std::setw(10) << "Allocs" << "\n";
     }
-    auto end = std::chrono::high_resolution_clock::now();
 
-    double total_ms = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
-    double per_tick_us = (total_ms * 1000.0) / ticks;
+    const std::vector<CaseResult>& results() const noexcept { return results_; }
 
-    return {engine_name(engine), pattern_name, initial_cells.size(), ticks, total_ms, per_tick_us};
+private:
+    const Options& options_;
+    std::vector<CaseResult> results_;
+
+    static void print(const CaseResult& r) {
+        std::cout << std::setw(46) << std::left << r.name << std::setw(10) << std::right << r.cells
+                  << std::setw(7) << r.work << std::fixed << std::setprecision(2) << std::setw(12)
+                  << r.median() / 1e6 << std::setw(11) << r.percentile(90) / 1e6 << std::setw(12)
+                  << r.median() / 1e3 / static_cast<double>(std::max<uint64_t>(r.work, 1))
+                  << std::setprecision(1) << std::setw(11) << r.peak_heap_bytes / 1048576.0
+                  << std::setw(10) << r.peak_rss_kb / 1024.0 << std::setw(10) << r.allocations
+                  << "\n";
+    }
+};
+
+// --- JSON ---
+//
+// One result object per line. The reader below only understands what
+// write_json() produces: it pairs each "name" with the "median_ns" after it.
+
+void write_json(std::ostream& out, const Options& options, const std::vector<CaseResult>& results) {
+    out << "{\n  \"version\": 1,\n  \"trials\": " << options.trials
+        << ",\n  \"hardware_threads\": " << hardware_threads() << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const CaseResult& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"cells\": " << r.cells
+            << ", \"work\": " << r.work << ", \"trials\": " << r.samples.size()
+            << ", \"min_ns\": " << r.samples.front() << ", \"median_ns\": " << r.median()
+            << ", \"p90_ns\": " << r.percentile(90) << ", \"max_ns\": " << r.samples.back()
+            << ", \"peak_heap_bytes\": " << r.peak_heap_bytes
+            << ", \"peak_rss_kb\": " << r.peak_rss_kb << ", \"allocations\": " << r.allocations
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
 }
 
-bool verify_correctness(const std::string& pattern_name, const CellSet& initial_cells, int ticks) {
-    // Run all three engines and verify they produce identical results
-    std::vector<EngineType> engines = {EngineType::Hashtable, EngineType::Sorted, EngineType::Hashlife};
+std::vector<std::pair<std::string, uint64_t>> read_baseline(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot open baseline '" + path + "'");
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+
+    std::vector<std::pair<std::string, uint64_t>> medians;
+    const std::string name_key = "\"name\": \"";
+    const std::string median_key = "\"median_ns\": ";
+    size_t pos = 0;
+    while ((pos = text.find(name_key, pos)) != std::string::npos) {
+        size_t start = pos + name_key.size();
+        size_t end = text.find('"', start);
+        size_t median = text.find(median_key, end);
+        size_t close = text.find('}', end);
+        if (end == std::string::npos || median == std::string::npos || median > close) {
+            throw std::runtime_error("Malformed baseline '" + path + "'");
+        }
+        medians.emplace_back(text.substr(start, end - start),
+                             std::strtoull(text.c_str() + median + median_key.size(), nullptr, 10));
+        pos = close;
+    }
+    return medians;
+}
 
-    // Collect results
+// Cases faster than this are all noise; they are reported but never fail
+constexpr uint64_t kCompareFloorNs = 200'000;
+
+// Compare medians with the baseline's; returns false if any case is more
+// than options.threshold percent slower
+bool compare_with_baseline(const Options& options, const std::vector<CaseResult>& results) {
+    auto baseline = read_baseline(options.compare_path);
+    std::cout << "\n=== Comparison with " << options.compare_path << " (threshold "
+              << options.threshold << "%) ===\n";
+    bool ok = true;
+    size_t compared = 0;
+    for (const auto& r : results) {
+        auto it = std::find_if(baseline.begin(), baseline.end(),
+                               [&](const auto& b) { return b.first == r.name; });
+        if (it == baseline.end() || it->second == 0) continue;
+        ++compared;
+        double change = (static_cast<double>(r.median()) / it->second - 1.0) * 100.0;
+        bool regressed = change > options.threshold && std::max(r.median(), it->second) >= kCompareFloorNs;
+        if (regressed) ok = false;
+        if (regressed || std::abs(change) > options.threshold) {
+            std::cout << "  " << (regressed ? "REGRESSION " : (change > 0 ? "slower     " : "faster     "))
+                      << std::setw(46) << std::left << r.name << std::right << std::fixed
+                      << std::setprecision(2) << std::setw(10) << it->second / 1e6 << " ms -> "
+                      << std::setw(10) << r.median() / 1e6 << " ms  (" << std::showpos
+                      << std::setprecision(1) << change << "%" << std::noshowpos << ")\n";
+        }
+    }
+    std::cout << "  " << compared << " cases compared, "
+              << (ok ? "no regressions" : "REGRESSIONS FOUND") << "\n";
+    return ok;
+}
+
+// --- Correctness ---
+
+bool verify_correctness(const std::string& pattern_name, const CellSet& initial_cells, int ticks) {
+    // Run all engines and verify they produce identical results
     std::vector<CellSet> results;
-    for (auto engine : engines) {
+    for (auto engine : kEngines) {
         GameOfLife game(initial_cells, engine);
-        for (int i = 0; i < ticks; i++) {
-            game.tick();
-        }
+        game.run(ticks);
         results.push_back(game.cells());
     }
 
@@ -117,9 +397,9 @@ bool verify_correctness(const std::string& pattern_name, const CellSet& initial_
     for (size_t i = 1; i < results.size(); i++) {
         if (results[i] != results[0]) {
             std::cerr << "  MISMATCH: " << pattern_name << " - "
-                      << engine_name(engines[i]) << " differs from hashtable after "
+                      << engine_type_name(kEngines[i]) << " differs from hashtable after "
                       << ticks << " ticks (hashtable: " << results[0].size()
-                      << " cells, " << engine_name(engines[i]) << ": "
+                      << " cells, " << engine_type_name(kEngines[i]) << ": "
                       << results[i].size() << " cells)\n";
             all_match = false;
         }
@@ -127,34 +407,92 @@ bool verify_correctness(const std::string& pattern_name, const CellSet& initial_
     return all_match;
 }
 
-int main() {
-    std::cout << "=== Comparative Engine Benchmark ===\n\n";
-
-    // Define patterns
-    std::vector<PatternSpec> patterns;
+// --- Cases ---
 
-    // R-pentomino
-    patterns.push_back({"R-pentomino", {{1, 0}, {2, 0}, {0, 1}, {1, 1}, {1, 2}}, 200});
-
-    // Acorn
-    patterns.push_back({"Acorn", {{0, 0}, {1, 0}, {1, 2}, {3, 1}, {4, 0}, {5, 0}, {6, 0}}, 500});
+Trial tick_trial(const CellSet& cells, EngineType engine, uint64_t ticks, unsigned threads = 1) {
+    return [&cells, engine, ticks, threads] {
+        GameOfLife game(cells, engine);
+        game.set_threads(threads);
+        // Through advance(), as the CLI does
+        return elapsed_ns([&] { game.run(static_cast<int64_t>(ticks)); });
+    };
+}
 
-    // 10 gliders
-    patterns.push_back({"10 gliders", generate_gliders(10), 200});
+// Sweeps run about this many cell-generations per trial
+constexpr uint64_t kSweepWork = 2'000'000;
 
-    // Soup 50x50
-    patterns.push_back({"Soup 50x50", generate_random_soup(50, 12345), 100});
+uint64_t sweep_ticks(size_t cells) {
+    return std::clamp<uint64_t>(kSweepWork / std::max<size_t>(cells, 1), 1, 100);
+}
 
-    // Soup 100x100
-    patterns.push_back({"Soup 100x100", generate_random_soup(100, 12345), 50});
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [OPTIONS]\n"
+              << "\n"
+              << "Options:\n"
+              << "  --trials N         Timed trials per case (default: 5)\n"
+              << "  --quick            Smaller sweeps, 3 trials\n"
+              << "  --filter TEXT      Only run cases whose name contains TEXT (any case)\n"
+              << "  --json FILE        Write the results as JSON to FILE\n"
+              << "  --compare FILE     Compare medians with a JSON baseline; exit 1 if any\n"
+              << "                     case is more than --threshold percent slower\n"
+              << "  --threshold PCT    Allowed slowdown for --compare (default: 10)\n"
+              << "  -h, --help         Show this help message\n";
+}
 
-    // Soup 200x200
-    patterns.push_back({"Soup 200x200", generate_random_soup(200, 12345), 20});
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    bool trials_given = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (arg == "--quick") {
+            options.quick = true;
+        } else if (arg == "--trials" && has_value) {
+            options.trials = std::atoi(argv[++i]);
+            trials_given = true;
+            if (options.trials < 1) {
+                std::cerr << "Error: --trials must be a positive integer\n";
+                return 2;
+            }
+        } else if (arg == "--filter" && has_value) {
+            options.filter = lowercase(argv[++i]);
+        } else if (arg == "--json" && has_value) {
+            options.json_path = argv[++i];
+        } else if (arg == "--compare" && has_value) {
+            options.compare_path = argv[++i];
+        } else if (arg == "--threshold" && has_value) {
+            options.threshold = std::atof(argv[++i]);
+            if (options.threshold <= 0) {
+                std::cerr << "Error: --threshold must be a positive percentage\n";
+                return 2;
+            }
+        } else {
+            std::cerr << "Error: Unknown or incomplete option '" << arg << "'\n";
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.quick && !trials_given) options.trials = 3;
 
-    // Block grid 50x50
-    patterns.push_back({"Block grid 50x50", generate_block_grid(50), 100});
+    std::cout << "=== Engine Benchmark Suite (" << options.trials << " trials per case) ===\n\n";
 
-    // === Phase 1: Correctness Check ===
+    // Define patterns
+    std::vector<PatternSpec> patterns;
+    patterns.push_back({"r-pentomino", {{1, 0}, {2, 0}, {0, 1}, {1, 1}, {1, 2}}, 200});
+    patterns.push_back({"acorn", {{0, 0}, {1, 0}, {1, 2}, {3, 1}, {4, 0}, {5, 0}, {6, 0}}, 500});
+    patterns.push_back({"gliders-10", generate_gliders(10), 200});
+    patterns.push_back({"spread-gliders-10000", generate_spread_gliders(10000, 99), 20});
+    patterns.push_back({"soup-50", generate_random_soup(50, 12345), 100});
+    patterns.push_back({"soup-100", generate_random_soup(100, 12345), 50});
+    patterns.push_back({"soup-200", generate_random_soup(200, 12345), 20});
+    patterns.push_back({"block-grid-50", generate_block_grid(50), 100});
+
+    // === Correctness Check ===
     std::cout << "--- Correctness Check (10 ticks per pattern) ---\n";
     bool all_correct = true;
     for (const auto& p : patterns) {
@@ -163,59 +501,176 @@ int main() {
                   << " (" << p.cells.size() << " cells)\n";
         if (!ok) all_correct = false;
     }
-
     if (!all_correct) {
-        std::cerr << "\nCORRECTNESS CHECK FAILED - benchmark results may be unreliable\n\n";
-    } else {
-        std::cout << "\nAll engines produce identical results.\n\n";
+        std::cerr << "\nCORRECTNESS CHECK FAILED - benchmark results may be unreliable\n";
     }
 
-    // === Phase 2: Timed Benchmarks ===
-    std::cout << "--- Performance Benchmarks ---\n\n";
-
-    std::vector<EngineType> engines = {EngineType::Hashtable, EngineType::Sorted, EngineType::Hashlife};
-    std::vector<BenchmarkResult> results;
+    Suite suite(options);
 
+    // === Patterns: every engine, fixed tick counts ===
+    suite.section("Ticks per pattern");
     for (const auto& p : patterns) {
-        std::cout << p.name << " (" << p.cells.size() << " cells, " << p.ticks << " ticks):\n";
-        for (auto engine : engines) {
-            auto r = run_engine_benchmark(engine, p.name, p.cells, p.ticks);
-            results.push_back(r);
-            std::cout << "  " << std::setw(12) << std::left << r.engine_name
-                      << std::setw(10) << std::right << std::fixed << std::setprecision(1)
-                      << r.total_ms << " ms  ("
-                      << std::setw(8) << std::setprecision(1) << r.per_tick_us << " us/tick)\n";
+        for (auto engine : kEngines) {
+            suite.run("tick/" + p.name + "/" + engine_type_name(engine), p.cells.size(),
+                      static_cast<uint64_t>(p.ticks),
+                      tick_trial(p.cells, engine, static_cast<uint64_t>(p.ticks)));
         }
-        std::cout << "\n";
     }
 
-    // === Summary Table ===
-    std::cout << "=== Summary ===\n";
-    std::cout << std::setw(20) << std::left << "Pattern"
-              << std::setw(8) << std::right << "Cells"
-              << std::setw(7) << "Ticks"
-              << std::setw(14) << "hashtable"
-              << std::setw(14) << "sorted"
-              << std::setw(14) << "hashlife" << "\n";
-    std::cout << std::string(77, '-') << "\n";
+    // === Size sweeps: ticks scaled to keep each trial near kSweepWork ===
+    std::vector<int64_t> soup_sides = {50, 100, 200, 500, 1000, 2000, 5000};
+    std::vector<int> glider_counts = {10, 100, 1000, 10000, 100000};
+    if (options.quick) {
+        soup_sides = {50, 200, 1000};
+        glider_counts = {10, 1000, 10000};
+    }
+    suite.section("Soup sweep (30% density, side N)");
+    std::vector<std::pair<int64_t, CellSet>> soups;
+    for (int64_t side : soup_sides) {
+        CellSet soup = generate_random_soup(side, 12345);
+        for (auto engine : kEngines) {
+            suite.run("sweep/soup-" + std::to_string(side) + "/" + engine_type_name(engine),
+                      soup.size(), sweep_ticks(soup.size()),
+                      tick_trial(soup, engine, sweep_ticks(soup.size())));
+        }
+        if (side == 200 || side == 1000 || side == 5000) soups.emplace_back(side, std::move(soup));
+    }
+    suite.section("Glider sweep (N gliders on a diagonal)");
+    CellSet render_gliders;
+    for (int count : glider_counts) {
+        CellSet gliders = generate_gliders(count);
+        for (auto engine : kEngines) {
+            suite.run("sweep/gliders-" + std::to_string(count) + "/" + engine_type_name(engine),
+                      gliders.size(), sweep_ticks(gliders.size()),
+                      tick_trial(gliders, engine, sweep_ticks(gliders.size())));
+        }
+        if (count == 10000) render_gliders = std::move(gliders);
+    }
 
-    for (const auto& p : patterns) {
-        std::cout << std::setw(20) << std::left << p.name
-                  << std::setw(8) << std::right << p.cells.size()
-                  << std::setw(7) << p.ticks;
-
-        for (auto engine : engines) {
-            for (const auto& r : results) {
-                if (r.pattern_name == p.name && r.engine_name == engine_name(engine)) {
-                    std::cout << std::setw(11) << std::fixed << std::setprecision(1)
-                              << r.total_ms << " ms";
-                    break;
-                }
+    // === Thread scaling: engines with a parallel tick ===
+    suite.section("Thread scaling (soup-500, 10 ticks)");
+    CellSet big_soup = generate_random_soup(500, 12345);
+    GameOfLife serial_ref(big_soup);
+    serial_ref.run(10);
+    std::vector<unsigned> thread_counts = {1, 2, 4, 8};
+    if (std::find(thread_counts.begin(), thread_counts.end(), hardware_threads()) == thread_counts.end()) {
+        thread_counts.push_back(hardware_threads());
+    }
+    for (auto engine : {EngineType::Hashtable, EngineType::Sorted}) {
+        for (unsigned threads : thread_counts) {
+            GameOfLife check(big_soup, engine);
+            check.set_threads(threads);
+            check.run(10);
+            if (check.cells() != serial_ref.cells()) {
+                std::cerr << "  MISMATCH: " << engine_type_name(engine) << " on " << threads
+                          << " threads differs from serial\n";
+                all_correct = false;
             }
+            suite.run("threads/soup-500/" + std::string(engine_type_name(engine)) + "/t" +
+                          std::to_string(threads),
+                      big_soup.size(), 10, tick_trial(big_soup, engine, 10, threads));
+        }
+    }
+
+    // === Parsing and output: work is the size of the Life 1.06 text in KiB ===
+    suite.section("Parsing and output (work = KiB of Life 1.06 text)");
+    auto temp_path = std::filesystem::temp_directory_path() /
+                     ("benchmark_engines_" + std::to_string(getpid()) + ".life");
+    int null_fd = open("/dev/null", O_WRONLY);
+    std::ofstream null_stream("/dev/null");
+    for (const auto& [side, soup] : soups) {
+        if (side > 1000 && options.quick) continue;
+        const CellSet& cells = soup;
+        GameOfLife game(cells);
+        std::string life_text = game.format();
+        std::ostringstream rle;
+        game.write_rle(rle);
+        std::string rle_text = rle.str();
+        std::ofstream(temp_path) << life_text;
+        uint64_t kib = life_text.size() / 1024;
+        std::string suffix = "/soup-" + std::to_string(side);
+        unsigned threads = hardware_threads();
+
+        suite.run("parse/life" + suffix, cells.size(), kib, [&] {
+            return elapsed_ns([&] { (void)GameOfLife::parse(life_text); });
+        });
+        suite.run("parse/life-file" + suffix, cells.size(), kib, [&] {
+            return elapsed_ns([&] { (void)GameOfLife::parse_file(temp_path.string(), EngineType::Hashtable, 1); });
+        });
+        if (threads > 1) {
+            suite.run("parse/life-file" + suffix + "/t" + std::to_string(threads), cells.size(), kib, [&] {
+                return elapsed_ns([&] {
+                    (void)GameOfLife::parse_file(temp_path.string(), EngineType::Hashtable, threads);
+                });
+            });
+        }
+        suite.run("parse/rle" + suffix, cells.size(), kib, [&] {
+            return elapsed_ns([&] {
+                std::istringstream in(rle_text);
+                (void)GameOfLife::parse_rle(in);
+            });
+        });
+        suite.run("write/life" + suffix, cells.size(), kib,
+                  [&] { return elapsed_ns([&] { game.write_fd(null_fd); }); });
+        suite.run("write/life-sorted" + suffix, cells.size(), kib,
+                  [&] { return elapsed_ns([&] { game.write_fd(null_fd, true); }); });
+        suite.run("write/rle" + suffix, cells.size(), kib,
+                  [&] { return elapsed_ns([&] { game.write_rle(null_stream); }); });
+    }
+    close(null_fd);
+    std::filesystem::remove(temp_path);
+
+    // === Rendering: work is frames; downsampled frames shade 2^k blocks ===
+    suite.section("Rendering (work = frames)");
+    constexpr int kFrames = 10;
+    auto render_trial = [&](const CellSet& cells, EngineType engine) -> Trial {
+        return [&cells, engine] {
+            GameOfLife game(cells, engine);
+            game.tick();  // so engines with a spatial index hold the generation
+            auto box = game.bounding_box();
+            RenderConfig config;
+            config.cell_size = 1;
+            FrameRenderer renderer(config, box->min_x, box->max_x, box->min_y, box->max_y);
+            Frame frame;
+            return elapsed_ns([&] {
+                for (int i = 0; i < kFrames; i++) {
+                    renderer.render(game, frame);
+                }
+            });
+        };
+    };
+    for (const auto& [side, soup] : soups) {
+        if (side > 1000) continue;
+        suite.run("render/soup-" + std::to_string(side) + "/hashtable", soup.size(), kFrames,
+                  render_trial(soup, EngineType::Hashtable));
+    }
+    if (!render_gliders.empty()) {
+        for (auto engine : {EngineType::Hashtable, EngineType::Hashlife, EngineType::Tiled}) {
+            suite.run("render/downsampled-gliders-10000/" + std::string(engine_type_name(engine)),
+                      render_gliders.size(), kFrames, render_trial(render_gliders, engine));
+        }
+    }
+
+    bool ok = all_correct;
+    if (!options.json_path.empty()) {
+        std::ofstream out(options.json_path);
+        write_json(out, options, suite.results());
+        if (!out) {
+            std::cerr << "Error: Cannot write '" << options.json_path << "'\n";
+            ok = false;
+        } else {
+            std::cout << "\nResults written to " << options.json_path << "\n";
+        }
+    }
+    if (!options.compare_path.empty()) {
+        try {
+            ok = compare_with_baseline(options, suite.results()) && ok;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            ok = false;
         }
-        std::cout << "\n";
     }
 
     std::cout << "\n=== Benchmark Complete ===\n";
-    return all_correct ? 0 : 1;
+    return ok ? 0 : 1;
 }
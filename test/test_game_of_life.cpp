@@ -1,6 +1,9 @@
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <sstream>
 #include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <limits>
@@ -8,9 +11,17 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <filesystem>
+#include <fstream>
+#include <thread>
 #include <unistd.h>
 #include "game_of_life.h"
+#include "engine.h"
+#include "parallel.h"
 #include "renderer.h"
+#include "snapshot.h"
+#include "distributed.h"
+#include "delta_stream.h"
+#include "video.h"
 
 namespace fs = std::filesystem;
 
@@ -152,6 +163,211 @@ bool test_empty_with_header() {
     return true;
 }
 
+bool test_parse_file_matches_stream() {
+    std::string path = "/tmp/life_test_parse_" + std::to_string(getpid()) + ".life";
+
+    // Several MiB so the parallel parser cuts it into chunks; blank lines,
+    // CRLF endings and indentation along the way
+    std::string content = "\n  \r\n#Life 1.06\r\n";
+    for (int64_t i = 0; i < 300000; i++) {
+        content += std::to_string(i * 7919 - 1000000) + " " + std::to_string(-i) +
+                   (i % 3 == 0 ? "\r\n" : (i % 3 == 1 ? "\n\n" : "\t \n"));
+    }
+    content += "\t9223372036854775807 -9223372036854775808";  // no final newline
+    {
+        std::ofstream out(path);
+        out << content;
+    }
+    GameOfLife expected = GameOfLife::parse(content);
+    GameOfLife serial = GameOfLife::parse_file(path);
+    GameOfLife parallel = GameOfLife::parse_file(path, EngineType::Hashtable, 4);
+    TEST_ASSERT(serial.cells() == expected.cells(), "parse_file should match parse");
+    TEST_ASSERT(parallel.cells() == expected.cells(), "Parallel parse_file should match parse");
+
+    // The first bad line wins, even when a later chunk also fails
+    std::string bad = content.substr(0, content.size() / 2) + "\n12 x\n" +
+                      content.substr(content.size() / 2) + "\n1 2 3\n";
+    {
+        std::ofstream out(path);
+        out << bad;
+    }
+    std::string message;
+    try {
+        (void)GameOfLife::parse_file(path, EngineType::Hashtable, 4);
+    } catch (const std::runtime_error& e) {
+        message = e.what();
+    }
+    TEST_ASSERT(message.find("malformed coordinate line '12 x'") != std::string::npos,
+                "Should report the first malformed line, got: " << message);
+
+    {
+        std::ofstream out(path);
+        out << "\n\n0 1\n";
+    }
+    message.clear();
+    try {
+        (void)GameOfLife::parse_file(path);
+    } catch (const std::runtime_error& e) {
+        message = e.what();
+    }
+    TEST_ASSERT(message.find("header") != std::string::npos, "Should reject a missing header");
+
+    std::remove(path.c_str());
+    message.clear();
+    try {
+        (void)GameOfLife::parse_file(path);
+    } catch (const std::runtime_error& e) {
+        message = e.what();
+    }
+    TEST_ASSERT(message.find("Cannot open") != std::string::npos, "Should reject a missing file");
+    return true;
+}
+
+bool test_snapshot_round_trip() {
+    std::string path = "/tmp/life_test_snapshot_" + std::to_string(getpid()) + ".snap";
+    constexpr int64_t kMin = std::numeric_limits<int64_t>::min();
+    constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+
+    // A soup, plus a copy with cells at the int64_t limits (no packed keys)
+    std::mt19937_64 rng(5);
+    std::uniform_int_distribution<int64_t> dist(-300, 300);
+    CellSet soup;
+    for (int i = 0; i < 20000; i++) {
+        soup.insert({dist(rng), dist(rng)});
+    }
+    CellSet extreme = soup;
+    extreme.insert({kMin, kMax});
+    extreme.insert({kMax, kMin});
+    extreme.insert({kMax, kMax});
+
+    for (const CellSet& cells : {soup, extreme, CellSet{}}) {
+        GameOfLife game(cells);
+        save_snapshot(game, path, 1234);
+        uint64_t generation = 0;
+        GameOfLife loaded = load_snapshot(path, EngineType::Tiled, generation);
+        TEST_ASSERT(generation == 1234, "Snapshot should keep the generation");
+        TEST_ASSERT(loaded.cells() == game.cells(), "Snapshot should round-trip the cells");
+    }
+
+    // A truncated file is rejected rather than loaded short
+    GameOfLife game(soup);
+    save_snapshot(game, path, 0);
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+    bool threw = false;
+    try {
+        uint64_t generation;
+        (void)load_snapshot(path, EngineType::Hashtable, generation);
+    } catch (const std::runtime_error& e) {
+        threw = std::string(e.what()).find("Invalid snapshot") != std::string::npos;
+    }
+    TEST_ASSERT(threw, "Truncated snapshot should be rejected");
+    std::remove(path.c_str());
+    return true;
+}
+
+bool test_rle_round_trip() {
+    // Glider gun with a Golly position line, comments and a wrapped body
+    std::string gun =
+        "#N Gosper glider gun\n"
+        "#CXRLE Pos=-20,-5\n"
+        "x = 36, y = 9, rule = B3/S23\n"
+        "24bo$22bobo$12b2o6b2o12b2o$11bo3bo4b2o12b2o$2o8bo5bo3b2o$2o8bo3bob2o4b\n"
+        "obo$10bo5bo7bo$11bo3bo$12b2o!\n";
+    std::istringstream in(gun);
+    GameOfLife game = GameOfLife::parse_rle(in);
+    TEST_ASSERT(game.count() == 36, "Gun should have 36 cells");
+    TEST_ASSERT(game.cells().count({-20, -1}) == 1 && game.cells().count({4, -5}) == 1,
+                "Pos should offset the pattern");
+
+    game.run(30);
+    std::ostringstream out;
+    game.write_rle(out);
+    std::istringstream back(out.str());
+    GameOfLife reloaded = GameOfLife::parse_rle(back);
+    TEST_ASSERT(reloaded.cells() == game.cells(), "RLE should round-trip: " << out.str());
+    std::string line;
+    std::istringstream lines(out.str());
+    while (std::getline(lines, line)) {
+        TEST_ASSERT(line.size() <= 70, "RLE lines should wrap at 70 characters");
+    }
+
+    std::istringstream highlife("x = 3, y = 3, rule = B36/S23\nooo!\n");
+    GameOfLife hl = GameOfLife::parse_rle(highlife);
+    TEST_ASSERT(hl.rule() == parse_rule("B36/S23"), "Header rule should become the game's rule");
+    std::ostringstream hl_out;
+    hl.write_rle(hl_out);
+    TEST_ASSERT(hl_out.str().find("rule = B36/S23") != std::string::npos,
+                "write_rle should write the game's rule");
+
+    bool threw = false;
+    try {
+        std::istringstream bad("x = 3, y = 3, rule = B03/S23\nooo!\n");
+        (void)GameOfLife::parse_rle(bad);
+    } catch (const std::runtime_error& e) {
+        threw = std::string(e.what()).find("rule") != std::string::npos;
+    }
+    TEST_ASSERT(threw, "Unsupported rule should be rejected");
+    return true;
+}
+
+bool test_macrocell_tree() {
+    // A glider in the smallest tree: one 8x8 leaf line is the root
+    std::istringstream leaf("[M2] (golly 4.0)\n#R B3/S23\n$$$$.*$..*$***$\n");
+    GameOfLife glider = GameOfLife::parse_macrocell(leaf);
+    CellSet expected = {{-3, 0}, {-2, 1}, {-4, 2}, {-3, 2}, {-2, 2}};
+    TEST_ASSERT(glider.cells() == expected, "Leaf should be centered on the origin");
+
+    // A 2^33 x 2^33 grid of blocks, one node per level: over 10^18 cells,
+    // which no CellSet could hold
+    std::string mc = "[M2] (golly 4.0)\n$$$...**$...**$\n";
+    for (int level = 4, n = 1; level <= 33; level++, n++) {
+        mc += std::to_string(level) + " " + std::to_string(n) + " " + std::to_string(n) + " " +
+              std::to_string(n) + " " + std::to_string(n) + "\n";
+    }
+    std::istringstream in(mc);
+    GameOfLife blocks = GameOfLife::parse_macrocell(in, EngineType::HashlifeFast);
+    size_t population = blocks.count();
+    TEST_ASSERT(population == (size_t(4) << (2 * 30)), "Tree population should be 4 * 4^30");
+    blocks.run(1000000);
+    TEST_ASSERT(blocks.count() == population, "Block grid should be still");
+
+    std::ostringstream out;
+    blocks.write_macrocell(out);
+    std::istringstream back(out.str());
+    GameOfLife reloaded = GameOfLife::parse_macrocell(back);
+    TEST_ASSERT(reloaded.count() == population, "Tree should round-trip without expanding");
+    TEST_ASSERT(out.str().size() < 2000, "Written tree should stay hash-consed");
+
+    // Non-tree engines get expanded cells; their output reloads the same
+    std::istringstream leaf2("[M2]\n$$$$.*$..*$***$\n");
+    GameOfLife cells = GameOfLife::parse_macrocell(leaf2, EngineType::Tiled);
+    cells.run(8);
+    std::ostringstream cells_out;
+    cells.write_macrocell(cells_out);
+    std::istringstream cells_back(cells_out.str());
+    TEST_ASSERT(GameOfLife::parse_macrocell(cells_back).cells() == cells.cells(),
+                "Cells should round-trip through a macrocell");
+
+    bool threw = false;
+    try {
+        std::istringstream bad("[M2]\n5 1 0 0 0\n");
+        (void)GameOfLife::parse_macrocell(bad);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Forward node references should be rejected");
+
+    threw = false;
+    try {
+        std::istringstream late("[M2]\n$$$...**$...**$\n#R B36/S23\n");
+        (void)GameOfLife::parse_macrocell(late);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Rule lines after the first node should be rejected");
+    return true;
+}
+
 bool test_parse_large_integers() {
     std::string input = R"(#Life 1.06
 -2000000000000 -2000000000000
@@ -554,6 +770,58 @@ bool test_write_sorted() {
     return true;
 }
 
+bool test_parallel_write() {
+    // Enough cells for several threads and rounds; the extreme corners force
+    // the merge sort fallback for sorted output
+    std::mt19937_64 rng(16);
+    CellSet cells;
+    while (cells.size() < 300000) {
+        cells.insert({static_cast<int64_t>(rng() % 4000) - 2000, static_cast<int64_t>(rng() % 4000) - 2000});
+    }
+    CellSet extreme = cells;
+    extreme.insert({std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max()});
+    extreme.insert({std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min()});
+
+    for (const CellSet& input : {cells, extreme}) {
+        GameOfLife serial(input);
+        GameOfLife game(input);
+        game.set_threads(4);
+
+        std::ostringstream expected, out;
+        serial.write(expected, true);
+        game.write(out, true);
+        TEST_ASSERT(out.str() == expected.str(), "Parallel sorted write should match serial");
+
+        std::vector<Cell> order(input.begin(), input.end());
+        std::sort(order.begin(), order.end(), [](const Cell& a, const Cell& b) {
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+        std::string reference = "#Life 1.06\n";
+        for (const auto& cell : order) {
+            reference += std::to_string(cell.x) + " " + std::to_string(cell.y) + "\n";
+        }
+        TEST_ASSERT(out.str() == reference, "Sorted output should list cells by (x, y)");
+
+        std::ostringstream unsorted;
+        game.write(unsorted);
+        TEST_ASSERT(game.format() == unsorted.str(), "format() should match write()");
+        TEST_ASSERT(GameOfLife::parse(game.format()).cells() == input, "format() should round trip");
+
+        char path[] = "/tmp/gol_write_fd_XXXXXX";
+        int fd = mkstemp(path);
+        TEST_ASSERT(fd >= 0, "Should create temp file");
+        game.write_fd(fd, true);
+        close(fd);
+        std::ifstream file(path, std::ios::binary);
+        std::string written((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::remove(path);
+        TEST_ASSERT(written == reference, "write_fd() should match the sorted stream output");
+    }
+
+    TEST_ASSERT(GameOfLife().format() == "#Life 1.06\n", "Empty game should format as a header");
+    return true;
+}
+
 bool test_sample_input() {
     std::string input = R"(#Life 1.06
 0 1
@@ -624,6 +892,1098 @@ bool test_randomized_consistency() {
     return true;
 }
 
+// ============ Engine Tests ============
+
+bool test_hashlife_retained_state() {
+    CellSet cells = {{1, 0}, {2, 0}, {0, 1}, {1, 1}, {1, 2}};  // R-pentomino
+    GameOfLife reference(cells);
+    GameOfLife game(cells, EngineType::Hashlife);
+
+    for (int i = 0; i < 30; i++) {
+        reference.tick();
+        game.tick();
+        // Reading every few ticks must not disturb the retained quadtree
+        if (i % 7 == 0) {
+            TEST_ASSERT(game.count() == reference.count(), "Retained population should match");
+            TEST_ASSERT(game.cells() == reference.cells(), "Synced cells should match reference");
+        }
+    }
+    TEST_ASSERT(game.cells() == reference.cells(), "HashLife should match hashtable after 30 ticks");
+
+    // A copy rebuilds its own tree from the synced cells
+    GameOfLife copy(game);
+    copy.tick();
+    reference.tick();
+    TEST_ASSERT(copy.cells() == reference.cells(), "Copied HashLife game should keep stepping correctly");
+    return true;
+}
+
+bool test_run_matches_ticks_all_engines() {
+    CellSet acorn = {{0, 0}, {1, 0}, {1, 2}, {3, 1}, {4, 0}, {5, 0}, {6, 0}};
+    GameOfLife reference(acorn);
+    for (int i = 0; i < 40; i++) {
+        reference.tick();
+    }
+
+    for (EngineType engine : {EngineType::Hashtable, EngineType::Sorted, EngineType::Hashlife,
+                              EngineType::HashlifeFast, EngineType::Tiled, EngineType::Auto}) {
+        GameOfLife game(acorn, engine);
+        game.run(25);
+        game.run(0);
+        game.run(15);
+        TEST_ASSERT(game.cells() == reference.cells(), "run() should match 40 individual ticks");
+    }
+    return true;
+}
+
+bool test_hashlife_fast_long_run() {
+    CellSet acorn = {{0, 0}, {1, 0}, {1, 2}, {3, 1}, {4, 0}, {5, 0}, {6, 0}};
+    GameOfLife reference(acorn);
+    GameOfLife fast(acorn, EngineType::HashlifeFast);
+    reference.run(1000);
+    fast.run(1000);  // 512 + 256 + 128 + 64 + 32 + 8
+    TEST_ASSERT(fast.cells() == reference.cells(), "Superspeed jumps should match 1000 ticks");
+
+    // A glider moves (1, 1) every 4 generations
+    CellSet glider = {{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}};
+    GameOfLife game(glider, EngineType::HashlifeFast);
+    constexpr int64_t gens = 1000000000;
+    game.run(gens);
+    CellSet expected;
+    for (const auto& cell : glider) {
+        expected.insert({cell.x + gens / 4, cell.y + gens / 4});
+    }
+    TEST_ASSERT(game.count() == 5, "Glider should keep 5 cells");
+    TEST_ASSERT(game.cells() == expected, "Glider should travel 2.5e8 cells in 1e9 generations");
+    return true;
+}
+
+bool test_tiled_matches_reference() {
+    // Random soup straddling tile boundaries (including negative tiles)
+    std::mt19937_64 rng(7);
+    std::uniform_int_distribution<int64_t> dist(-100, 100);
+    CellSet soup;
+    for (int i = 0; i < 6000; i++) {
+        soup.insert({dist(rng), dist(rng)});
+    }
+
+    GameOfLife reference(soup);
+    GameOfLife tiled(soup, EngineType::Tiled);
+    for (int i = 0; i < 20; i++) {
+        reference.tick();
+        tiled.tick();
+    }
+    TEST_ASSERT(tiled.count() == reference.count(), "Tiled population should match hashtable");
+    TEST_ASSERT(tiled.cells() == reference.cells(), "Tiled engine should match hashtable");
+
+    // Cells at the int64_t limits fall back to exact hashtable semantics
+    constexpr int64_t max_val = std::numeric_limits<int64_t>::max();
+    constexpr int64_t min_val = std::numeric_limits<int64_t>::min();
+    CellSet edge = {{max_val - 1, 0}, {max_val - 2, 0}, {max_val, 0},
+                    {min_val, min_val}, {min_val + 1, min_val}, {min_val, min_val + 1}};
+    GameOfLife edge_reference(edge);
+    GameOfLife edge_tiled(edge, EngineType::Tiled);
+    edge_reference.run(3);
+    edge_tiled.run(3);
+    TEST_ASSERT(edge_tiled.cells() == edge_reference.cells(), "Tiled engine should match at int64_t limits");
+    return true;
+}
+
+bool test_tiled_change_tracking() {
+    // Blocks and blinkers in separate tiles, plus a glider crossing tiles
+    CellSet cells;
+    for (int64_t t = 0; t < 6; t++) {
+        int64_t ox = t * 64 + 30;
+        cells.insert({ox, 10});
+        cells.insert({ox + 1, 10});
+        cells.insert({ox, 11});
+        cells.insert({ox + 1, 11});
+        cells.insert({ox, -40});
+        cells.insert({ox + 1, -40});
+        cells.insert({ox + 2, -40});
+    }
+    CellSet glider = {{-5, -4}, {-4, -3}, {-3, -5}, {-3, -4}, {-3, -3}};
+    cells.insert(glider.begin(), glider.end());
+
+    GameOfLife reference(cells);
+    GameOfLife tiled(cells, EngineType::Tiled);
+    for (int i = 0; i < 150; i++) {
+        reference.tick();
+        tiled.tick();
+        if (!(tiled.cells() == reference.cells())) {
+            TEST_ASSERT(false, "Tiled should match hashtable at generation " << (i + 1));
+        }
+    }
+
+    // Once the glider has left, only its own tiles are recomputed
+    auto counters = tiled.engine_counters();
+    TEST_ASSERT(counters.size() == 2 && counters[1].name == "Active tiles", "Tiled should report active tiles");
+    TEST_ASSERT(counters[1].value < counters[0].value, "Stable tiles should not be recomputed");
+
+    // Still life plus period-2 oscillators: run() skips whole periods
+    CellSet ash(cells);
+    for (const auto& c : glider) ash.erase(c);
+    GameOfLife ash_tiled(ash, EngineType::Tiled);
+    ash_tiled.run(1000000001);
+    GameOfLife ash_reference(ash);
+    ash_reference.tick();
+    TEST_ASSERT(ash_tiled.cells() == ash_reference.cells(), "Period-2 ash should be skipped by parity");
+    return true;
+}
+
+bool test_auto_engine() {
+    auto switched_to = [](const GameOfLife& game, const std::string& engine) {
+        for (const auto& counter : game.engine_counters()) {
+            if (counter.name == "Switched to " + engine + " at generation") return true;
+        }
+        return false;
+    };
+
+    // The R-pentomino grows into a dense blob, then settles into ash and
+    // six gliders by generation 1103
+    CellSet r_pentomino = {{1, 0}, {2, 0}, {0, 1}, {1, 1}, {1, 2}};
+    GameOfLife reference(r_pentomino, EngineType::Tiled);
+    GameOfLife game(r_pentomino, EngineType::Auto);
+    reference.run(20000);
+    game.run(20000);
+    TEST_ASSERT(game.cells() == reference.cells(), "Auto should match tiled after 20000 generations");
+    TEST_ASSERT(switched_to(game, "tiled"), "The growing blob should move to the tiled engine");
+    TEST_ASSERT(switched_to(game, "hashlife-fast"), "Settled ash should move to hashlife-fast");
+
+    // Stepped a generation at a time, nothing is ever worth leaping for
+    GameOfLife ticked(r_pentomino, EngineType::Auto);
+    GameOfLife ticked_reference(r_pentomino);
+    for (int i = 0; i < 1500; i++) {
+        ticked.tick();
+        ticked_reference.tick();
+    }
+    TEST_ASSERT(ticked.cells() == ticked_reference.cells(), "Auto ticks should match hashtable");
+    TEST_ASSERT(!switched_to(ticked, "hashlife-fast"), "Single ticks should never leap");
+
+    // Isolated gliders far apart stay on the hashtable engine
+    CellSet gliders;
+    for (int64_t i = 0; i < 50; i++) {
+        for (const auto& c : CellSet{{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}}) {
+            gliders.insert({c.x + i * 1000, c.y - i * 1000});
+        }
+    }
+    GameOfLife sparse(gliders, EngineType::Auto);
+    sparse.run(200);
+    TEST_ASSERT(sparse.engine_counters()[1].name == "Auto switches" &&
+                    sparse.engine_counters()[1].value == 0,
+                "Sparse gliders should stay on hashtable");
+
+    // Rule changes reach whichever engine is current
+    GameOfLife highlife(r_pentomino, EngineType::Auto);
+    GameOfLife highlife_reference(r_pentomino);
+    highlife.run(100);
+    highlife_reference.run(100);
+    highlife.set_rule(parse_rule("B36/S23"));
+    highlife_reference.set_rule(parse_rule("B36/S23"));
+    highlife.run(300);
+    highlife_reference.run(300);
+    TEST_ASSERT(highlife.cells() == highlife_reference.cells(), "Auto should follow rule changes");
+    return true;
+}
+
+bool test_tick_async() {
+    CellSet acorn = {{0, 0}, {1, 0}, {1, 2}, {3, 1}, {4, 0}, {5, 0}, {6, 0}};
+    for (EngineType engine : {EngineType::Hashtable, EngineType::Sorted, EngineType::Hashlife,
+                              EngineType::HashlifeFast, EngineType::Tiled, EngineType::Auto}) {
+        GameOfLife reference(acorn);
+        GameOfLife game(acorn, engine);
+        for (int i = 0; i < 60; i++) {
+            CellSet before = reference.cells();
+            auto ready = game.tick_async();
+            // Generation g stays readable, from the CellSet, while g+1 is computed
+            TEST_ASSERT(game.tick_pending(), "A tick should be pending");
+            TEST_ASSERT(game.cells() == before, "Pending game should read as the old generation");
+            TEST_ASSERT(game.count() == before.size(), "Pending count should be the old one");
+            std::vector<Cell> found;
+            game.cells_in_rect(BoundingBox{-1000, 1000, -1000, 1000}, found);
+            TEST_ASSERT(found.size() == before.size(), "Pending rect queries should see the old generation");
+            if (i % 10 == 0) {
+                GameOfLife copy(game);
+                TEST_ASSERT(copy.cells() == before, "A copy should take the visible generation");
+            }
+            ready.wait();
+            TEST_ASSERT(game.cells() == before, "A computed tick should wait for finish_tick()");
+            game.finish_tick();
+            reference.tick();
+            TEST_ASSERT(!game.tick_pending(), "finish_tick() should clear the pending tick");
+            TEST_ASSERT(game.cells() == reference.cells(), "Async ticks should match tick()");
+            auto box = game.bounding_box();
+            auto expected_box = reference.bounding_box();
+            TEST_ASSERT(box && box->min_x == expected_box->min_x && box->max_x == expected_box->max_x &&
+                            box->min_y == expected_box->min_y && box->max_y == expected_box->max_y,
+                        "Queries should see the new generation");
+        }
+
+        // Stepping calls finish a pending tick first; moves drop it
+        game.tick_async();
+        game.run(5);
+        reference.run(6);
+        TEST_ASSERT(game.cells() == reference.cells(), "run() should finish the pending tick");
+        CellSet before = game.cells();
+        game.tick_async();
+        GameOfLife moved(std::move(game));
+        TEST_ASSERT(moved.cells() == before, "A moved game should keep the visible generation");
+        moved.tick();
+        reference.tick();
+        TEST_ASSERT(moved.cells() == reference.cells(), "A moved game should keep stepping correctly");
+        moved.tick_async();  // destroyed while pending
+    }
+    return true;
+}
+
+bool test_engine_metrics() {
+    CellSet acorn = {{0, 0}, {1, 0}, {1, 2}, {3, 1}, {4, 0}, {5, 0}, {6, 0}};
+    auto metric = [](const std::vector<EngineCounter>& metrics, const std::string& name) {
+        for (const auto& m : metrics) {
+            if (m.name == name) return std::optional<uint64_t>(m.value);
+        }
+        return std::optional<uint64_t>();
+    };
+
+    // Off by default; collecting changes no results
+    for (EngineType engine : {EngineType::Hashtable, EngineType::Sorted, EngineType::Hashlife,
+                              EngineType::HashlifeFast, EngineType::Tiled, EngineType::Auto}) {
+        GameOfLife reference(acorn, engine);
+        GameOfLife game(acorn, engine);
+        reference.run(100);
+        TEST_ASSERT(reference.take_metrics().empty(), "Metrics should be off by default");
+        game.set_metrics(true);
+        game.run(50);
+        game.tick_async();
+        game.finish_tick();
+        game.run(49);
+        TEST_ASSERT(game.cells() == reference.cells(), "Metrics should not change results");
+        auto metrics = game.take_metrics();
+        TEST_ASSERT(!metrics.empty() && metrics[0].name == "step_ns", "step_ns should come first");
+        TEST_ASSERT(metric(game.take_metrics(), "step_ns") == 0u, "Taking should reset the metrics");
+    }
+
+    GameOfLife hashtable(acorn);
+    hashtable.set_metrics(true);
+    hashtable.run(10);
+    auto metrics = hashtable.take_metrics();
+    TEST_ASSERT(metric(metrics, "packed_ticks") == 10u, "Hashtable should count packed ticks");
+    TEST_ASSERT(metric(metrics, "count_entries").value_or(0) > 0, "Hashtable should count entries");
+
+    GameOfLife sorted(acorn, EngineType::Sorted);
+    sorted.set_metrics(true);
+    sorted.run(10);
+    TEST_ASSERT(metric(sorted.take_metrics(), "candidates_sorted").value_or(0) > 0,
+                "Sorted should count sorted candidates");
+
+    GameOfLife hashlife(acorn, EngineType::Hashlife);
+    hashlife.set_metrics(true);
+    hashlife.run(200);
+    metrics = hashlife.take_metrics();
+    TEST_ASSERT(metric(metrics, "memo_hits").value_or(0) > 0, "HashLife should count memo hits");
+    TEST_ASSERT(metric(metrics, "memo_misses").value_or(0) > 0, "HashLife should count memo misses");
+    TEST_ASSERT(metric(metrics, "pool_bytes").value_or(0) > 0, "HashLife should report pool bytes");
+
+    GameOfLife tiled(acorn, EngineType::Tiled);
+    tiled.set_metrics(true);
+    tiled.run(10);
+    TEST_ASSERT(metric(tiled.take_metrics(), "tiles_computed").value_or(0) >= 10,
+                "Tiled should count computed tiles");
+
+    // Switching off drops what was collected
+    hashtable.run(5);
+    hashtable.set_metrics(false);
+    TEST_ASSERT(hashtable.take_metrics().empty(), "Disabled metrics should be empty");
+    return true;
+}
+
+bool test_change_tracking() {
+    std::mt19937_64 rng(30);
+    std::uniform_int_distribution<int64_t> dist(-40, 40);
+    CellSet soup;
+    for (int i = 0; i < 2000; i++) {
+        soup.insert({dist(rng), dist(rng)});
+    }
+    auto sorted = [](const std::vector<Cell>& cells) {
+        return std::is_sorted(cells.begin(), cells.end(), [](const Cell& a, const Cell& b) {
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+    };
+
+    // Replaying the deltas must rebuild every generation taken, whatever
+    // the steps in between; apply_delta_frame() rejects any delta that
+    // doesn't fit the cells it is applied to
+    for (EngineType engine : {EngineType::Hashtable, EngineType::Sorted, EngineType::Hashlife,
+                              EngineType::HashlifeFast, EngineType::Tiled, EngineType::Auto}) {
+        GameOfLife game(soup, engine);
+        TEST_ASSERT(game.take_changes().born.empty(), "Tracking should be off by default");
+        game.set_track_changes(true);
+        CellSet replay = soup;
+        uint64_t generation = 0;
+        for (int64_t step : {1, 1, 2, 7, 64, 1, 300}) {
+            game.run(step);
+            generation += static_cast<uint64_t>(step);
+            CellDelta delta = game.take_changes();
+            TEST_ASSERT(sorted(delta.born) && sorted(delta.died), "Changes should be sorted");
+            apply_delta_frame({false, generation, delta.born, delta.died}, replay);
+            if (!(replay == game.cells())) {
+                TEST_ASSERT(false, engine_type_name(engine) << " changes should rebuild generation "
+                                                            << generation);
+            }
+        }
+
+        // Async ticks count once finished; a copy of a pending game leaves
+        // the pending tick's changes behind
+        CellSet before = replay;
+        game.tick_async();
+        TEST_ASSERT(game.take_changes().born.empty(), "A pending tick should not be taken");
+        GameOfLife copy(game);
+        game.finish_tick();
+        CellDelta delta = game.take_changes();
+        apply_delta_frame({false, ++generation, delta.born, delta.died}, replay);
+        TEST_ASSERT(replay == game.cells(), "Async ticks should be tracked");
+        copy.run(1);
+        delta = copy.take_changes();
+        apply_delta_frame({false, generation, delta.born, delta.died}, before);
+        TEST_ASSERT(before == copy.cells(), "A copy should track from the generation it reads as");
+    }
+
+    // Cycle skips are tracked too: a glider shifted by 250 cells
+    GameOfLife glider(CellSet{{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}});
+    glider.set_cycle_detection(true);
+    glider.set_track_changes(true);
+    CellSet glider_replay = glider.cells();
+    glider.run(1000);
+    CellDelta shifted = glider.take_changes();
+    apply_delta_frame({false, 1000, shifted.born, shifted.died}, glider_replay);
+    TEST_ASSERT(glider.cycle() && glider_replay == glider.cells(), "Cycle skips should be tracked");
+
+    // Parallel hashtable ticks, and the limits of the int64_t plane (the
+    // tiled engine's hashtable fallback, clustered HashLife)
+    constexpr int64_t max_val = std::numeric_limits<int64_t>::max();
+    CellSet wide = soup;
+    for (int64_t x = 0; x < 4; x++) {
+        wide.insert({max_val - 2 - x, max_val - 1});
+        wide.insert({max_val - 2 - x, max_val - 2});
+    }
+    std::uniform_int_distribution<int64_t> big(-300, 300);
+    CellSet dense;
+    for (int i = 0; i < 60000; i++) {
+        dense.insert({big(rng), big(rng)});
+    }
+    for (auto [engine, start, threads] : {std::tuple{EngineType::Hashtable, dense, 4u},
+                                          std::tuple{EngineType::Tiled, wide, 1u},
+                                          std::tuple{EngineType::Hashlife, wide, 1u}}) {
+        GameOfLife game(start, engine);
+        game.set_threads(threads);
+        game.set_track_changes(true);
+        game.run(3);
+        GameOfLife reference(start);
+        reference.run(3);
+        TEST_ASSERT(reference.cells() == game.cells(), engine_type_name(engine) << " should match the hashtable");
+        CellDelta delta = game.take_changes();
+        apply_delta_frame({false, 3, delta.born, delta.died}, start);
+        TEST_ASSERT(start == game.cells(), engine_type_name(engine) << " changes should rebuild the run");
+    }
+
+    // Only the cells that changed are held: 1000 blocks and a blinker
+    CellSet blocks = {{-10, 0}, {-10, 1}, {-10, 2}};
+    for (int64_t i = 0; i < 1000; i++) {
+        for (auto [dx, dy] : {std::pair{0, 0}, {1, 0}, {0, 1}, {1, 1}}) {
+            blocks.insert({i * 4 + dx, dy});
+        }
+    }
+    for (EngineType engine : {EngineType::Hashtable, EngineType::Sorted, EngineType::Hashlife,
+                              EngineType::Tiled}) {
+        GameOfLife game(blocks, engine);
+        game.set_track_changes(true);
+        game.tick();
+        CellDelta delta = game.take_changes();
+        TEST_ASSERT(delta.born.size() == 2 && delta.died.size() == 2, "A blinker phase should flip 4 cells");
+        game.run(2);
+        delta = game.take_changes();
+        TEST_ASSERT(delta.born.empty() && delta.died.empty(), "Changes that change back should cancel");
+        game.set_track_changes(false);
+        game.tick();
+        TEST_ASSERT(game.take_changes().born.empty(), "Disabled tracking should be empty");
+    }
+    return true;
+}
+
+bool test_delta_stream() {
+    CellSet acorn = {{0, 0}, {1, 0}, {1, 2}, {3, 1}, {4, 0}, {5, 0}, {6, 0}};
+    constexpr int64_t max_val = std::numeric_limits<int64_t>::max();
+    constexpr int64_t min_val = std::numeric_limits<int64_t>::min();
+    for (DeltaFormat format : {DeltaFormat::Text, DeltaFormat::Binary}) {
+        GameOfLife game(acorn);
+        game.set_track_changes(true);
+        std::ostringstream out;
+        DeltaWriter writer(out, format);
+        std::vector<CellSet> expected;
+        std::vector<Cell> keyframe = {{min_val, max_val}, {-1, -7}, {-1, 5}, {0, 0}, {max_val, min_val}};
+        writer.keyframe(7, keyframe);
+        expected.push_back(CellSet(keyframe.begin(), keyframe.end()));
+        std::vector<Cell> cells(acorn.begin(), acorn.end());
+        std::sort(cells.begin(), cells.end(), [](const Cell& a, const Cell& b) {
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+        writer.keyframe(0, cells);
+        expected.push_back(acorn);
+        for (int i = 1; i <= 20; i++) {
+            game.run(10);
+            writer.delta(static_cast<uint64_t>(i * 10), game.take_changes());
+            expected.push_back(game.cells());
+        }
+        TEST_ASSERT(writer.frames() == 22 && writer.keyframes() == 2, "Writer should count frames");
+        TEST_ASSERT(writer.bytes_written() == out.str().size(), "Writer should count bytes");
+
+        std::istringstream in(out.str());
+        DeltaReader reader(in);
+        TEST_ASSERT(reader.format() == format, "Reader should detect the format");
+        DeltaFrame frame;
+        CellSet state;
+        size_t frames = 0;
+        while (reader.next(frame)) {
+            TEST_ASSERT(frames < expected.size(), "Reader should stop at the end");
+            apply_delta_frame(frame, state);
+            TEST_ASSERT(state == expected[frames], "Frame " << frames << " should replay");
+            ++frames;
+        }
+        TEST_ASSERT(frames == expected.size(), "Reader should return every frame");
+        TEST_ASSERT(frame.generation == 200 && !frame.keyframe, "Last frame should be the last delta");
+
+        // Truncated streams are rejected, not silently shortened
+        std::string data = out.str();
+        std::istringstream truncated(data.substr(0, data.size() - 3));
+        DeltaReader short_reader(truncated);
+        bool threw = false;
+        try {
+            while (short_reader.next(frame)) {
+            }
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        TEST_ASSERT(threw, "A truncated stream should throw");
+    }
+
+    bool threw = false;
+    try {
+        std::istringstream in("#Life 1.06\n0 0\n");
+        DeltaReader reader(in);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "A stream without a delta header should throw");
+
+    threw = false;
+    try {
+        CellSet state = {{0, 0}};
+        apply_delta_frame({false, 1, {{0, 0}}, {}}, state);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "A birth of a live cell should not apply");
+
+    threw = false;
+    try {
+        (void)parse_delta_format("json");
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Unknown delta formats should throw");
+    return true;
+}
+
+bool test_hashlife_matches_reference_soup() {
+    // Soup straddling 4x4 leaf and 8x8 kernel boundaries on both sides of 0
+    std::mt19937_64 rng(3);
+    std::uniform_int_distribution<int64_t> dist(-37, 37);
+    CellSet soup;
+    for (int i = 0; i < 2000; i++) {
+        soup.insert({dist(rng), dist(rng)});
+    }
+
+    GameOfLife reference(soup);
+    GameOfLife hashlife(soup, EngineType::Hashlife);
+    GameOfLife fast(soup, EngineType::HashlifeFast);
+    reference.run(37);
+    hashlife.run(37);
+    fast.run(37);
+    TEST_ASSERT(hashlife.cells() == reference.cells(), "HashLife should match hashtable on a soup");
+    TEST_ASSERT(fast.cells() == reference.cells(), "HashLife superspeed should match hashtable on a soup");
+    return true;
+}
+
+bool test_hashlife_clustered_gliders() {
+    // Gliders scattered over the whole int64_t plane force the per-cluster
+    // fallback; some pairs share or touch chunks and must merge.
+    std::mt19937_64 rng(9);
+    CellSet cells;
+    auto add_glider = [&](int64_t ox, int64_t oy) {
+        cells.insert({ox + 0, oy + 1});
+        cells.insert({ox + 1, oy + 2});
+        cells.insert({ox + 2, oy + 0});
+        cells.insert({ox + 2, oy + 1});
+        cells.insert({ox + 2, oy + 2});
+    };
+    std::uniform_int_distribution<int64_t> dist(std::numeric_limits<int64_t>::min() / 2,
+                                                std::numeric_limits<int64_t>::max() / 2);
+    for (int i = 0; i < 100; i++) {
+        int64_t x = dist(rng);
+        int64_t y = dist(rng);
+        add_glider(x, y);
+        if (i % 10 == 0) add_glider(x + 66, y + 3);  // neighboring chunk
+    }
+
+    GameOfLife reference(cells);
+    GameOfLife hashlife(cells, EngineType::Hashlife);
+    for (int i = 0; i < 8; i++) {
+        reference.tick();
+        hashlife.tick();
+    }
+    TEST_ASSERT(hashlife.cells() == reference.cells(), "Clustered HashLife should match hashtable");
+    return true;
+}
+
+bool test_hashlife_memory_limit() {
+    // A 1 MiB budget is below one arena chunk, so every step collects
+    std::mt19937_64 rng(5);
+    std::uniform_int_distribution<int64_t> dist(-60, 60);
+    CellSet soup;
+    for (int i = 0; i < 4000; i++) {
+        soup.insert({dist(rng), dist(rng)});
+    }
+
+    GameOfLife reference(soup);
+    reference.run(60);
+    for (EngineType type : {EngineType::Hashlife, EngineType::HashlifeFast}) {
+        GameOfLife game(soup, type);
+        game.set_memory_limit(size_t(1) << 20);
+        for (int i = 0; i < 6; i++) {
+            game.run(10);
+        }
+        TEST_ASSERT(game.cells() == reference.cells(), "HashLife should stay correct under a tiny memory budget");
+    }
+
+    bool threw = false;
+    try {
+        reference.set_memory_limit(0);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Zero memory limit should be rejected");
+    return true;
+}
+
+bool test_sorted_radix_matches_reference() {
+    std::mt19937_64 rng(13);
+    std::uniform_int_distribution<int64_t> dist(-150, 150);
+    CellSet soup;
+    for (int i = 0; i < 30000; i++) {
+        soup.insert({dist(rng), dist(rng)});
+    }
+
+    GameOfLife reference(soup);
+    GameOfLife serial(soup, EngineType::Sorted);
+    GameOfLife parallel(soup, EngineType::Sorted);
+    parallel.set_threads(4);
+    reference.run(12);
+    serial.run(12);
+    for (int i = 0; i < 12; i++) {
+        parallel.tick();
+    }
+    TEST_ASSERT(serial.count() == reference.count(), "Retained sorted population should match");
+    TEST_ASSERT(serial.cells() == reference.cells(), "Radix-sorted engine should match hashtable");
+    TEST_ASSERT(parallel.cells() == reference.cells(), "Parallel radix sort should match hashtable");
+
+    // Extents too wide for packed keys use the comparison sort
+    constexpr int64_t max_val = std::numeric_limits<int64_t>::max();
+    constexpr int64_t min_val = std::numeric_limits<int64_t>::min();
+    CellSet wide = {{0, 0}, {1, 0}, {2, 0}, {max_val - 1, 5}, {max_val - 1, 6}, {max_val - 1, 7},
+                    {min_val, 0}, {min_val + 1, 0}, {min_val + 2, 0}};
+    GameOfLife wide_reference(wide);
+    GameOfLife wide_sorted(wide, EngineType::Sorted);
+    wide_reference.run(3);
+    wide_sorted.run(3);
+    TEST_ASSERT(wide_sorted.cells() == wide_reference.cells(), "Sorted engine should match across the int64_t range");
+    return true;
+}
+
+bool test_cycle_detection() {
+    // A glider plus a blinker: period 4 overall, shifted by the glider's (1, 1)
+    CellSet cells = {{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}, {-20, 0}, {-20, 1}, {-20, 2}};
+    GameOfLife reference(cells);
+    reference.run(20003);
+    TEST_ASSERT(!reference.cycle().has_value(), "Detection should be off by default");
+
+    // The blinker stays put while the glider moves, so there is no global cycle
+    GameOfLife detected(cells, EngineType::Tiled);
+    detected.set_cycle_detection(true);
+    detected.run(20003);
+    TEST_ASSERT(!detected.cycle().has_value(), "Mixed motion is not a global cycle");
+    TEST_ASSERT(detected.cells() == reference.cells(), "Detection must not change the result");
+
+    // A lone glider: 10^12 generations in one jump, checked against the
+    // translated short run
+    GameOfLife glider(CellSet{{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}}, EngineType::Tiled);
+    glider.set_cycle_detection(true);
+    glider.run(1000000000003);
+    TEST_ASSERT(glider.cycle().has_value(), "Glider cycle should be detected");
+    const Cycle& cycle = *glider.cycle();
+    TEST_ASSERT(cycle.period == 4 && cycle.dx == 1 && cycle.dy == 1, "Glider has period 4, shift (1, 1)");
+    GameOfLife expected(CellSet{{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}});
+    expected.run(3);
+    CellSet shifted;
+    for (const auto& c : expected.cells()) {
+        shifted.insert({c.x + 250000000000, c.y + 250000000000});
+    }
+    TEST_ASSERT(glider.cells() == shifted, "Glider should land 2.5e11 cells away");
+
+    // Later runs reuse the known cycle
+    glider.run(4);
+    TEST_ASSERT(glider.count() == 5, "Glider should survive further runs");
+    return true;
+}
+
+bool test_hashtable_threads_match_serial() {
+    // Large enough to take the parallel path; spans negative stripes
+    std::mt19937_64 rng(11);
+    std::uniform_int_distribution<int64_t> dist(-200, 200);
+    CellSet soup;
+    for (int i = 0; i < 50000; i++) {
+        soup.insert({dist(rng), dist(rng)});
+    }
+    constexpr int64_t max_val = std::numeric_limits<int64_t>::max();
+    soup.insert({max_val, 0});
+    soup.insert({max_val - 1, 0});
+    soup.insert({max_val - 2, 0});
+
+    GameOfLife serial(soup);
+    GameOfLife parallel(soup);
+    parallel.set_threads(3);
+    serial.run(10);
+    parallel.run(10);
+    TEST_ASSERT(parallel.cells() == serial.cells(), "Threaded hashtable should match serial");
+
+    GameOfLife copy = parallel;
+    copy.tick();
+    serial.tick();
+    TEST_ASSERT(copy.cells() == serial.cells(), "Copies should keep the thread count and stay correct");
+
+    // A cell at the limit counts no neighbors but keeps its state, so S0 keeps it
+    constexpr int64_t min_val = std::numeric_limits<int64_t>::min();
+    soup.insert({0, min_val});
+    CellSet edge_cells[2];
+    for (unsigned threads : {1u, 3u}) {
+        GameOfLife edge(soup);
+        edge.set_threads(threads);
+        edge.set_rule(parse_rule("B3/S023"));
+        edge.tick();
+        TEST_ASSERT(edge.cells().count({0, min_val}) == 1, "S0 should keep a cell at the limit");
+        edge_cells[threads > 1] = edge.cells();
+    }
+    TEST_ASSERT(edge_cells[0] == edge_cells[1], "Threaded S0 tick should match serial");
+
+    bool threw = false;
+    try {
+        parallel.set_threads(0);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Zero threads should be rejected");
+    return true;
+}
+
+bool test_hashtable_packed_keys() {
+    // Packed keys cover boxes that fit in 63 bits; wider universes fall back
+    // to Cell keys. Both must match the sorted engine, tick by tick.
+    std::mt19937_64 rng(22);
+    std::uniform_int_distribution<int64_t> dist(-60, 60);
+    CellSet soup;
+    for (int i = 0; i < 4000; i++) {
+        soup.insert({dist(rng), dist(rng)});
+    }
+    const int64_t far = int64_t(1) << 61;
+    for (Cell offset : {Cell{0, 0}, Cell{int64_t(1) << 40, -(int64_t(1) << 20)}, Cell{far, -far}}) {
+        CellSet cells = soup;
+        cells.insert({offset.x, offset.y + 1000});
+        cells.insert({offset.x + 1, offset.y + 1000});
+        cells.insert({offset.x + 2, offset.y + 1000});
+        GameOfLife packed(cells);
+        GameOfLife reference(cells, EngineType::Sorted);
+        for (int i = 0; i < 6; i++) {
+            packed.tick();
+            reference.tick();
+            TEST_ASSERT(packed.cells() == reference.cells(), "Hashtable should match sorted engine");
+        }
+    }
+    return true;
+}
+
+bool test_spatial_queries() {
+    constexpr int64_t kMin = std::numeric_limits<int64_t>::min();
+    constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+    auto sorted = [](std::vector<Cell> cells) {
+        std::sort(cells.begin(), cells.end(), [](const Cell& a, const Cell& b) {
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+        return cells;
+    };
+
+    // Bounding box and rect queries match a scan of the reference cells on
+    // every engine, including repeated queries (the hashtable's chunk index)
+    // and queries after the next tick
+    std::mt19937_64 rng(20);
+    CellSet soup;
+    for (int i = 0; i < 40000; i++) {
+        soup.insert({static_cast<int64_t>(rng() % 400) - 200, static_cast<int64_t>(rng() % 300) - 150});
+    }
+    std::vector<BoundingBox> rects = {
+        {-200, 200, -150, 150},
+        {-37, 91, 5, 6},
+        {10, 10, -20, 200},
+        {-1000, -350, -1000, 1000},
+        {kMin, kMax, 0, 0},
+        {5, 4, 0, 10},  // empty
+    };
+    for (EngineType type : {EngineType::Hashtable, EngineType::Sorted, EngineType::Hashlife,
+                            EngineType::Tiled}) {
+        GameOfLife game(soup, type);
+        GameOfLife reference(soup);
+        for (int generation : {7, 8}) {
+            if (generation == 7) {
+                game.run(7);
+                reference.run(7);
+            } else {
+                game.tick();
+                reference.tick();
+            }
+            int64_t min_x, max_x, min_y, max_y;
+            TEST_ASSERT(get_bounding_box(reference, min_x, max_x, min_y, max_y), "Soup should survive");
+            std::optional<BoundingBox> box = game.bounding_box();
+            TEST_ASSERT(box && box->min_x == min_x && box->max_x == max_x && box->min_y == min_y &&
+                            box->max_y == max_y,
+                        "Bounding box should match a scan of the cells");
+            for (int pass = 0; pass < 3; pass++) {
+                for (const BoundingBox& rect : rects) {
+                    std::vector<Cell> found, expected;
+                    game.for_each_in_rect(rect.min_x, rect.min_y, rect.max_x, rect.max_y,
+                                          [&](const Cell& cell) { found.push_back(cell); });
+                    for (const auto& cell : reference.cells()) {
+                        if (rect.contains(cell)) expected.push_back(cell);
+                    }
+                    TEST_ASSERT(sorted(found) == sorted(expected), "Rect query should match a scan");
+                }
+            }
+        }
+    }
+
+    GameOfLife far(CellSet{{kMin, 0}, {kMax, -7}, {3, kMax}}, EngineType::Hashlife);
+    std::optional<BoundingBox> box = far.bounding_box();
+    TEST_ASSERT(box && box->min_x == kMin && box->max_x == kMax && box->min_y == -7 && box->max_y == kMax,
+                "Bounding box should span the int64_t range");
+    TEST_ASSERT(!GameOfLife().bounding_box(), "Empty game has no bounding box");
+
+    // A 2^30-wide macrocell tree answers from its edges, unexpanded
+    std::string mc = "[M2] (golly 4.0)\n$$$...**$...**$\n";
+    for (int level = 4, n = 1; level <= 30; level++, n++) {
+        mc += std::to_string(level) + " " + std::to_string(n) + " " + std::to_string(n) + " " +
+              std::to_string(n) + " " + std::to_string(n) + "\n";
+    }
+    std::istringstream in(mc);
+    GameOfLife tree = GameOfLife::parse_macrocell(in);
+    const int64_t half = int64_t(1) << 29;
+    box = tree.bounding_box();
+    TEST_ASSERT(box && box->min_x == -half + 3 && box->max_x == half - 4 && box->min_y == -half + 3 &&
+                    box->max_y == half - 4,
+                "Tree bounding box should be found without expanding the tree");
+    size_t corner = 0;
+    tree.for_each_in_rect(-half, -half, -half + 15, -half + 15, [&](const Cell&) { ++corner; });
+    TEST_ASSERT(corner == 16, "A 16x16 corner holds four 8x8 blocks of four cells");
+    return true;
+}
+
+bool test_rules() {
+    TEST_ASSERT(Rule{} == parse_rule("B3/S23"), "The default rule is Life");
+    for (const char* text : {"B36/S23", "b36s23", "S23/B63", "23/36"}) {
+        TEST_ASSERT(rule_string(parse_rule(text)) == "B36/S23", "Rule notations should agree");
+    }
+    TEST_ASSERT(rule_string(parse_rule("B2/S")) == "B2/S", "Empty survival list is allowed");
+    for (const char* text : {"", "B3", "B9/S23", "B33/S23", "B3/S23/", "B3/S2x", "B3S23B6",
+                             "23-3", "B03/S23", "8/0"}) {
+        bool threw = false;
+        try {
+            (void)parse_rule(text);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        TEST_ASSERT(threw, "Malformed and B0 rules should be rejected");
+    }
+
+    // Every engine matches a brute-force step for specialized rules and a
+    // runtime one with S0; the soup is large enough for the parallel path
+    auto reference_tick = [](const CellSet& cells, const Rule& rule) {
+        std::unordered_map<Cell, int, CellHash> counts;
+        for (const auto& cell : cells) {
+            counts.try_emplace(cell, 0);
+            for (const auto& neighbor : GameOfLife::get_neighbors(cell.x, cell.y)) {
+                ++counts[neighbor];
+            }
+        }
+        CellSet next;
+        for (const auto& [cell, count] : counts) {
+            uint16_t mask = cells.count(cell) ? rule.survive : rule.birth;
+            if ((mask >> count) & 1u) next.insert(cell);
+        }
+        return next;
+    };
+    std::mt19937_64 rng(21);
+    CellSet soup;
+    for (int i = 0; i < 30000; i++) {
+        soup.insert({static_cast<int64_t>(rng() % 300) - 150, static_cast<int64_t>(rng() % 200) - 100});
+    }
+    for (const char* name : {"B36/S23", "B3678/S34678", "B2/S", "B35/S0236"}) {
+        Rule rule = parse_rule(name);
+        CellSet expected = soup;
+        for (int i = 0; i < 4; i++) expected = reference_tick(expected, rule);
+        for (EngineType type : {EngineType::Hashtable, EngineType::Sorted, EngineType::Hashlife,
+                                EngineType::HashlifeFast, EngineType::Tiled}) {
+            for (unsigned threads : {1u, 3u}) {
+                GameOfLife game(soup, type);
+                game.set_threads(threads);
+                game.set_rule(rule);
+                TEST_ASSERT(game.rule() == rule, "set_rule() should take effect");
+                game.run(4);
+                TEST_ASSERT(game.cells() == expected, "Engine should match the reference rule");
+            }
+        }
+    }
+
+    // Switching rules mid-run keeps the cells but not HashLife's memo
+    GameOfLife game(soup, EngineType::Hashlife);
+    CellSet expected = soup;
+    game.run(2);
+    for (int i = 0; i < 2; i++) expected = reference_tick(expected, Rule{});
+    game.set_rule(parse_rule("B36/S23"));
+    GameOfLife copy = game;
+    game.run(2);
+    for (int i = 0; i < 2; i++) expected = reference_tick(expected, parse_rule("B36/S23"));
+    TEST_ASSERT(game.cells() == expected, "A HashLife game should switch rules mid-run");
+    copy.run(2);
+    TEST_ASSERT(copy.cells() == expected, "Copies should keep the rule");
+    return true;
+}
+
+bool test_distributed() {
+    std::mt19937_64 rng(11);
+    std::uniform_int_distribution<int64_t> dist(-60, 60);
+    CellSet soup;
+    for (int i = 0; i < 3000; i++) {
+        soup.insert({dist(rng), dist(rng)});
+    }
+    auto gathered = [](DistributedLife& life) {
+        CellSet cells;
+        life.for_each_batch([&](const std::vector<Cell>& batch) {
+            cells.insert(batch.begin(), batch.end());
+        });
+        return cells;
+    };
+
+    // 1-wide halos every generation and 5-wide every 5 match one process
+    for (uint64_t halo : {1u, 5u}) {
+        for (EngineType engine : {EngineType::Hashtable, EngineType::Tiled, EngineType::Hashlife}) {
+            DistributedOptions options;
+            options.ranks = 3;
+            options.halo = halo;
+            options.engine = engine;
+            DistributedLife life(soup, options);
+            // The soup is centered on 0, so the first cut is at a negative x
+            TEST_ASSERT(life.boundaries()[1] < 0, "Stripes should start at negative x");
+            GameOfLife reference(soup);
+            life.run(23);
+            reference.run(23);
+            TEST_ASSERT(life.generation() == 23, "Generation should advance");
+            TEST_ASSERT(life.count() == reference.count(), "Distributed population should match");
+            TEST_ASSERT(gathered(life) == reference.cells(), "Distributed cells should match");
+            TEST_ASSERT(life.stats().exchanges == (23 + halo - 1) / halo, "One exchange per halo width");
+        }
+    }
+
+    // Cells at the int64_t limits: every stripe after the first stays at
+    // least a halo wide and the stripe ends don't overflow
+    constexpr int64_t min_x = std::numeric_limits<int64_t>::min();
+    constexpr int64_t max_x = std::numeric_limits<int64_t>::max();
+    CellSet edges;
+    for (int64_t y = 0; y < 3; y++) {
+        for (int64_t x : {min_x, min_x + 1, min_x + 2, max_x - 2, max_x - 1, max_x}) {
+            edges.insert({x, y * 4});
+        }
+        edges.insert({min_x + 5, y * 4 + 1});
+        edges.insert({min_x + 5, y * 4 + 2});
+    }
+    DistributedOptions edge_options;
+    edge_options.ranks = 5;
+    edge_options.halo = 3;
+    DistributedLife edge_life(edges, edge_options);
+    const std::vector<int64_t>& starts = edge_life.boundaries();
+    TEST_ASSERT(starts[0] == min_x, "The first stripe should start at INT64_MIN");
+    for (size_t r = 1; r < starts.size(); r++) {
+        uint64_t width = (r + 1 < starts.size() ? static_cast<uint64_t>(starts[r + 1])
+                                                 : static_cast<uint64_t>(max_x) + 1) -
+                         static_cast<uint64_t>(starts[r]);
+        TEST_ASSERT(starts[r] > starts[r - 1] && width >= 3, "Stripes should be a halo wide");
+    }
+    GameOfLife edge_reference(edges);
+    edge_life.run(7);
+    edge_reference.run(7);
+    TEST_ASSERT(gathered(edge_life) == edge_reference.cells(), "Runs at the limits should match");
+
+    bool threw = false;
+    try {
+        edge_options.halo = uint64_t(1) << 62;
+        DistributedLife too_wide(edges, edge_options);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Halos too wide for the ranks should be rejected");
+
+    // A glider fleet flying out of the first stripe forces a rebalance
+    CellSet fleet;
+    for (int64_t i = 0; i < 1000; i++) {
+        for (const auto& c : CellSet{{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}}) {
+            fleet.insert({c.x + (i % 40) * 8, c.y + (i / 40) * 8});
+        }
+    }
+    DistributedOptions options;
+    options.ranks = 4;
+    options.halo = 4;
+    options.imbalance = 1.2;
+    options.rebalance_every = 16;
+    options.rule = parse_rule("B3/S23");
+    DistributedLife life(fleet, options);
+    GameOfLife reference(fleet);
+    life.run(400);
+    reference.run(400);
+    TEST_ASSERT(life.stats().rebalances > 0, "Drifting gliders should be rebalanced");
+    TEST_ASSERT(life.stats().migrated_cells > 0, "Rebalancing should migrate cells");
+    TEST_ASSERT(gathered(life) == reference.cells(), "Rebalanced run should match");
+    uint64_t largest = *std::max_element(life.populations().begin(), life.populations().end());
+    TEST_ASSERT(largest < life.count(), "Population should be spread over ranks");
+
+    // Shards merge into the snapshot of the whole universe
+    std::string prefix = "/tmp/life_test_shards_" + std::to_string(getpid());
+    std::vector<std::string> shards = life.save_shards(prefix);
+    TEST_ASSERT(shards.size() == 4 && shards[3] == prefix + ".0003.snap", "One shard per rank");
+    std::string merged = prefix + ".snap";
+    TEST_ASSERT(merge_snapshots(shards, merged) == reference.count(), "Merge should count every cell");
+    uint64_t generation = 0;
+    GameOfLife loaded = load_snapshot(merged, EngineType::Hashtable, generation);
+    TEST_ASSERT(generation == 400, "Merged snapshot should keep the generation");
+    TEST_ASSERT(loaded.cells() == reference.cells(), "Merged snapshot should hold every cell");
+    // Overlapping inputs are written once; mixed generations are refused
+    TEST_ASSERT(merge_snapshots({merged, shards[1]}, merged) == reference.count(),
+                "Duplicate cells should be merged");
+    save_snapshot(GameOfLife(fleet), shards[0], 0);
+    threw = false;
+    try {
+        (void)merge_snapshots(shards, merged);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Merging different generations should throw");
+    for (const auto& shard : shards) {
+        std::remove(shard.c_str());
+    }
+    std::remove(merged.c_str());
+    return true;
+}
+
+bool test_simulate_batch() {
+    // The work-stealing pool runs every index once, never two at a time on
+    // one worker, with task costs skewed toward the first worker's share
+    constexpr size_t kTasks = 500;
+    std::vector<std::atomic<int>> runs(kTasks);
+    std::atomic<int> busy[4] = {};
+    std::atomic<bool> overlapped{false};
+    std::atomic<bool> bad_worker{false};
+    parallel_for_stealing(kTasks, 4, [&](size_t i, unsigned worker) {
+        if (worker >= 4) {
+            bad_worker = true;
+            return;
+        }
+        if (busy[worker]++ != 0) overlapped = true;
+        if (i < kTasks / 4) std::this_thread::sleep_for(std::chrono::microseconds(200));
+        runs[i]++;
+        busy[worker]--;
+    });
+    TEST_ASSERT(!bad_worker && !overlapped, "Workers should be distinct and serial");
+    TEST_ASSERT(std::all_of(runs.begin(), runs.end(), [](const std::atomic<int>& n) { return n == 1; }),
+                "Every task should run exactly once");
+
+    // A batch matches running each game on its own, whatever its engine,
+    // rule or cycle detection, including games reusing a worker's engine
+    std::mt19937_64 rng(24);
+    const EngineType types[] = {EngineType::Hashtable, EngineType::Sorted, EngineType::Hashlife,
+                                EngineType::HashlifeFast, EngineType::Tiled};
+    std::vector<GameOfLife> games, expected;
+    for (int i = 0; i < 60; i++) {
+        CellSet cells;
+        int64_t size = 8 + static_cast<int64_t>(rng() % 40);
+        for (int64_t n = 0; n < size * size / 3; n++) {
+            cells.insert({static_cast<int64_t>(rng() % size), static_cast<int64_t>(rng() % size)});
+        }
+        GameOfLife game(cells, types[i % 5]);
+        if (i % 3 == 0) game.set_rule(parse_rule("B36/S23"));
+        game.set_cycle_detection(i % 4 == 0);
+        if (i % 11 == 0) game.set_memory_limit(size_t(1) << 20);
+        games.push_back(game);
+        expected.push_back(game);
+        if (i % 2 == 0) {
+            // Starts with retained state (copies don't retain any)
+            games.back().run(3);
+            expected.back().run(3);
+        }
+    }
+    simulate_batch(games, 100, 3);
+    for (size_t i = 0; i < games.size(); i++) {
+        expected[i].run(100);
+        TEST_ASSERT(games[i].cells() == expected[i].cells(), "Batch should match a lone run");
+        TEST_ASSERT(games[i].rule() == expected[i].rule(), "Batch should keep each game's rule");
+    }
+    // Each game's own engine must step on from the batch's result, not
+    // from a generation it retained before the batch
+    for (size_t i = 0; i < games.size(); i++) {
+        games[i].run(7);
+        games[i].tick();
+        expected[i].run(8);
+        TEST_ASSERT(games[i].cells() == expected[i].cells(),
+                    engine_type_name(types[i % 5]) << " game " << i << " should keep running after a batch");
+    }
+
+    // Metrics count the batch's work
+    std::vector<GameOfLife> measured;
+    for (EngineType type : types) {
+        measured.emplace_back(CellSet{{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}}, type);
+        measured.back().set_metrics(true);
+    }
+    simulate_batch(measured, 16, 2);
+    for (auto& game : measured) {
+        std::vector<EngineCounter> metrics = game.take_metrics();
+        TEST_ASSERT(!metrics.empty() && metrics[0].name == "step_ns" && metrics[0].value > 0,
+                    "Batch steps should be timed");
+        TEST_ASSERT(game.cells().size() == 5, "Measured glider should survive");
+    }
+
+    bool threw = false;
+    try {
+        simulate_batch(games, 1, 0);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Zero threads should be rejected");
+    return true;
+}
+
 // ============ Renderer Tests ============
 
 bool test_bounding_box_empty() {
@@ -739,15 +2099,181 @@ bool test_render_rejects_huge_viewport() {
     config.output_dir = test_dir;
 
     // Try to render a viewport that exceeds max_cells_dimension
+    config.downsample = false;
     bool result = render_frame_fixed_viewport(game, config, 0,
         0, config.max_cells_dimension + 1, 0, 10);
     TEST_ASSERT(!result, "Should reject viewport exceeding max_cells_dimension");
 
+    // With downsampling (the default) it renders one pixel per block
+    config.downsample = true;
+    FrameRenderer renderer(config, 0, config.max_cells_dimension + 1, 0, 10);
+    TEST_ASSERT(renderer.valid() && renderer.downsampled(), "Wide viewport should be downsampled");
+    TEST_ASSERT(renderer.width() <= config.max_width && renderer.height() <= config.max_height,
+                "Downsampled image should fit the size limits");
+
     // Cleanup
     fs::remove_all(test_dir, ec);
     return true;
 }
 
+bool test_downsampled_density() {
+    // Block counts agree across engines, with and without a spatial index
+    std::mt19937_64 rng(19);
+    CellSet soup;
+    for (int i = 0; i < 20000; i++) {
+        soup.insert({static_cast<int64_t>(rng() % 3000) - 1500, static_cast<int64_t>(rng() % 3000) - 1500});
+    }
+    std::vector<BlockGrid> grids = {
+        {-1500, -1500, 0, 64, 64},   // single cells
+        {-1024, -2048, 5, 100, 140},  // aligned, smaller than a tile
+        {-1500, -1500, 7, 24, 24},    // unaligned, straddling tiles and nodes
+        {-4096, -4096, 12, 3, 3},
+    };
+    for (EngineType type : {EngineType::Hashlife, EngineType::Tiled}) {
+        GameOfLife game(soup, type);
+        GameOfLife reference(soup);
+        game.run(5);
+        reference.run(5);
+        for (const BlockGrid& grid : grids) {
+            std::vector<uint64_t> counts, expected;
+            game.count_blocks(grid, counts);
+            reference.count_blocks(grid, expected);
+            TEST_ASSERT(counts == expected, "Engine block counts should match bucketed cells");
+        }
+    }
+
+    // A 2^30-wide block grid (over 2.8 * 10^17 cells) renders straight from
+    // the tree, shaded by density: one block (4 cells) per 8x8 leaf
+    std::string mc = "[M2] (golly 4.0)\n$$$...**$...**$\n";
+    for (int level = 4, n = 1; level <= 30; level++, n++) {
+        mc += std::to_string(level) + " " + std::to_string(n) + " " + std::to_string(n) + " " +
+              std::to_string(n) + " " + std::to_string(n) + "\n";
+    }
+    std::istringstream in(mc);
+    GameOfLife blocks = GameOfLife::parse_macrocell(in);
+    RenderConfig config;
+    config.alive_color = 0xFFFFFFFF;
+    config.dead_color = 0xFF000000;
+    int64_t half = int64_t(1) << 29;
+    FrameRenderer renderer(config, -half, half - 1, -half, half - 1);
+    TEST_ASSERT(renderer.valid() && renderer.downsampled(), "Huge viewport should be downsampled");
+    Frame frame;
+    auto start = std::chrono::high_resolution_clock::now();
+    renderer.render(blocks, frame);
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    TEST_ASSERT(frame.width == 4096 && frame.height == 4096, "Frame should use the full width");
+    // sqrt(4 / 64) = 1/4 of the way from black to white
+    TEST_ASSERT(frame.pixels[12345] == 0xFF404040u, "Uniform density should give a uniform mid shade");
+    TEST_ASSERT(std::all_of(frame.pixels.begin(), frame.pixels.end(),
+                            [&](uint32_t p) { return p == frame.pixels[0]; }),
+                "Every block has the same density");
+    TEST_ASSERT(blocks.count() > 0 && ms < 5000, "Render should not expand the tree into cells");
+    return true;
+}
+
+bool test_png_encoder_pool() {
+    std::string test_dir = "/tmp/life_test_pool_" + std::to_string(getpid());
+    std::string ref_dir = test_dir + "_ref";
+    std::error_code ec;
+    fs::create_directory(test_dir, ec);
+    fs::create_directory(ref_dir, ec);
+
+    RenderConfig config;
+    config.cell_size = 5;
+    config.show_grid = true;
+    GameOfLife game(CellSet{{1, 0}, {2, 1}, {0, 2}, {1, 2}, {2, 2}});
+    FrameRenderer renderer(config, -10, 20, -10, 20);
+    TEST_ASSERT(renderer.valid(), "Viewport should be renderable");
+
+    // Frames queued through the pool match the synchronous renderer byte for byte
+    config.output_dir = test_dir;
+    PngEncoder encoder(config, 3);
+    RenderConfig ref_config = config;
+    ref_config.output_dir = ref_dir;
+    Frame frame;
+    for (int i = 0; i < 12; i++) {
+        renderer.render(game, frame);
+        TEST_ASSERT(frame.width == renderer.width() && frame.height == renderer.height(),
+                    "Frame should have the viewport's size");
+        encoder.submit(frame, i);
+        TEST_ASSERT(render_frame_fixed_viewport(game, ref_config, i, -10, 20, -10, 20),
+                    "Reference frame should render");
+        game.tick();
+    }
+    TEST_ASSERT(encoder.finish().empty(), "Every frame should be written");
+    for (int i = 0; i < 12; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "/frame_%05d.png", i);
+        std::ifstream a(test_dir + name, std::ios::binary), b(ref_dir + name, std::ios::binary);
+        std::string pa((std::istreambuf_iterator<char>(a)), std::istreambuf_iterator<char>());
+        std::string pb((std::istreambuf_iterator<char>(b)), std::istreambuf_iterator<char>());
+        TEST_ASSERT(!pa.empty() && pa == pb, "Pooled PNG should match the direct render");
+    }
+
+    // Failures are reported per frame
+    RenderConfig missing = config;
+    missing.output_dir = test_dir + "/does_not_exist";
+    PngEncoder failing(missing, 2);
+    renderer.render(game, frame);
+    failing.submit(frame, 7);
+    renderer.render(game, frame);
+    failing.submit(frame, 3);
+    TEST_ASSERT((failing.finish() == std::vector<int>{3, 7}), "Failed frames should be listed");
+
+    fs::remove_all(test_dir, ec);
+    fs::remove_all(ref_dir, ec);
+    return true;
+}
+
+bool test_video_stream() {
+    // A shell stands in for ffmpeg and stores the raw frames it is sent
+    char path[] = "/tmp/gol_video_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT(fd >= 0, "Should create temp file");
+    close(fd);
+
+    GameOfLife game(CellSet{{1, 0}, {2, 1}, {0, 2}, {1, 2}, {2, 2}});
+    RenderConfig config;
+    config.cell_size = 2;
+    Frame frame;
+    std::vector<uint32_t> expected;
+    VideoStream video;
+    for (int i = 0; i < 8; i++) {
+        TEST_ASSERT(render_pixels(game, config, -5, 10, -5, 10, frame), "Frame should render");
+        if (i == 0) {
+            TEST_ASSERT(video.open({"sh", "-c", std::string("cat > ") + path}, frame.width, frame.height),
+                        "Should start the encoder process");
+        }
+        expected.insert(expected.end(), frame.pixels.begin(), frame.pixels.end());
+        TEST_ASSERT(video.write_frame(frame), "Frame should be queued");
+        game.tick();
+    }
+    Frame wrong;
+    wrong.width = 1;
+    wrong.height = 1;
+    wrong.pixels.assign(1, 0);
+    TEST_ASSERT(!video.write_frame(wrong), "Frames of another size should be rejected");
+    TEST_ASSERT(video.finish(), "Encoder should exit cleanly");
+
+    std::ifstream file(path, std::ios::binary);
+    std::string raw((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(path);
+    TEST_ASSERT(raw.size() == expected.size() * sizeof(uint32_t), "Every frame should reach the pipe");
+    TEST_ASSERT(std::memcmp(raw.data(), expected.data(), raw.size()) == 0, "Frames should arrive in order");
+
+    // A child that exits without reading fails the stream instead of
+    // killing the process with SIGPIPE
+    VideoStream failing;
+    TEST_ASSERT(render_pixels(game, config, -500, 500, -500, 500, frame), "Frame should render");
+    TEST_ASSERT(failing.open({"sh", "-c", "exit 3"}, frame.width, frame.height), "Should start the process");
+    for (int i = 0; i < 4; i++) {
+        (void)failing.write_frame(frame);
+    }
+    TEST_ASSERT(!failing.finish(), "A failed encoder should be reported");
+    return true;
+}
+
 // ============ Benchmarks ============
 // Run with: ./test_game_of_life --benchmark
 
@@ -888,6 +2414,10 @@ int main(int argc, char* argv[]) {
     RUN_TEST(test_trailing_garbage);
     RUN_TEST(test_empty_with_header);
     RUN_TEST(test_parse_large_integers);
+    RUN_TEST(test_parse_file_matches_stream);
+    RUN_TEST(test_snapshot_round_trip);
+    RUN_TEST(test_rle_round_trip);
+    RUN_TEST(test_macrocell_tree);
 
     std::cout << "\nPattern tests:\n";
     RUN_TEST(test_blinker);
@@ -916,10 +2446,34 @@ int main(int argc, char* argv[]) {
     RUN_TEST(test_format);
     RUN_TEST(test_write_stream);
     RUN_TEST(test_write_sorted);
+    RUN_TEST(test_parallel_write);
     RUN_TEST(test_sample_input);
     RUN_TEST(test_move_constructor);
     RUN_TEST(test_randomized_consistency);
 
+    std::cout << "\nEngine tests:\n";
+    RUN_TEST(test_hashlife_retained_state);
+    RUN_TEST(test_run_matches_ticks_all_engines);
+    RUN_TEST(test_hashlife_fast_long_run);
+    RUN_TEST(test_tiled_matches_reference);
+    RUN_TEST(test_tiled_change_tracking);
+    RUN_TEST(test_auto_engine);
+    RUN_TEST(test_tick_async);
+    RUN_TEST(test_engine_metrics);
+    RUN_TEST(test_change_tracking);
+    RUN_TEST(test_delta_stream);
+    RUN_TEST(test_hashlife_matches_reference_soup);
+    RUN_TEST(test_hashlife_clustered_gliders);
+    RUN_TEST(test_hashlife_memory_limit);
+    RUN_TEST(test_sorted_radix_matches_reference);
+    RUN_TEST(test_hashtable_threads_match_serial);
+    RUN_TEST(test_hashtable_packed_keys);
+    RUN_TEST(test_cycle_detection);
+    RUN_TEST(test_spatial_queries);
+    RUN_TEST(test_rules);
+    RUN_TEST(test_simulate_batch);
+    RUN_TEST(test_distributed);
+
     std::cout << "\nRenderer tests:\n";
     RUN_TEST(test_bounding_box_empty);
     RUN_TEST(test_bounding_box_single_cell);
@@ -928,6 +2482,9 @@ int main(int argc, char* argv[]) {
     RUN_TEST(test_render_frame_fixed_viewport);
     RUN_TEST(test_render_empty_game);
     RUN_TEST(test_render_rejects_huge_viewport);
+    RUN_TEST(test_downsampled_density);
+    RUN_TEST(test_png_encoder_pool);
+    RUN_TEST(test_video_stream);
 
     std::cout << "\n";
     std::cout << "================================\n";